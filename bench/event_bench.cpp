@@ -0,0 +1,56 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <benchmark/benchmark.h>
+#include <engine/event_handling.h>
+
+
+namespace {
+
+using engine::KeyEvent;
+using engine::KeyHandlerChain;
+
+// every handler passes the event on so dispatch walks the whole chain
+void BM_HandlerChainHandle(benchmark::State &state) {
+	KeyHandlerChain chain;
+	int calls{0};
+	for (int64_t i = 0; i < state.range(0); ++i)
+		chain.set_next([&calls](KeyEvent event) { calls += event.pressed; return true; });
+	KeyEvent event{65, true};
+	for (auto _: state) {
+		chain.handle(event);
+		benchmark::DoNotOptimize(calls);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HandlerChainHandle)->RangeMultiplier(4)->Range(1, 1024);
+
+// the first handler consumes the event, the cost of a chain that stops early
+void BM_HandlerChainHandleConsumed(benchmark::State &state) {
+	KeyHandlerChain chain;
+	for (int64_t i = 0; i < state.range(0); ++i)
+		chain.set_next([](KeyEvent) { return false; });
+	KeyEvent event{65, true};
+	for (auto _: state)
+		chain.handle(event);
+}
+BENCHMARK(BM_HandlerChainHandleConsumed)->Arg(1)->Arg(1024);
+
+} // anonymous
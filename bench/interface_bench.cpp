@@ -0,0 +1,116 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <array>
+#include <benchmark/benchmark.h>
+#include <engine/interface/CuteBounds.h>
+#include <engine/interface/EntityMap.h>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+using engine::interface::CuteBounds;
+using engine::interface::EntityMap;
+using utils::math::Point_2;
+
+// fixed seed so every run (and every commit) queries the same layout
+constexpr unsigned int SEED{42};
+
+EntityMap make_map(std::size_t size) {
+	std::mt19937 rng(SEED);
+	std::uniform_real_distribution<double> coordinate(0., 1000.);
+	EntityMap map;
+	for (std::size_t i = 0; i < size; ++i)
+		map.put(Point_2(coordinate(rng), coordinate(rng)), static_cast<entt::entity>(i));
+	return map;
+}
+
+std::vector<std::pair<double, double>> make_queries() {
+	std::mt19937 rng(SEED + 1);
+	std::uniform_real_distribution<double> coordinate(0., 1000.);
+	std::vector<std::pair<double, double>> queries(256);
+	for (auto &query: queries)
+		query = {coordinate(rng), coordinate(rng)};
+	return queries;
+}
+
+void BM_EntityMapAt(benchmark::State &state) {
+	auto map = make_map(state.range(0));
+	auto queries = make_queries();
+	std::size_t i{0};
+	for (auto _: state) {
+		const auto &[x, y] = queries[i++ % queries.size()];
+		benchmark::DoNotOptimize(map.at(x, y));
+	}
+}
+BENCHMARK(BM_EntityMapAt)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+void BM_EntityMapClosestN(benchmark::State &state) {
+	auto map = make_map(state.range(0));
+	auto queries = make_queries();
+	std::size_t i{0};
+	for (auto _: state) {
+		const auto &[x, y] = queries[i++ % queries.size()];
+		benchmark::DoNotOptimize(map.closest_n(x, y, state.range(1)));
+	}
+}
+BENCHMARK(BM_EntityMapClosestN)
+		->ArgsProduct({{1000, 10000, 100000, 1000000}, {1, 16}})
+		->Unit(benchmark::kMicrosecond);
+
+// index order matches C2_TYPE: circle, aabb, capsule, poly. All overlap around the origin
+CuteBounds make_shape(int64_t type) {
+	switch (type) {
+		case 0:
+			return CuteBounds(c2Circle{c2v{0, 0}, 1.f});
+		case 1:
+			return CuteBounds(c2AABB{c2v{-1, -1}, c2v{1, 1}});
+		case 2:
+			return CuteBounds(c2Capsule{c2v{-1, 0}, c2v{1, 0}, 0.5f});
+		default: {
+			c2Poly poly{};
+			poly.count = 5;
+			std::array<c2v, 5> verts{c2v{-1, -1}, c2v{1, -1}, c2v{1.5f, 0.5f}, c2v{0, 1.5f}, c2v{-1.5f, 0.5f}};
+			for (int i = 0; i < poly.count; ++i)
+				poly.verts[i] = verts[i];
+			c2MakePoly(&poly);
+			return CuteBounds(poly);
+		}
+	}
+}
+
+void BM_CuteBoundsCollides(benchmark::State &state) {
+	auto a = make_shape(state.range(0));
+	auto b = make_shape(state.range(1));
+	for (auto _: state)
+		benchmark::DoNotOptimize(a.collides(b));
+}
+BENCHMARK(BM_CuteBoundsCollides)->ArgsProduct({{0, 1, 2, 3}, {0, 1, 2, 3}})->ArgNames({"a", "b"});
+
+void BM_CuteBoundsCollidesPoint(benchmark::State &state) {
+	auto shape = make_shape(state.range(0));
+	for (auto _: state)
+		benchmark::DoNotOptimize(shape.collides(0.5f, 0.25f));
+}
+BENCHMARK(BM_CuteBoundsCollidesPoint)->DenseRange(0, 3)->ArgName("shape");
+
+} // anonymous
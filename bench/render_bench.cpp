@@ -0,0 +1,581 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <benchmark/benchmark.h>
+#include <engine/render/camera/OrbitCam.h>
+#include <engine/render/camera/Steadicam.h>
+#include <engine/render/culling.h>
+#include <engine/render/instance_containers.h>
+#include <engine/render/occlusion.h>
+#include <engine/render/picking.h>
+#include <engine/render/renderer.h>
+#include <engine/render/RenderQueue.h>
+#include <engine/render/Shader.h>
+#include <engine/render/SpatialIndex.h>
+#include <engine/render/TransformHierarchy.h>
+#include <entt/entt.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Nothing here needs a GL context, only the CPU side of the renderer is measured, except for the uniform
+// benchmarks at the end
+
+
+namespace {
+
+using namespace engine::render;
+
+constexpr unsigned int SEED{42};
+
+std::vector<glm::mat4> make_transforms(std::size_t count) {
+	std::mt19937 rng(SEED);
+	std::uniform_real_distribution<float> position(-500.f, 500.f);
+	std::vector<glm::mat4> transforms(count);
+	for (auto &transform: transforms)
+		transform = glm::translate(glm::mat4(1.f), glm::vec3(position(rng), position(rng), position(rng)));
+	return transforms;
+}
+
+void BM_InstanceVectorSetData(benchmark::State &state) {
+	Mat4Instances instances(GL_TRIANGLES, 36);
+	auto transforms = make_transforms(state.range(0));
+	for (auto _: state) {
+		instances.set_data(transforms);
+		benchmark::DoNotOptimize(instances.get_data());
+	}
+	state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(glm::mat4));
+}
+BENCHMARK(BM_InstanceVectorSetData)->RangeMultiplier(10)->Range(100, 100000);
+
+// scattered single instance edits, each marks a dirty range for the next upload
+void BM_InstanceVectorSetInstance(benchmark::State &state) {
+	Mat4Instances instances(GL_TRIANGLES, 36);
+	instances.set_data(make_transforms(state.range(0)));
+	std::mt19937 rng(SEED);
+	std::uniform_int_distribution<std::size_t> index(0, state.range(0) - 1);
+	std::vector<std::size_t> edits(1024);
+	for (auto &edit: edits)
+		edit = index(rng);
+	glm::mat4 value(2.f);
+	std::size_t i{0};
+	for (auto _: state)
+		instances.set_instance(edits[i++ % edits.size()], value);
+}
+BENCHMARK(BM_InstanceVectorSetInstance)->RangeMultiplier(10)->Range(100, 100000);
+
+// conversion cost per instance format, the counter is what actually goes over the bus
+void BM_PackInstances(benchmark::State &state) {
+	auto format = static_cast<InstanceFormat>(state.range(0));
+	auto transforms = make_transforms(state.range(1));
+	std::vector<std::uint8_t> packed;
+	for (auto _: state) {
+		pack_instances(format, transforms.data(), transforms.size(), packed);
+		benchmark::DoNotOptimize(packed.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(1));
+	state.counters["bytes_per_instance"] = static_cast<double>(instance_size(format));
+}
+BENCHMARK(BM_PackInstances)->ArgsProduct({{0, 1, 2, 3, 4}, {1000, 100000}})->ArgNames({"format", "n"});
+
+void BM_RenderQueueSort(benchmark::State &state) {
+	std::mt19937 rng(SEED);
+	std::uniform_int_distribution<GLuint> id(1, 64);
+	std::uniform_real_distribution<float> depth(0.f, 1.f);
+	std::vector<std::pair<std::uint64_t, DrawCommand>> commands(state.range(0));
+	for (auto &[key, command]: commands) {
+		command = DrawCommand{id(rng), id(rng), id(rng), GL_TRIANGLES, 36, GL_UNSIGNED_INT, 1};
+		key = RenderQueue::make_key(0, command.program, command.texture, command.vao, depth(rng));
+	}
+	RenderQueue queue;
+	for (auto _: state) {
+		queue.clear();
+		for (const auto &[key, command]: commands)
+			queue.push(key, command);
+		queue.sort();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RenderQueueSort)->RangeMultiplier(10)->Range(100, 100000);
+
+// 100k nodes four deep: 100 roots, 9 children each, then 10 and 10 again. Leaves fill the Mat4Instances of their
+// root's owner. range(0) of the roots move every iteration, dragging their whole subtree along
+void BM_TransformPropagation(benchmark::State &state) {
+	entt::registry registry;
+	TransformHierarchy hierarchy;
+	hierarchy.connect(registry);
+	std::mt19937 rng(SEED);
+	std::uniform_real_distribution<float> offset(-5.f, 5.f);
+	auto add = [&](entt::entity parent, entt::entity owner, std::size_t slot) {
+		auto entity = registry.create();
+		registry.emplace<Transform>(entity, glm::vec3(offset(rng), offset(rng), offset(rng)),
+		                            glm::angleAxis(offset(rng), glm::vec3(0.f, 0.f, 1.f)), glm::vec3(1.f), parent,
+		                            owner, slot);
+		return entity;
+	};
+	std::vector<entt::entity> roots;
+	for (int r = 0; r < 100; ++r) {
+		auto owner = registry.create();
+		registry.emplace<Mat4Instances>(owner, GL_TRIANGLES, 36).set_data(std::vector<glm::mat4>(900));
+		auto root = add(entt::null, entt::null, 0);
+		roots.push_back(root);
+		std::size_t slot{0};
+		for (int a = 0; a < 9; ++a) {
+			auto first = add(root, entt::null, 0);
+			for (int b = 0; b < 10; ++b) {
+				auto second = add(first, entt::null, 0);
+				for (int c = 0; c < 10; ++c)
+					add(second, owner, slot++);
+			}
+		}
+	}
+	hierarchy.update(registry);
+	float angle{0.f};
+	for (auto _: state) {
+		angle += 0.01f;
+		for (int r = 0; r < state.range(0); ++r)
+			registry.patch<Transform>(roots[r], [&](Transform &transform) {
+				transform.rotation = glm::angleAxis(angle, glm::vec3(0.f, 1.f, 0.f));
+			});
+		hierarchy.update(registry);
+	}
+	state.SetItemsProcessed(state.iterations() * hierarchy.get_stats().updated);
+	state.counters["nodes"] = static_cast<double>(hierarchy.get_stats().nodes);
+	state.counters["written"] = static_cast<double>(hierarchy.get_stats().written);
+}
+BENCHMARK(BM_TransformPropagation)->Arg(1)->Arg(10)->Arg(100)->ArgName("moved_roots")->UseRealTime();
+
+void BM_TransformBounds(benchmark::State &state) {
+	auto transforms = make_transforms(state.range(0));
+	auto bounds = compute_bounds({glm::vec3(-1.f), glm::vec3(1.f)});
+	SphereSet spheres;
+	for (auto _: state) {
+		transform_bounds(bounds, transforms.data(), transforms.size(), spheres);
+		benchmark::DoNotOptimize(spheres.radius.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransformBounds)->RangeMultiplier(10)->Range(100, 100000);
+
+Frustum make_frustum() {
+	RenderContext context{1920, 1080, 45.f, 0.1f, 1000.f};
+	auto view = glm::lookAt(glm::vec3(0, -600, 0), glm::vec3(0), glm::vec3(0, 0, 1));
+	return Frustum(get_projection(context) * view);
+}
+
+void BM_CullSpheres(benchmark::State &state) {
+	auto transforms = make_transforms(state.range(0));
+	SphereSet spheres;
+	transform_bounds(compute_bounds({glm::vec3(-1.f), glm::vec3(1.f)}), transforms.data(), transforms.size(), spheres);
+	auto frustum = make_frustum();
+	std::vector<std::uint32_t> visible;
+	for (auto _: state)
+		benchmark::DoNotOptimize(cull_spheres(frustum, spheres, visible));
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CullSpheres)->RangeMultiplier(10)->Range(100, 100000);
+
+// reference for the SIMD kernel above
+void BM_CullSpheresScalar(benchmark::State &state) {
+	auto transforms = make_transforms(state.range(0));
+	SphereSet spheres;
+	transform_bounds(compute_bounds({glm::vec3(-1.f), glm::vec3(1.f)}), transforms.data(), transforms.size(), spheres);
+	auto frustum = make_frustum();
+	std::vector<std::uint32_t> visible;
+	for (auto _: state)
+		benchmark::DoNotOptimize(cull_spheres_scalar(frustum, spheres, visible));
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CullSpheresScalar)->RangeMultiplier(10)->Range(100, 100000);
+
+// count instances of make_transforms spread over ten unit box meshes
+struct IndexedScene {
+	entt::registry registry;
+	std::vector<entt::entity> meshes;
+	SpatialIndex index;
+
+	explicit IndexedScene(std::size_t count) {
+		auto transforms = make_transforms(count);
+		auto bounds = compute_bounds({glm::vec3(-1.f), glm::vec3(1.f)});
+		for (std::size_t mesh = 0; mesh < 10; ++mesh) {
+			auto entity = registry.create();
+			registry.emplace<MeshBounds>(entity, bounds);
+			auto &instances = registry.emplace<Mat4Instances>(entity, GL_TRIANGLES, 36);
+			instances.set_data({transforms.begin() + mesh * count / 10, transforms.begin() + (mesh + 1) * count / 10});
+			meshes.push_back(entity);
+		}
+	}
+};
+
+void BM_SpatialIndexBuild(benchmark::State &state) {
+	IndexedScene scene(state.range(0));
+	for (auto _: state) {
+		SpatialIndex index;
+		index.connect(scene.registry);
+		index.update(scene.registry);
+		benchmark::DoNotOptimize(index.get_stats().nodes);
+		index.disconnect(scene.registry);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SpatialIndexBuild)->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMillisecond)
+		->UseRealTime();
+
+// teleport 1000 instances of one mesh per frame, every box of that mesh is rechecked
+void BM_SpatialIndexUpdate(benchmark::State &state) {
+	IndexedScene scene(state.range(0));
+	scene.index.connect(scene.registry);
+	scene.index.update(scene.registry);
+	auto moves = make_transforms(1000);
+	std::size_t frame{0};
+	for (auto _: state) {
+		auto mesh = scene.meshes[frame++ % scene.meshes.size()];
+		scene.registry.patch<Mat4Instances>(mesh, [&](Mat4Instances &instances) {
+			for (std::size_t i = 0; i < moves.size(); ++i)
+				instances.set_instance((i * 7919 + frame) % instances.num_instances(), moves[(i + frame) % moves.size()]);
+		});
+		scene.index.update(scene.registry);
+	}
+	state.counters["moved"] = static_cast<double>(scene.index.get_stats().moved);
+	state.counters["height"] = scene.index.get_stats().height;
+}
+BENCHMARK(BM_SpatialIndexUpdate)->RangeMultiplier(10)->Range(10000, 1000000)->UseRealTime();
+
+void BM_SpatialIndexQueryFrustum(benchmark::State &state) {
+	IndexedScene scene(state.range(0));
+	scene.index.connect(scene.registry);
+	scene.index.update(scene.registry);
+	auto frustum = make_frustum();
+	std::vector<InstanceKey> keys;
+	for (auto _: state)
+		benchmark::DoNotOptimize(scene.index.query(frustum, keys));
+	state.counters["results"] = static_cast<double>(keys.size());
+}
+BENCHMARK(BM_SpatialIndexQueryFrustum)->RangeMultiplier(10)->Range(10000, 1000000);
+
+// a small neighbourhood, what selection and gameplay queries look like
+void BM_SpatialIndexQuerySphere(benchmark::State &state) {
+	IndexedScene scene(state.range(0));
+	scene.index.connect(scene.registry);
+	scene.index.update(scene.registry);
+	std::vector<InstanceKey> keys;
+	for (auto _: state)
+		benchmark::DoNotOptimize(scene.index.query(glm::vec3(0.f), 25.f, keys));
+	state.counters["results"] = static_cast<double>(keys.size());
+}
+BENCHMARK(BM_SpatialIndexQuerySphere)->RangeMultiplier(10)->Range(10000, 1000000);
+
+// a grid of count x count box buildings seen from street level, and one unit box per instance of make_transforms
+struct OcclusionScene {
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	std::vector<glm::mat4> buildings;
+	glm::mat4 view_projection;
+
+	explicit OcclusionScene(int count) {
+		for (unsigned int corner = 0; corner < 8; ++corner)
+			positions.emplace_back(corner & 1 ? 1.f : -1.f, corner & 2 ? 1.f : -1.f, corner & 4 ? 1.f : -1.f);
+		const unsigned int faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 4, 6, 2},
+		                                  {1, 3, 7, 5}};
+		for (const auto &face: faces)
+			indices.insert(indices.end(), {face[0], face[1], face[2], face[0], face[2], face[3]});
+		std::mt19937 rng(SEED);
+		std::uniform_real_distribution<float> height(10.f, 60.f);
+		auto spacing = 1000.f / count;
+		for (int x = 0; x < count; ++x)
+			for (int y = 0; y < count; ++y) {
+				glm::vec3 center{-500.f + (x + 0.5f) * spacing, -500.f + (y + 0.5f) * spacing, 0.f};
+				buildings.push_back(glm::scale(glm::translate(glm::mat4(1.f), center),
+				                               glm::vec3(0.4f * spacing, 0.4f * spacing, height(rng))));
+			}
+		RenderContext context{1920, 1080, 45.f, 0.1f, 1000.f};
+		auto view = glm::lookAt(glm::vec3(-500.f, -500.f, 2.f), glm::vec3(0.f, 0.f, 2.f), glm::vec3(0, 0, 1));
+		view_projection = get_projection(context) * view;
+	}
+};
+
+void BM_OcclusionRasterize(benchmark::State &state) {
+	OcclusionScene scene(static_cast<int>(state.range(0)));
+	OcclusionBuffer buffer;
+	for (auto _: state) {
+		buffer.begin(scene.view_projection);
+		buffer.add_occluder(scene.positions, scene.indices, scene.buildings.data(), scene.buildings.size());
+		buffer.finish();
+		benchmark::DoNotOptimize(buffer.get_depth().data());
+	}
+	state.counters["triangles"] = static_cast<double>(buffer.get_stats().triangles);
+}
+BENCHMARK(BM_OcclusionRasterize)->Arg(8)->Arg(16)->Arg(32)->ArgName("grid")->UseRealTime();
+
+void BM_OcclusionCull(benchmark::State &state) {
+	OcclusionScene scene(16);
+	OcclusionBuffer buffer;
+	buffer.begin(scene.view_projection);
+	buffer.add_occluder(scene.positions, scene.indices, scene.buildings.data(), scene.buildings.size());
+	buffer.finish();
+	auto transforms = make_transforms(state.range(0));
+	auto bounds = compute_bounds(scene.positions);
+	std::vector<std::uint32_t> indices(transforms.size());
+	for (auto _: state) {
+		std::iota(indices.begin(), indices.end(), 0u);
+		benchmark::DoNotOptimize(buffer.cull(bounds, transforms.data(), indices.data(), indices.size()));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["occluded"] = static_cast<double>(buffer.get_stats().occluded) / state.iterations();
+}
+BENCHMARK(BM_OcclusionCull)->RangeMultiplier(10)->Range(1000, 100000)->UseRealTime();
+
+// a count x count grid of quads over [-1, 1] with a little noise in z, 2 * count^2 triangles
+void make_terrain(int count, std::vector<glm::vec3> &positions, std::vector<unsigned int> &indices) {
+	std::mt19937 rng(SEED);
+	std::uniform_real_distribution<float> height(-0.05f, 0.05f);
+	positions.clear();
+	indices.clear();
+	for (int y = 0; y <= count; ++y)
+		for (int x = 0; x <= count; ++x)
+			positions.emplace_back(2.f * x / count - 1.f, 2.f * y / count - 1.f, height(rng));
+	for (int y = 0; y < count; ++y)
+		for (int x = 0; x < count; ++x) {
+			unsigned int corner = y * (count + 1) + x;
+			indices.insert(indices.end(), {corner, corner + 1, corner + count + 2, corner, corner + count + 2,
+			                               corner + count + 1});
+		}
+}
+
+void BM_TriangleBvhBuild(benchmark::State &state) {
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	make_terrain(static_cast<int>(state.range(0)), positions, indices);
+	for (auto _: state) {
+		TriangleBvh bvh(positions, indices);
+		benchmark::DoNotOptimize(bvh.get_node_count());
+	}
+	state.SetItemsProcessed(state.iterations() * indices.size() / 3);
+}
+// 20k, 200k and 1M triangles
+BENCHMARK(BM_TriangleBvhBuild)->Arg(100)->Arg(316)->Arg(708)->ArgName("grid")->Unit(benchmark::kMillisecond)
+		->UseRealTime();
+
+// slanted rays dropped onto a million triangles
+void BM_TriangleBvhIntersect(benchmark::State &state) {
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	make_terrain(708, positions, indices);
+	TriangleBvh bvh(positions, indices);
+	std::mt19937 rng(SEED);
+	std::uniform_real_distribution<float> offset(-1.f, 1.f);
+	std::vector<Ray> rays(1024);
+	for (auto &ray: rays)
+		ray = {glm::vec3(offset(rng), offset(rng), 1.f),
+		       glm::normalize(glm::vec3(0.3f * offset(rng), 0.3f * offset(rng), -1.f))};
+	std::size_t i{0}, hits{0};
+	for (auto _: state) {
+		TriangleHit hit;
+		hits += bvh.intersect(rays[i++ % rays.size()], hit);
+	}
+	state.counters["hit_rate"] = static_cast<double>(hits) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_TriangleBvhIntersect);
+
+// cursor rays into count instances of ten 10k triangle terrain tiles spread like make_transforms, up to a billion
+// instanced triangles
+void BM_Pick(benchmark::State &state) {
+	entt::registry registry;
+	SpatialIndex index;
+	index.connect(registry);
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	make_terrain(71, positions, indices);
+	auto count = static_cast<std::size_t>(state.range(0));
+	auto transforms = make_transforms(count);
+	for (auto &transform: transforms)
+		transform = glm::scale(transform, glm::vec3(20.f));
+	for (std::size_t mesh = 0; mesh < 10; ++mesh) {
+		auto entity = registry.create();
+		registry.emplace<MeshBounds>(entity, compute_bounds(positions));
+		registry.emplace<TriangleBvh>(entity, positions, indices);
+		auto &instances = registry.emplace<Mat4Instances>(entity, GL_TRIANGLES, indices.size());
+		instances.set_data({transforms.begin() + mesh * count / 10, transforms.begin() + (mesh + 1) * count / 10});
+	}
+	index.update(registry);
+
+	RenderContext context{1920, 1080, 45.f, 0.1f, 1000.f};
+	auto view = glm::lookAt(glm::vec3(0.f, -900.f, 300.f), glm::vec3(0.f), glm::vec3(0, 0, 1));
+	std::mt19937 rng(SEED);
+	std::uniform_real_distribution<float> x(0.f, 1920.f), y(0.f, 1080.f);
+	std::vector<Ray> rays(1024);
+	for (auto &ray: rays)
+		ray = make_ray(glm::vec2(x(rng), y(rng)), glm::vec2(1920.f, 1080.f), view, get_projection(context));
+	std::size_t i{0}, hits{0};
+	for (auto _: state) {
+		PickHit hit;
+		hits += pick(index, registry, rays[i++ % rays.size()], hit);
+	}
+	state.counters["hit_rate"] = static_cast<double>(hits) / static_cast<double>(state.iterations());
+	index.disconnect(registry);
+}
+BENCHMARK(BM_Pick)->RangeMultiplier(10)->Range(100, 100000)->ArgName("instances")->Unit(benchmark::kMicrosecond);
+
+void BM_OrbitCamGetView(benchmark::State &state) {
+	OrbitCam camera(glm::vec3(10, -10, 10), glm::vec3(0));
+	for (auto _: state)
+		benchmark::DoNotOptimize(camera.get_view());
+}
+BENCHMARK(BM_OrbitCamGetView);
+
+void BM_SteadicamGetView(benchmark::State &state) {
+	Steadicam camera(glm::vec3(10, -10, 10), glm::vec3(-1, 1, -1), glm::vec3(0, 0, 1));
+	for (auto _: state)
+		benchmark::DoNotOptimize(camera.get_view());
+}
+BENCHMARK(BM_SteadicamGetView);
+
+void BM_GetProjection(benchmark::State &state) {
+	RenderContext context{1920, 1080, 45.f, 0.1f, 1000.f};
+	for (auto _: state)
+		benchmark::DoNotOptimize(get_projection(context));
+}
+BENCHMARK(BM_GetProjection);
+
+// Uniform benchmarks: setting the camera's vp before a draw, as render() does for every camera each frame.
+// Each needs a GL context, a hidden window made by render::init the first time one runs, and issues a one point
+// draw after the update so the driver can't defer the uniform past the measurement
+
+const char *UNIFORM_VERTEX_SOURCE = R"(#version 410 core
+uniform mat4 vp;
+void main() {
+	gl_Position = vp * vec4(0.0, 0.0, 0.0, 1.0);
+}
+)";
+
+const char *BLOCK_VERTEX_SOURCE = R"(#version 410 core
+layout(std140) uniform Frame { mat4 vp; mat4 view; mat4 projection; vec4 camera_position; vec4 time; };
+void main() {
+	gl_Position = vp * vec4(0.0, 0.0, 0.0, 1.0);
+}
+)";
+
+const char *UNIFORM_FRAGMENT_SOURCE = R"(#version 410 core
+out vec4 out_color;
+void main() {
+	out_color = vec4(1.0);
+}
+)";
+
+// cameras per frame in the Frame block benchmark, whose stream buffer moves to its next region every frame
+constexpr int CAMERAS_PER_FRAME{64};
+
+bool has_gl_context() {
+	static bool initialized = init({64, 64, false, true, false});
+	return initialized;
+}
+
+// program and an empty VAO to draw a point with, nullptr without a context
+std::unique_ptr<Shader> make_uniform_program(benchmark::State &state, const char *vertex_source) {
+	if (!has_gl_context()) {
+		state.SkipWithError("no GL context");
+		return nullptr;
+	}
+	std::unique_ptr<Shader> shader;
+	try {
+		shader = std::make_unique<Shader>(load_shader(vertex_source, UNIFORM_FRAGMENT_SOURCE));
+	} catch (const std::runtime_error &e) {
+		state.SkipWithError(e.what());
+		return nullptr;
+	}
+	shader->use();
+	return shader;
+}
+
+void draw_point(GLuint vao) {
+	gl_state().bind_vertex_array(vao);
+	glDrawArrays(GL_POINTS, 0, 1);
+}
+
+// what render() paid per camera and frame before Shader cached its vp handle: the driver's name lookup each time
+void BM_UniformLookupByName(benchmark::State &state) {
+	auto shader = make_uniform_program(state, UNIFORM_VERTEX_SOURCE);
+	if (shader == nullptr)
+		return;
+	GLuint vao{0};
+	glGenVertexArrays(1, &vao);
+	glm::mat4 vp(1.f);
+	for (auto _: state) {
+		vp[3][0] += 1e-6f;
+		glUniformMatrix4fv(glGetUniformLocation(shader->get_id(), "vp"), 1, GL_FALSE, &vp[0][0]);
+		draw_point(vao);
+	}
+	glFinish();
+	gl_state().delete_vertex_arrays(1, &vao);
+	shader->destroy();
+}
+BENCHMARK(BM_UniformLookupByName);
+
+// the handle resolved once after link, as Shader::get_vp_uniform hands it out now
+void BM_UniformCachedHandle(benchmark::State &state) {
+	auto shader = make_uniform_program(state, UNIFORM_VERTEX_SOURCE);
+	if (shader == nullptr)
+		return;
+	GLuint vao{0};
+	glGenVertexArrays(1, &vao);
+	auto vp_uniform = shader->get_vp_uniform();
+	glm::mat4 vp(1.f);
+	for (auto _: state) {
+		vp[3][0] += 1e-6f;
+		shader->set(vp_uniform, vp);
+		draw_point(vao);
+	}
+	glFinish();
+	gl_state().delete_vertex_arrays(1, &vao);
+	shader->destroy();
+}
+BENCHMARK(BM_UniformCachedHandle);
+
+// the Frame uniform block every reflected program shares: the whole FrameUniforms streamed and bound per camera
+void BM_UniformFrameBlock(benchmark::State &state) {
+	auto shader = make_uniform_program(state, BLOCK_VERTEX_SOURCE);
+	if (shader == nullptr)
+		return;
+	GLuint vao{0};
+	glGenVertexArrays(1, &vao);
+	StreamBuffer frame_uniforms(GL_UNIFORM_BUFFER);
+	FrameUniforms frame{};
+	frame.vp = glm::mat4(1.f);
+	int camera{0};
+	for (auto _: state) {
+		if (camera++ % CAMERAS_PER_FRAME == 0)
+			begin_stream_frame();
+		frame.vp[3][0] += 1e-6f;
+		auto offset = frame_uniforms.write(&frame, sizeof(FrameUniforms));
+		gl_state().bind_buffer_range(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, frame_uniforms.get_id(), offset,
+		                             sizeof(FrameUniforms));
+		draw_point(vao);
+	}
+	glFinish();
+	gl_state().delete_vertex_arrays(1, &vao);
+	shader->destroy();
+}
+BENCHMARK(BM_UniformFrameBlock);
+
+} // anonymous
@@ -0,0 +1,287 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Renders a synthetic scene of N meshes x M instances for a fixed number of frames and prints CPU frame time
+// percentiles, draw calls and upload volume as JSON, e.g.
+//   scene_benchmark --meshes 100 --instances 1000 --frames 600 --culling --output result.json
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <engine/render/camera/OrbitCam.h>
+#include <engine/render/instance_containers.h>
+#include <engine/render/Mesh.h>
+#include <engine/render/renderer.h>
+#include <engine/render/Shader.h>
+#include <fstream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+
+using namespace engine;
+
+namespace {
+
+const char *VERTEX_SOURCE = R"(#version 410 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 uv;
+layout(location = 3) in mat4 model;
+uniform mat4 vp;
+out vec3 frag_color;
+void main() {
+	frag_color = color;
+	gl_Position = vp * model * vec4(position, 1.0);
+}
+)";
+
+const char *FRAGMENT_SOURCE = R"(#version 410 core
+in vec3 frag_color;
+out vec4 out_color;
+void main() {
+	out_color = vec4(frag_color, 1.0);
+}
+)";
+
+struct Options {
+	int meshes{100};
+	int instances{100};
+	int frames{300};
+	int warmup{30};
+	// fraction of instances moved every frame
+	float dynamic{0.f};
+	bool culling{false};
+	bool pool{false};
+	bool threaded{false};
+	render::InitOptions init{800, 600, false, true, false};
+	std::string output;
+};
+
+void usage() {
+	std::cerr << "usage: scene_benchmark [--meshes N] [--instances M] [--frames F] [--warmup W] [--dynamic FRACTION]\n"
+	             "                       [--culling] [--pool] [--threaded] [--visible] [--osmesa]\n"
+	             "                       [--size WIDTHxHEIGHT] [--output FILE]" << std::endl;
+}
+
+bool parse(int argc, char **argv, Options &options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+		const char *v{nullptr};
+		if (arg == "--culling")
+			options.culling = true;
+		else if (arg == "--pool")
+			options.pool = true;
+		else if (arg == "--threaded")
+			options.threaded = true;
+		else if (arg == "--visible")
+			options.init.headless = false;
+		else if (arg == "--osmesa")
+			options.init.osmesa = true;
+		else if ((v = value()) == nullptr)
+			return false;
+		else if (arg == "--meshes")
+			options.meshes = std::atoi(v);
+		else if (arg == "--instances")
+			options.instances = std::atoi(v);
+		else if (arg == "--frames")
+			options.frames = std::atoi(v);
+		else if (arg == "--warmup")
+			options.warmup = std::atoi(v);
+		else if (arg == "--dynamic")
+			options.dynamic = std::clamp(static_cast<float>(std::atof(v)), 0.f, 1.f);
+		else if (arg == "--size") {
+			if (std::sscanf(v, "%dx%d", &options.init.width, &options.init.height) != 2)
+				return false;
+		} else if (arg == "--output")
+			options.output = v;
+		else
+			return false;
+	}
+	return options.meshes > 0 && options.instances > 0 && options.frames > 0;
+}
+
+// unit cube with a distinct color per corner
+void add_cube(entt::registry &registry, entt::entity entity) {
+	std::vector<glm::vec3> vertices, colors;
+	for (int i = 0; i < 8; ++i) {
+		glm::vec3 corner(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+		vertices.push_back(corner - glm::vec3(0.5f));
+		colors.push_back(corner);
+	}
+	std::vector<unsigned int> indices{0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+	                                  2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+	registry.emplace<render::Mesh<>>(entity,
+	                                 std::make_shared<render::ArrayBuffer<glm::vec3>>(vertices),
+	                                 std::make_shared<render::ArrayBuffer<glm::vec3>>(colors),
+	                                 std::make_shared<render::ElementBuffer>(indices));
+}
+
+// instances of each mesh on a grid in the x/y plane, meshes stacked along z
+glm::mat4 instance_transform(int mesh, int instance, int side, float phase) {
+	auto x = static_cast<float>(instance % side) * 2.f - side;
+	auto y = static_cast<float>(instance / side) * 2.f - side;
+	auto z = static_cast<float>(mesh) * 2.f + std::sin(phase + instance) * 0.25f;
+	return glm::translate(glm::mat4(1.f), glm::vec3(x, y, z));
+}
+
+std::vector<entt::entity> build_scene(const Options &options) {
+	auto &registry = render::get_registry();
+	GLuint program = render::load_shader(VERTEX_SOURCE, FRAGMENT_SOURCE);
+	auto camera = registry.create();
+	auto side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(options.instances))));
+	registry.emplace<render::Camera::Ptr>(camera, std::make_shared<render::OrbitCam>(
+			glm::vec3(0, -1.5f * side, options.meshes + side), glm::vec3(0, 0, options.meshes)));
+	render::run_on_render_context([&] { registry.emplace<render::Shader>(camera, program); });
+
+	std::vector<entt::entity> meshes;
+	for (int m = 0; m < options.meshes; ++m) {
+		auto entity = registry.create();
+		add_cube(registry, entity);
+		std::vector<glm::mat4> transforms;
+		for (int i = 0; i < options.instances; ++i)
+			transforms.push_back(instance_transform(m, i, side, 0.f));
+		registry.patch<render::Mat4Instances>(entity, [&](render::Mat4Instances &instances) {
+			instances.set_data(transforms);
+		});
+		meshes.push_back(entity);
+	}
+	return meshes;
+}
+
+void move_instances(const Options &options, const std::vector<entt::entity> &meshes, int frame) {
+	auto &registry = render::get_registry();
+	auto moved = static_cast<int>(options.dynamic * options.instances);
+	if (moved == 0)
+		return;
+	auto side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(options.instances))));
+	for (int m = 0; m < static_cast<int>(meshes.size()); ++m) {
+		registry.patch<render::Mat4Instances>(meshes[m], [&](render::Mat4Instances &instances) {
+			for (int i = 0; i < moved; ++i)
+				instances.set_instance(i, instance_transform(m, i, side, frame * 0.1f));
+		});
+	}
+}
+
+double percentile(std::vector<double> sorted, double p) {
+	std::sort(sorted.begin(), sorted.end());
+	return sorted[static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5)];
+}
+
+} // anonymous
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!parse(argc, argv, options)) {
+		usage();
+		return 1;
+	}
+	if (!render::init(options.init)) {
+		std::cerr << "Error during renderer initialization. Exiting." << std::endl;
+		render::cleanup();
+		return 2;
+	}
+	if (options.pool)
+		render::enable_geometry_pool();
+	render::set_frustum_culling(options.culling);
+	if (options.threaded)
+		render::start_render_thread();
+
+	auto meshes = build_scene(options);
+	std::vector<double> frame_ms;
+	std::vector<double> draws;
+	std::vector<double> uploaded;
+	std::vector<double> binds, binds_avoided;
+	auto dt = std::chrono::nanoseconds(1'000'000'000 / 60);
+	for (int frame = 0; frame < options.warmup + options.frames; ++frame) {
+		auto bytes_before = render::get_bytes_uploaded();
+		auto start = std::chrono::steady_clock::now();
+		move_instances(options, meshes, frame);
+		render::clear_screen();
+		render::render(dt);
+		render::swap_buffers();
+		auto end = std::chrono::steady_clock::now();
+		if (frame < options.warmup)
+			continue;
+		frame_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		draws.push_back(render::get_queue_stats().draws);
+		uploaded.push_back(render::get_bytes_uploaded() - bytes_before);
+		auto state = render::get_gl_state_stats();
+		binds.push_back(state.issued);
+		binds_avoided.push_back(state.avoided);
+	}
+	render::stop_render_thread();
+	auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+
+	double total_ms{0};
+	for (auto ms: frame_ms)
+		total_ms += ms;
+	double total_draws{0}, total_bytes{0}, total_binds{0}, total_binds_avoided{0};
+	for (std::size_t i = 0; i < draws.size(); ++i) {
+		total_draws += draws[i];
+		total_bytes += uploaded[i];
+		total_binds += binds[i];
+		total_binds_avoided += binds_avoided[i];
+	}
+	nlohmann::json result{
+			{"renderer", renderer ? renderer : ""},
+			{"config", {
+					{"meshes", options.meshes},
+					{"instances", options.instances},
+					{"frames", options.frames},
+					{"warmup", options.warmup},
+					{"dynamic", options.dynamic},
+					{"culling", options.culling},
+					{"pool", options.pool},
+					{"threaded", options.threaded},
+					{"headless", options.init.headless},
+					{"width", options.init.width},
+					{"height", options.init.height}}},
+			{"frame_ms", {
+					{"mean", total_ms / frame_ms.size()},
+					{"p50", percentile(frame_ms, 0.50)},
+					{"p90", percentile(frame_ms, 0.90)},
+					{"p99", percentile(frame_ms, 0.99)},
+					{"max", percentile(frame_ms, 1.0)}}},
+			{"draw_calls_per_frame", total_draws / draws.size()},
+			{"gl_binds_per_frame", total_binds / binds.size()},
+			{"gl_binds_avoided_per_frame", total_binds_avoided / binds_avoided.size()},
+			{"bytes_uploaded_per_frame", total_bytes / uploaded.size()},
+			{"bytes_uploaded_total", total_bytes}};
+
+	if (options.output.empty())
+		std::cout << result.dump(2) << std::endl;
+	else {
+		std::ofstream file(options.output);
+		file << result.dump(2) << std::endl;
+		if (!file) {
+			std::cerr << "Could not write '" << options.output << "'" << std::endl;
+			render::cleanup();
+			return 3;
+		}
+	}
+	render::cleanup();
+	return 0;
+}
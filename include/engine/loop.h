@@ -0,0 +1,91 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_LOOP_H
+#define ENGINE_LOOP_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+
+namespace engine {
+
+struct LoopConfig {
+	// simulation always advances in steps of exactly this length, independent of the display rate
+	std::chrono::nanoseconds step{std::chrono::nanoseconds(1'000'000'000 / 60)};
+	// frame times are clamped to this before being accumulated so a stall (breakpoint, window drag, slow frame)
+	// slows the simulation down instead of making every following frame run ever more catch-up steps
+	std::chrono::nanoseconds max_frame_time{std::chrono::milliseconds(250)};
+};
+
+// wall clock frame times over the last FRAME_HISTORY frames plus totals since run() started
+struct FrameStats {
+	static constexpr std::size_t FRAME_HISTORY{1024};
+
+	std::size_t frames{0};
+	std::size_t steps{0};
+	std::size_t paused_frames{0};
+	// frame time thrown away by the max_frame_time clamp
+	std::chrono::nanoseconds dropped{0};
+	std::chrono::nanoseconds elapsed{0};
+	// part of elapsed spent in paused frames, when no steps run
+	std::chrono::nanoseconds paused{0};
+	std::chrono::nanoseconds mean{0};
+	std::chrono::nanoseconds min{0};
+	std::chrono::nanoseconds max{0};
+	std::chrono::nanoseconds p50{0};
+	std::chrono::nanoseconds p95{0};
+	std::chrono::nanoseconds p99{0};
+
+	// should sit at the configured step rate whenever the machine keeps up, paused time doesn't count
+	double steps_per_second() const {
+		auto seconds = std::chrono::duration<double>(elapsed - paused).count();
+		return seconds > 0 ? steps / seconds : 0;
+	}
+
+	double frames_per_second() const {
+		auto seconds = std::chrono::duration<double>(elapsed).count();
+		return seconds > 0 ? frames / seconds : 0;
+	}
+};
+
+// advance the game by one fixed step, interface::tick has already been called with the same step
+using SimulationCallback = std::function<void(std::chrono::nanoseconds step)>;
+
+// alpha in [0, 1) is how far the current time is between the last two simulated states, blend them by it
+// With render::start_render_thread() this runs on the simulation thread, GL work goes through
+// render::run_on_render_context
+using RenderCallback = std::function<void(float alpha)>;
+
+// Polls input, runs as many fixed steps as the elapsed time calls for, then renders, calls draw and swaps once
+// per frame until state::stop(). While state::is_paused() no steps run and no time accumulates, rendering continues.
+// render, state and interface must already be initialized. Returns the stats of the whole run, or empty ones with
+// the reason on std::cerr when config.step isn't positive
+FrameStats run(const SimulationCallback &simulate,
+               const RenderCallback &draw = nullptr,
+               const LoopConfig &config = {});
+
+// stats of the running (or last) loop, cheap enough to show every frame
+FrameStats get_frame_stats();
+
+} // namespace engine
+
+#endif //ENGINE_LOOP_H
@@ -0,0 +1,46 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_PARALLEL_H
+#define ENGINE_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+
+namespace engine {
+
+// half open range of item indices handed to one call of a parallel_for task
+using ParallelTask = std::function<void(std::size_t first, std::size_t last)>;
+
+// worker threads started by the first parallel_for, hardware_concurrency - 1 unless set before that. 0 runs
+// everything on the calling thread
+void set_worker_count(unsigned int count);
+
+unsigned int get_worker_count();
+
+// Split [0, count) into chunks of at least grain items and run task over them on the persistent workers and the
+// calling thread, returning once all are done. Calls from several threads take turns, calls from inside a task run
+// inline. The first exception thrown by task is rethrown here after the remaining chunks finish
+void parallel_for(std::size_t count, const ParallelTask &task, std::size_t grain = 1);
+
+} // namespace engine
+
+#endif //ENGINE_PARALLEL_H
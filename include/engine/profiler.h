@@ -0,0 +1,123 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_PROFILER_H
+#define ENGINE_PROFILER_H
+
+// Scoped CPU and GPU zones written to per thread ring buffers and dumped as Chrome trace-event JSON
+// (chrome://tracing or ui.perfetto.dev). Only built with -DENGINE_PROFILING, otherwise every ENGINE_PROFILE_*
+// macro expands to nothing and none of the functions below exist, so guard direct calls the same way.
+//   ENGINE_PROFILE_ZONE("physics");       // CPU time until the end of the enclosing scope
+//   ENGINE_PROFILE_GPU_ZONE("shadows");   // GPU time of the GL commands issued in the scope, context thread only
+//   ENGINE_PROFILE_FRAME();               // once per frame after the swap, resolves GPU zones from a few frames ago
+#ifdef ENGINE_PROFILING
+
+#include <cstdint>
+#include <string>
+
+
+namespace engine::profiler {
+
+// nanoseconds since the profiler's epoch
+struct ZoneEvent {
+	const char *name;
+	std::uint64_t start;
+	std::uint64_t end;
+	std::uint32_t depth;
+};
+
+std::uint64_t now();
+
+// name must outlive the profiler, string literals are expected
+void begin_zone(const char *name);
+
+void end_zone();
+
+void begin_gpu_zone(const char *name);
+
+void end_gpu_zone();
+
+void new_frame();
+
+// label for the calling thread in the trace
+void set_thread_name(const std::string &name);
+
+// threads hand their events over once per frame, so another thread's current frame only shows up once it has
+// recorded something in the next one (or exited)
+bool write_chrome_trace(const std::string &path);
+
+// drop every recorded event
+void clear();
+
+// delete the GPU queries, call while the context is still current
+void shutdown();
+
+class ScopedZone {
+public:
+	explicit ScopedZone(const char *name) {
+		begin_zone(name);
+	}
+
+	~ScopedZone() {
+		end_zone();
+	}
+
+	ScopedZone(const ScopedZone&) = delete;
+
+	ScopedZone& operator=(const ScopedZone&) = delete;
+};
+
+class ScopedGpuZone {
+public:
+	explicit ScopedGpuZone(const char *name) {
+		begin_gpu_zone(name);
+	}
+
+	~ScopedGpuZone() {
+		end_gpu_zone();
+	}
+
+	ScopedGpuZone(const ScopedGpuZone&) = delete;
+
+	ScopedGpuZone& operator=(const ScopedGpuZone&) = delete;
+};
+
+} // namespace engine::profiler
+
+#define ENGINE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ENGINE_PROFILE_CONCAT(a, b) ENGINE_PROFILE_CONCAT_IMPL(a, b)
+#define ENGINE_PROFILE_ZONE(name) ::engine::profiler::ScopedZone ENGINE_PROFILE_CONCAT(profile_zone_, __LINE__){name}
+#define ENGINE_PROFILE_GPU_ZONE(name) \
+	::engine::profiler::ScopedGpuZone ENGINE_PROFILE_CONCAT(profile_gpu_zone_, __LINE__){name}
+#define ENGINE_PROFILE_FRAME() ::engine::profiler::new_frame()
+#define ENGINE_PROFILE_THREAD(name) ::engine::profiler::set_thread_name(name)
+#define ENGINE_PROFILE_SHUTDOWN() ::engine::profiler::shutdown()
+
+#else
+
+#define ENGINE_PROFILE_ZONE(name) ((void) 0)
+#define ENGINE_PROFILE_GPU_ZONE(name) ((void) 0)
+#define ENGINE_PROFILE_FRAME() ((void) 0)
+#define ENGINE_PROFILE_THREAD(name) ((void) 0)
+#define ENGINE_PROFILE_SHUTDOWN() ((void) 0)
+
+#endif //ENGINE_PROFILING
+
+#endif //ENGINE_PROFILER_H
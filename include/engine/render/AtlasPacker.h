@@ -0,0 +1,61 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_ATLASPACKER_H
+#define ENGINE_ATLASPACKER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+
+namespace engine::render {
+
+// Skyline bottom-left rectangle packer. Tracks the top edge of everything placed so far as a list of horizontal
+// segments and puts each new rectangle where it ends up lowest, which wastes little space on glyph-like sizes
+class AtlasPacker {
+public:
+	AtlasPacker(int width, int height);
+
+	// find a spot for a width x height rectangle, false when it doesn't fit anywhere
+	bool pack(int width, int height, glm::ivec2 &position);
+
+	int get_width() const {
+		return m_width;
+	}
+
+	int get_height() const {
+		return m_height;
+	}
+
+private:
+	struct Segment {
+		int x, y, width;
+	};
+
+	int m_width, m_height;
+	std::vector<Segment> m_skyline;
+
+	// lowest y a rectangle starting at segment index can sit at, or -1 if it runs off the atlas
+	int fit(std::size_t index, int width, int height) const;
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_ATLASPACKER_H
@@ -23,26 +23,42 @@ SOFTWARE.
 
 #include <engine/render/Glyph.h>
 #include <engine/render/Font.h>
+#include <engine/render/GLState.h>
 #include <engine/render/renderer.h>
 #include <fmt/format.h>
 #include <GL/glew.h>
 #include <iostream>
 #include <map>
 #include <nlohmann/json.hpp>
+#include <utility>
+#include <utils/macros.h>
 
 
 namespace engine::render {
 
 class Font {
 public:
+	USEPTR(Font);
+
 	Font(const FT_Library& ft, const nlohmann::json& data) {
 		// enable blending for text transparency
-		glEnable(GL_BLEND);
+		gl_state().enable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		m_glyphs = load_font(ft, data["path"], data["size"]);
 		if(m_glyphs.empty())
 			throw fmt::format("Could not initialize font from '{}'", data["path"]);
 	}
+
+	explicit Font(std::map<unsigned long, Glyph> glyphs) : m_glyphs(std::move(glyphs)) {}
+
+	const std::map<unsigned long, Glyph> &get_glyphs() const {
+		return m_glyphs;
+	}
+
+	// every glyph lives in the same atlas texture
+	GLuint get_atlas() const {
+		return m_glyphs.empty() ? 0 : m_glyphs.begin()->second.tex_id;
+	}
 private:
 	std::map<unsigned long, Glyph> m_glyphs;
 };
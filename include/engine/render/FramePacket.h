@@ -0,0 +1,80 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_FRAMEPACKET_H
+#define ENGINE_FRAMEPACKET_H
+
+#include <chrono>
+#include <cstdint>
+#include <engine/render/GeometryPool.h>
+#include <engine/render/RenderQueue.h>
+#include <engine/render/TextRenderer.h>
+#include <engine/render/uniforms.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+
+namespace engine::render {
+
+// one instanced draw, its instance transforms are copied into FramePacket::transforms
+struct PacketDraw {
+	std::uint64_t key;
+	DrawCommand command;
+	// location of the first mat4 column attribute in command.vao
+	GLuint instance_attribute;
+	std::size_t first_transform;
+	// pooled meshes go through the geometry pool with this range instead of command.vao
+	bool pooled;
+	GeometryRange range;
+};
+
+// everything one camera draws
+struct PacketView {
+	FrameUniforms frame;
+	GLuint program;
+	GLint vp_location;
+	GLint tex0_location;
+	std::size_t first_draw;
+	std::size_t draw_count;
+};
+
+// A frame as plain data: built from the registry on the simulation thread, then only read by the render thread,
+// which issues it without going back to the registry
+struct FramePacket {
+	std::chrono::nanoseconds dt{0};
+	float alpha{1.f};
+	std::vector<PacketView> views;
+	std::vector<PacketDraw> draws;
+	std::vector<glm::mat4> transforms;
+	glm::mat4 screen_projection{1.f};
+	std::vector<GlyphBatch> text;
+
+	// keeps vector capacity so steady state frames don't allocate
+	void clear() {
+		views.clear();
+		draws.clear();
+		transforms.clear();
+	}
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_FRAMEPACKET_H
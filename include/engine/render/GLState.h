@@ -0,0 +1,291 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_GLSTATE_H
+#define ENGINE_GLSTATE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <GL/glew.h>
+
+
+namespace engine::render {
+
+// binding changes passed on to the driver and skipped because they were already in effect
+struct GLStateStats {
+	std::size_t issued{0};
+	std::size_t avoided{0};
+	std::size_t programs_avoided{0};
+	std::size_t vertex_arrays_avoided{0};
+	std::size_t buffers_avoided{0};
+	std::size_t textures_avoided{0};
+	std::size_t capabilities_avoided{0};
+};
+
+// Shadow copy of the GL binding state engine code changes (program, VAO, buffer per target, texture per unit and
+// target, enable bits), so re-binding what is already bound costs a compare instead of a driver call. Everything
+// starts out unknown and the first call for each piece of state always goes through. Only valid on the thread
+// owning the context, and only while all engine GL binds and deletes go through here: code issuing its own calls
+// must invalidate() afterwards. The last drawn VAO stays bound, so bind one (or 0) before touching
+// GL_ELEMENT_ARRAY_BUFFER, which is VAO state
+class GLState {
+public:
+	void use_program(GLuint program) {
+		if (program == m_program) {
+			avoided(m_stats.programs_avoided);
+			return;
+		}
+		m_program = program;
+		++m_stats.issued;
+		glUseProgram(program);
+	}
+
+	void bind_vertex_array(GLuint vao) {
+		if (vao == m_vertex_array) {
+			avoided(m_stats.vertex_arrays_avoided);
+			return;
+		}
+		m_vertex_array = vao;
+		// the element buffer binding belongs to the VAO
+		m_buffers[buffer_slot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+		++m_stats.issued;
+		glBindVertexArray(vao);
+	}
+
+	void bind_buffer(GLenum target, GLuint buffer) {
+		auto slot = buffer_slot(target);
+		if (slot < m_buffers.size()) {
+			if (m_buffers[slot] == buffer) {
+				avoided(m_stats.buffers_avoided);
+				return;
+			}
+			m_buffers[slot] = buffer;
+		}
+		++m_stats.issued;
+		glBindBuffer(target, buffer);
+	}
+
+	// never skipped since the range differs from call to call, but it also binds the generic target
+	void bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		auto slot = buffer_slot(target);
+		if (slot < m_buffers.size())
+			m_buffers[slot] = buffer;
+		++m_stats.issued;
+		glBindBufferRange(target, index, buffer, offset, size);
+	}
+
+	// unit as GL_TEXTURE0 + n
+	void active_texture(GLenum unit) {
+		if (unit == m_active_unit) {
+			avoided(m_stats.textures_avoided);
+			return;
+		}
+		m_active_unit = unit;
+		++m_stats.issued;
+		glActiveTexture(unit);
+	}
+
+	// binds to the active unit
+	void bind_texture(GLenum target, GLuint texture) {
+		auto unit = static_cast<std::size_t>(m_active_unit - GL_TEXTURE0);
+		auto slot = texture_slot(target);
+		if (m_active_unit != UNKNOWN && unit < MAX_UNITS && slot < TEXTURE_TARGETS) {
+			auto &bound = m_textures[unit][slot];
+			if (bound == texture) {
+				avoided(m_stats.textures_avoided);
+				return;
+			}
+			bound = texture;
+		}
+		++m_stats.issued;
+		glBindTexture(target, texture);
+	}
+
+	void bind_texture(GLenum unit, GLenum target, GLuint texture) {
+		active_texture(unit);
+		bind_texture(target, texture);
+	}
+
+	void set_enabled(GLenum capability, bool enabled) {
+		auto slot = capability_slot(capability);
+		if (slot < m_capabilities.size()) {
+			auto value = static_cast<std::uint8_t>(enabled);
+			if (m_capabilities[slot] == value) {
+				avoided(m_stats.capabilities_avoided);
+				return;
+			}
+			m_capabilities[slot] = value;
+		}
+		++m_stats.issued;
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+	}
+
+	void enable(GLenum capability) {
+		set_enabled(capability, true);
+	}
+
+	void disable(GLenum capability) {
+		set_enabled(capability, false);
+	}
+
+	// answered from the cache once known, so saving and restoring around a pass never stalls
+	bool is_enabled(GLenum capability) {
+		auto slot = capability_slot(capability);
+		if (slot >= m_capabilities.size())
+			return glIsEnabled(capability);
+		if (m_capabilities[slot] == UNKNOWN_CAPABILITY)
+			m_capabilities[slot] = glIsEnabled(capability) ? 1 : 0;
+		return m_capabilities[slot] == 1;
+	}
+
+	// deleting a bound name reverts its bindings to 0, and the name may be handed out again right after
+	void delete_buffers(GLsizei count, const GLuint *buffers) {
+		for (GLsizei i = 0; i < count; ++i)
+			for (auto &bound: m_buffers)
+				if (bound == buffers[i])
+					bound = 0;
+		glDeleteBuffers(count, buffers);
+	}
+
+	void delete_vertex_arrays(GLsizei count, const GLuint *vaos) {
+		for (GLsizei i = 0; i < count; ++i)
+			if (vaos[i] == m_vertex_array) {
+				m_vertex_array = 0;
+				m_buffers[buffer_slot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+			}
+		glDeleteVertexArrays(count, vaos);
+	}
+
+	void delete_textures(GLsizei count, const GLuint *textures) {
+		for (GLsizei i = 0; i < count; ++i)
+			for (auto &unit: m_textures)
+				for (auto &bound: unit)
+					if (bound == textures[i])
+						bound = 0;
+		glDeleteTextures(count, textures);
+	}
+
+	// a deleted program stays in use until replaced, so only forget it in case the name comes back
+	void delete_program(GLuint program) {
+		if (program == m_program)
+			m_program = UNKNOWN;
+		glDeleteProgram(program);
+	}
+
+	// forget everything, e.g. after a new context or code that binds behind the cache's back
+	void invalidate() {
+		m_program = UNKNOWN;
+		m_vertex_array = UNKNOWN;
+		m_active_unit = UNKNOWN;
+		m_buffers.fill(UNKNOWN);
+		for (auto &unit: m_textures)
+			unit.fill(UNKNOWN);
+		m_capabilities.fill(UNKNOWN_CAPABILITY);
+	}
+
+	// counts since the last call
+	GLStateStats take_stats() {
+		auto stats = m_stats;
+		m_stats = {};
+		return stats;
+	}
+
+private:
+	static constexpr GLuint UNKNOWN{~0u};
+	static constexpr std::uint8_t UNKNOWN_CAPABILITY{2};
+	static constexpr std::size_t MAX_UNITS{16};
+	static constexpr std::size_t TEXTURE_TARGETS{4};
+
+	GLuint m_program{UNKNOWN};
+	GLuint m_vertex_array{UNKNOWN};
+	GLenum m_active_unit{UNKNOWN};
+	std::array<GLuint, 10> m_buffers{filled<10>(UNKNOWN)};
+	std::array<std::array<GLuint, TEXTURE_TARGETS>, MAX_UNITS> m_textures{
+			filled<MAX_UNITS>(filled<TEXTURE_TARGETS>(UNKNOWN))};
+	std::array<std::uint8_t, 8> m_capabilities{filled<8>(UNKNOWN_CAPABILITY)};
+	GLStateStats m_stats;
+
+	template <std::size_t N, typename T>
+	static constexpr std::array<T, N> filled(T value) {
+		std::array<T, N> values{};
+		values.fill(value);
+		return values;
+	}
+
+	void avoided(std::size_t &kind) {
+		++m_stats.avoided;
+		++kind;
+	}
+
+	// out of range for targets that aren't tracked, those always go through
+	static std::size_t buffer_slot(GLenum target) {
+		switch (target) {
+			case GL_ARRAY_BUFFER: return 0;
+			case GL_ELEMENT_ARRAY_BUFFER: return 1;
+			case GL_COPY_READ_BUFFER: return 2;
+			case GL_COPY_WRITE_BUFFER: return 3;
+			case GL_PIXEL_PACK_BUFFER: return 4;
+			case GL_PIXEL_UNPACK_BUFFER: return 5;
+			case GL_UNIFORM_BUFFER: return 6;
+			case GL_DRAW_INDIRECT_BUFFER: return 7;
+			case GL_TEXTURE_BUFFER: return 8;
+			case GL_TRANSFORM_FEEDBACK_BUFFER: return 9;
+			default: return ~std::size_t{0};
+		}
+	}
+
+	static std::size_t texture_slot(GLenum target) {
+		switch (target) {
+			case GL_TEXTURE_2D: return 0;
+			case GL_TEXTURE_2D_ARRAY: return 1;
+			case GL_TEXTURE_CUBE_MAP: return 2;
+			case GL_TEXTURE_3D: return 3;
+			default: return ~std::size_t{0};
+		}
+	}
+
+	static std::size_t capability_slot(GLenum capability) {
+		switch (capability) {
+			case GL_BLEND: return 0;
+			case GL_DEPTH_TEST: return 1;
+			case GL_CULL_FACE: return 2;
+			case GL_SCISSOR_TEST: return 3;
+			case GL_STENCIL_TEST: return 4;
+			case GL_POLYGON_OFFSET_FILL: return 5;
+			case GL_RASTERIZER_DISCARD: return 6;
+			case GL_FRAMEBUFFER_SRGB: return 7;
+			default: return ~std::size_t{0};
+		}
+	}
+};
+
+// the state of the one engine context, touched only from whichever thread currently owns it
+inline GLState &gl_state() {
+	static GLState state;
+	return state;
+}
+
+} // namespace engine::render
+
+#endif //ENGINE_GLSTATE_H
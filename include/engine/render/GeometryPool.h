@@ -0,0 +1,170 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_GEOMETRYPOOL_H
+#define ENGINE_GEOMETRYPOOL_H
+
+#include <engine/render/buffer_objects.h>
+#include <engine/render/instance_formats.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+// where a mesh lives inside the pool, stored alongside Mesh<> in the render registry
+struct GeometryRange {
+	GLuint base_vertex{0};
+	GLuint vertex_count{0};
+	GLuint first_index{0};
+	GLuint index_count{0};
+};
+
+// layout fixed by the GL spec for indirect draws
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+// first fit allocator over a sorted list of free [offset, offset + size) blocks, grows at the end when nothing fits
+class RangeAllocator {
+public:
+	GLuint allocate(GLuint size);
+
+	void release(GLuint offset, GLuint size);
+
+	// one past the highest element ever handed out
+	GLuint end() const {
+		return m_end;
+	}
+
+private:
+	struct Block {
+		GLuint offset;
+		GLuint size;
+	};
+
+	std::vector<Block> m_free;
+	GLuint m_end{0};
+};
+
+// Sub-allocates the vertices and indices of many meshes out of shared buffers behind a single VAO so a frame's
+// worth of instanced draws can go out as one glMultiDrawElementsIndirect per texture. Attribute locations match
+// Mesh<> (position, color, uv, then the renderer's instance format) so the same shaders work with both.
+// Contexts without ARB_multi_draw_indirect loop over the commands instead, re-pointing the instance attributes
+// per draw when base instance isn't available either (4.1 core).
+class GeometryPool {
+public:
+	USEPTR(GeometryPool);
+
+	GeometryPool();
+
+	virtual ~GeometryPool();
+
+	GeometryPool(const GeometryPool&) = delete;
+
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// colors and uvs may be empty, missing attributes are zero filled
+	GeometryRange add(const std::vector<glm::vec3> &vertices,
+	                  const std::vector<glm::vec3> &colors,
+	                  const std::vector<glm::vec2> &uvs,
+	                  const std::vector<unsigned int> &indices);
+
+	// rewrite geometry in place when it still fits, otherwise move it and return the new range
+	GeometryRange update(const GeometryRange &range,
+	                     const std::vector<glm::vec3> &vertices,
+	                     const std::vector<glm::vec3> &colors,
+	                     const std::vector<glm::vec2> &uvs,
+	                     const std::vector<unsigned int> &indices);
+
+	void remove(const GeometryRange &range);
+
+	// queue count instances of range to be drawn by the next submit
+	void draw(const GeometryRange &range, GLenum mode, GLuint texture, const glm::mat4 *transforms, std::size_t count);
+
+	// issue all queued draws and clear them, expects the program to be bound
+	void submit();
+
+	bool empty() const {
+		return m_draws.empty();
+	}
+
+	// how queued transforms are streamed to the instance attributes, from location 3 on
+	void set_instance_format(InstanceFormat format) {
+		m_instance_format = format;
+	}
+
+	InstanceFormat get_instance_format() const {
+		return m_instance_format;
+	}
+
+	// GL draw calls made by the last submit
+	std::size_t get_draw_calls() const {
+		return m_draw_calls;
+	}
+
+	// indirect commands consumed by the last submit
+	std::size_t get_command_count() const {
+		return m_command_count;
+	}
+
+private:
+	struct PendingDraw {
+		GLenum mode;
+		GLuint texture;
+		DrawElementsIndirectCommand command;
+	};
+
+	GLuint m_vao{0};
+	GLuint m_positions{0}, m_colors{0}, m_uvs{0}, m_indices{0};
+	GLuint m_vertex_capacity{0}, m_index_capacity{0};
+	RangeAllocator m_vertex_allocator, m_index_allocator;
+	StreamBuffer m_instance_buffer{GL_ARRAY_BUFFER};
+	StreamBuffer m_indirect_buffer{GL_DRAW_INDIRECT_BUFFER};
+	std::vector<glm::mat4> m_transforms;
+	InstanceFormat m_instance_format{InstanceFormat::mat4};
+	std::vector<std::uint8_t> m_packed;
+	std::vector<PendingDraw> m_draws;
+	std::vector<DrawElementsIndirectCommand> m_commands;
+	std::size_t m_draw_calls{0};
+	std::size_t m_command_count{0};
+
+	void reserve(GLuint vertex_count, GLuint index_count);
+
+	void write(const GeometryRange &range,
+	           const std::vector<glm::vec3> &vertices,
+	           const std::vector<glm::vec3> &colors,
+	           const std::vector<glm::vec2> &uvs,
+	           const std::vector<unsigned int> &indices);
+
+	void bind_vertex_attributes();
+
+	void bind_instance_attributes(GLintptr offset);
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_GEOMETRYPOOL_H
@@ -30,10 +30,13 @@ SOFTWARE.
 
 namespace engine::render {
 struct Glyph {
+	// atlas texture shared by every glyph of the font
 	unsigned int tex_id;
 	glm::ivec2 size;
 	glm::ivec2 bearing;
 	long advance;
+	// (u0, v0, u1, v1) of the glyph inside the atlas
+	glm::vec4 uv{0};
 };
 } // namespace engine::render
 
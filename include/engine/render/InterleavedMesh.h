@@ -0,0 +1,135 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_INTERLEAVEDMESH_H
+#define ENGINE_INTERLEAVEDMESH_H
+
+#include <cstdint>
+#include <cstring>
+#include <engine/render/buffer_objects.h>
+#include <engine/render/vertex_format.h>
+#include <engine/render/VertexArrayObject.h>
+#include <glm/glm.hpp>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace engine::render {
+
+// Mesh variant keeping every vertex attribute in a single buffer, laid out as VertexLayout<Vertex> describes, so a
+// vertex is one fetch and the VAO one buffer binding. The vertex type is only known to the templated setters so
+// meshes of different formats share a component type in the render registry. The first field is the position and
+// has to be floats for bounds to be computed (culling, LOD)
+class InterleavedMesh : public VertexArrayObject {
+public:
+	USEPTR(InterleavedMesh);
+
+	InterleavedMesh() : m_vertices(std::make_shared<ArrayBuffer<std::uint8_t>>()),
+	                    m_indices(std::make_shared<ElementBuffer>()) {}
+
+	template <typename Vertex>
+	InterleavedMesh(const std::vector<Vertex> &vertices, std::vector<unsigned int> indices) : InterleavedMesh() {
+		set_vertices(vertices);
+		m_indices->set_data(std::move(indices));
+	}
+
+	template <typename Vertex>
+	void set_vertices(const std::vector<Vertex> &vertices) {
+		static_assert(std::is_trivially_copyable_v<Vertex>);
+		m_stride = sizeof(Vertex);
+		m_attributes.assign(VertexLayout<Vertex>::attributes.begin(), VertexLayout<Vertex>::attributes.end());
+		std::vector<std::uint8_t> bytes(vertices.size() * sizeof(Vertex));
+		if (!bytes.empty())
+			std::memcpy(bytes.data(), vertices.data(), bytes.size());
+		m_vertices->set_data(std::move(bytes));
+	}
+
+	// only marks the changed vertex for the next update, patch the component to send it
+	template <typename Vertex>
+	void set_vertex(std::size_t index, const Vertex &vertex) {
+		if (sizeof(Vertex) != static_cast<std::size_t>(m_stride))
+			throw std::invalid_argument("Vertex type does not match the mesh's format");
+		std::vector<std::uint8_t> bytes(sizeof(Vertex));
+		std::memcpy(bytes.data(), &vertex, sizeof(Vertex));
+		m_vertices->set_elements(index * sizeof(Vertex), bytes);
+	}
+
+	template <typename Vertex>
+	Vertex get_vertex(std::size_t index) const {
+		Vertex vertex;
+		std::memcpy(&vertex, &m_vertices->get_data_vector()[index * sizeof(Vertex)], sizeof(Vertex));
+		return vertex;
+	}
+
+	std::size_t get_vertex_count() const {
+		return m_stride > 0 ? m_vertices->get_data_vector().size() / m_stride : 0;
+	}
+
+	// decoded from the first attribute, empty when it isn't made of floats
+	std::vector<glm::vec3> get_positions() const {
+		std::vector<glm::vec3> positions;
+		if (m_attributes.empty() || m_attributes[0].type != GL_FLOAT || m_attributes[0].integer)
+			return positions;
+		auto components = std::min<GLint>(m_attributes[0].components, 3);
+		const auto *data = m_vertices->get_data_vector().data() + m_attributes[0].offset;
+		positions.resize(get_vertex_count(), glm::vec3(0));
+		for (auto &position: positions) {
+			std::memcpy(&position, data, components * sizeof(float));
+			data += m_stride;
+		}
+		return positions;
+	}
+
+	const std::vector<AttributeFormat> &get_attribute_formats() const {
+		return m_attributes;
+	}
+
+	GLsizei get_stride() const {
+		return m_stride;
+	}
+
+	// the same buffer once per attribute
+	std::vector<std::pair<BufferObject::Ptr, VertexAttribute>> get_attribute_buffers() override {
+		std::vector<std::pair<BufferObject::Ptr, VertexAttribute>> buffers;
+		for (const auto &format: m_attributes)
+			buffers.emplace_back(m_vertices, format.to_attribute(m_stride));
+		return buffers;
+	}
+
+	ElementBuffer::Ptr get_element_buffer() override {
+		return m_indices;
+	}
+
+	ArrayBuffer<std::uint8_t>::Ptr get_vertex_buffer() {
+		return m_vertices;
+	}
+
+private:
+	ArrayBuffer<std::uint8_t>::Ptr m_vertices;
+	ElementBuffer::Ptr m_indices;
+	GLsizei m_stride{0};
+	std::vector<AttributeFormat> m_attributes;
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_INTERLEAVEDMESH_H
@@ -0,0 +1,137 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_MAPPEDMESH_H
+#define ENGINE_MAPPEDMESH_H
+
+#include <engine/render/buffer_objects.h>
+#include <engine/render/glm_attributes.h>
+#include <engine/render/mesh_asset.h>
+#include <engine/render/RenderQueue.h>
+#include <engine/render/VertexArrayObject.h>
+#include <GL/glew.h>
+#include <utility>
+#include <vector>
+
+
+namespace engine::render {
+
+// buffer whose contents are a section of a mapped asset, uploads straight from the mapped pages
+class MappedBuffer : public BufferObject {
+public:
+	USEPTR(MappedBuffer);
+
+	MappedBuffer(GLenum target, MeshAsset::Ptr asset, const MeshAssetSection &section)
+			: BufferObject(target), m_asset(std::move(asset)), m_section(section) {}
+
+	GLsizeiptr get_byte_size() override {
+		return static_cast<GLsizeiptr>(m_section.size);
+	}
+
+	const void* get_data() override {
+		return m_asset->get_section(m_section);
+	}
+
+private:
+	MeshAsset::Ptr m_asset;
+	MeshAssetSection m_section;
+};
+
+// index section of a mapped asset, already in the asset's index type. There is no CPU side vector to edit
+struct MappedElementBuffer : public ElementBuffer {
+	USEPTR(MappedElementBuffer);
+
+	MappedElementBuffer(MeshAsset::Ptr asset, const MeshAssetSection &section)
+			: m_asset(std::move(asset)), m_section(section) {
+		set_index_type(m_asset->get_header().index_type);
+	}
+
+	GLsizeiptr get_byte_size() override {
+		return static_cast<GLsizeiptr>(m_section.size);
+	}
+
+	const void* get_data() override {
+		return m_asset->get_section(m_section);
+	}
+
+	GLuint count() override {
+		return static_cast<GLuint>(m_section.size / index_size(get_index_type()));
+	}
+
+private:
+	MeshAsset::Ptr m_asset;
+	MeshAssetSection m_section;
+};
+
+// Static mesh drawn straight from a MeshAsset, same attribute locations as Mesh<>. Emplacing one in the render
+// registry uploads the mapped streams without building any vectors, bounds come from the asset and a stored LOD
+// table is used as is. Never pooled, and there is nothing to update: remove the component and emplace a new one to
+// change the mesh, replacing it in place is not supported
+class MappedMesh : public VertexArrayObject {
+public:
+	USEPTR(MappedMesh);
+
+	// a null asset (MeshAsset::open failed) gives an empty mesh the renderer skips
+	explicit MappedMesh(MeshAsset::Ptr asset) : m_asset(std::move(asset)) {
+		if (m_asset == nullptr)
+			return;
+		const auto &header = m_asset->get_header();
+		m_positions = std::make_shared<MappedBuffer>(GL_ARRAY_BUFFER, m_asset, header.positions);
+		m_colors = std::make_shared<MappedBuffer>(GL_ARRAY_BUFFER, m_asset, header.colors);
+		m_uvs = std::make_shared<MappedBuffer>(GL_ARRAY_BUFFER, m_asset, header.uvs);
+		m_indices = std::make_shared<MappedElementBuffer>(m_asset, header.indices);
+	}
+
+	std::vector<std::pair<BufferObject::Ptr, VertexAttribute>> get_attribute_buffers() override {
+		return {
+				std::pair<BufferObject::Ptr, VertexAttribute>{m_positions, Vec3Attribute()},
+				std::pair<BufferObject::Ptr, VertexAttribute>{m_colors, Vec3Attribute()},
+				std::pair<BufferObject::Ptr, VertexAttribute>{m_uvs, Vec2Attribute()}
+		};
+	}
+
+	ElementBuffer::Ptr get_element_buffer() override {
+		return m_indices;
+	}
+
+	// indices of the stored LOD levels, nullptr without a LOD table
+	ElementBuffer::Ptr get_lod_elements() const {
+		if (m_asset == nullptr || m_asset->get_header().lod_count == 0)
+			return nullptr;
+		return std::make_shared<MappedElementBuffer>(m_asset, m_asset->get_header().lod_indices);
+	}
+
+	const MeshAsset::Ptr &get_asset() const {
+		return m_asset;
+	}
+
+	bool empty() const {
+		return m_asset == nullptr;
+	}
+
+private:
+	MeshAsset::Ptr m_asset;
+	MappedBuffer::Ptr m_positions, m_colors, m_uvs;
+	MappedElementBuffer::Ptr m_indices;
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_MAPPEDMESH_H
@@ -62,6 +62,15 @@ public:
 			  m_tex_coords(std::move(m_tex_coords)),
 			  m_indices(std::move(index_buffer)) {}
 
+	Mesh(VertexBufferType::Ptr vert_buffer,
+	     ColorBufferType::Ptr color_buffer,
+	     TexCoordBufferType::Ptr tex_coord_buffer,
+	     ElementBuffer::Ptr index_buffer)
+			: m_vert_coords(std::move(vert_buffer)),
+			  m_colors(std::move(color_buffer)),
+			  m_tex_coords(std::move(tex_coord_buffer)),
+			  m_indices(std::move(index_buffer)) {}
+
 	std::vector<std::pair<BufferObject::Ptr, VertexAttribute>> get_attribute_buffers() override {
 		return {
 				std::pair<BufferObject::Ptr, VertexAttribute>{m_vert_coords, Vec3Attribute()},
@@ -86,16 +95,11 @@ public:
 		return m_tex_coords;
 	}
 
-	GLuint *get_texture() {
-		return &m_texture;
-	}
-
 protected:
 	VertexBufferType::Ptr m_vert_coords;
 	ColorBufferType::Ptr m_colors;
 	TexCoordBufferType::Ptr m_tex_coords;
 	ElementBuffer::Ptr m_indices;
-	GLuint m_texture{0};
 
 private:
 	GLuint m_id{0};
@@ -0,0 +1,86 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_PROGRAMCACHE_H
+#define ENGINE_PROGRAMCACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <GL/glew.h>
+#include <string>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+struct ProgramCacheStats {
+	std::size_t hits{0};
+	std::size_t misses{0};
+	// time spent restoring binaries and compiling from source respectively
+	std::chrono::nanoseconds hit_time{0};
+	std::chrono::nanoseconds miss_time{0};
+
+	// what the hits would have cost at the average compile time of the misses
+	std::chrono::nanoseconds estimated_time_saved() const {
+		if (misses == 0)
+			return std::chrono::nanoseconds{0};
+		return (miss_time / misses) * hits - hit_time;
+	}
+};
+
+// Stores linked program binaries on disk keyed by a hash of every stage source and the driver's
+// vendor/renderer/version strings, so a driver update or source edit simply misses. Needs a current context
+class ProgramCache {
+public:
+	USEPTR(ProgramCache);
+
+	explicit ProgramCache(std::filesystem::path directory);
+
+	// false when the driver exposes no binary formats, every load then misses and nothing is stored
+	bool is_supported() const {
+		return m_supported;
+	}
+
+	std::uint64_t make_key(const std::vector<const char*> &sources) const;
+
+	// returns a linked program or 0 on miss/mismatch
+	GLuint load(std::uint64_t key);
+
+	// program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	void store(std::uint64_t key, GLuint program, std::chrono::nanoseconds compile_time);
+
+	const ProgramCacheStats &get_stats() const {
+		return m_stats;
+	}
+
+private:
+	std::filesystem::path m_directory;
+	std::string m_driver;
+	bool m_supported{false};
+	ProgramCacheStats m_stats;
+
+	std::filesystem::path path_for(std::uint64_t key) const;
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_PROGRAMCACHE_H
@@ -0,0 +1,149 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_RENDERQUEUE_H
+#define ENGINE_RENDERQUEUE_H
+
+#include <cstdint>
+#include <engine/render/GLState.h>
+#include <GL/glew.h>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+// everything needed to issue one instanced draw
+struct DrawCommand {
+	GLuint program;
+	GLuint texture;
+	GLuint vao;
+	GLenum mode;
+	GLsizei count;
+	GLenum index_type;
+	GLsizei instances;
+	// offset into the element buffer in indices, e.g. where a LOD level starts
+	GLuint first_index{0};
+};
+
+inline std::size_t index_size(GLenum index_type) {
+	switch (index_type) {
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+// state changes issued and skipped by the last submit
+struct QueueStats {
+	std::size_t draws{0};
+	std::size_t program_binds{0};
+	std::size_t texture_binds{0};
+	std::size_t vao_binds{0};
+	std::size_t program_binds_saved{0};
+	std::size_t texture_binds_saved{0};
+	std::size_t vao_binds_saved{0};
+};
+
+// Draws are pushed with a packed 64 bit sort key, radix sorted and submitted so runs sharing the same program,
+// texture or VAO only bind it once. Key layout from most to least significant:
+// pass (4 bits) | program (12) | texture (16) | vao (16) | depth (16).
+// GL names wider than their field are truncated which can interleave groups but never changes what is drawn.
+class RenderQueue {
+public:
+	USEPTR(RenderQueue);
+
+	static std::uint64_t make_key(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth);
+
+	void push(std::uint64_t key, const DrawCommand &command);
+
+	void sort();
+
+	// issue every draw in key order, program_bound is called after each program change so per-program uniforms
+	// can be set
+	template <typename ProgramCallback>
+	void submit(ProgramCallback &&program_bound);
+
+	void clear();
+
+	std::size_t size() const {
+		return m_keys.size();
+	}
+
+	const QueueStats &get_stats() const {
+		return m_stats;
+	}
+
+private:
+	struct SortItem {
+		std::uint64_t key;
+		std::uint32_t command;
+	};
+
+	std::vector<std::uint64_t> m_keys;
+	std::vector<DrawCommand> m_commands;
+	std::vector<SortItem> m_sorted, m_scratch;
+	QueueStats m_stats;
+};
+
+template <typename ProgramCallback>
+void RenderQueue::submit(ProgramCallback &&program_bound) {
+	m_stats = {};
+	GLuint program{0}, texture{0}, vao{0};
+	bool first{true};
+	for (const auto &item: m_sorted) {
+		const auto &command = m_commands[item.command];
+		if (first || command.program != program) {
+			program = command.program;
+			gl_state().use_program(program);
+			program_bound(program);
+			++m_stats.program_binds;
+		} else
+			++m_stats.program_binds_saved;
+		if (command.texture) {
+			if (command.texture != texture) {
+				texture = command.texture;
+				gl_state().bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+				++m_stats.texture_binds;
+			} else
+				++m_stats.texture_binds_saved;
+		}
+		if (first || command.vao != vao) {
+			vao = command.vao;
+			gl_state().bind_vertex_array(vao);
+			++m_stats.vao_binds;
+		} else
+			++m_stats.vao_binds_saved;
+		glDrawElementsInstanced(command.mode,
+		                        command.count,
+		                        command.index_type,
+		                        (void*) (command.first_index * index_size(command.index_type)),
+		                        command.instances);
+		++m_stats.draws;
+		first = false;
+	}
+}
+
+} // namespace engine::render
+
+#endif //ENGINE_RENDERQUEUE_H
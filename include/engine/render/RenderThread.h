@@ -0,0 +1,115 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_RENDERTHREAD_H
+#define ENGINE_RENDERTHREAD_H
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <engine/render/FramePacket.h>
+#include <functional>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <mutex>
+#include <thread>
+#include <utils/macros.h>
+
+
+namespace engine::render {
+
+// Owns the window's GL context on a thread of its own. The simulation thread fills one of two frame packets
+// while the other is being issued, so building frame N+1 overlaps submission of frame N. begin_frame() only
+// blocks when the simulation gets a whole frame ahead.
+// Other GL work (resource creation, deletion) is passed over as tasks and always runs between frames
+class RenderThread {
+public:
+	USEPTR(RenderThread);
+
+	// execute issues a packet, the thread swaps buffers after it
+	using PacketCallback = std::function<void(const FramePacket&)>;
+
+	// takes the context away from the calling thread. Without present the thread flushes instead of swapping,
+	// for offscreen rendering
+	RenderThread(GLFWwindow *window, PacketCallback execute, bool present = true);
+
+	// finishes outstanding work and makes the context current on the calling thread again
+	virtual ~RenderThread();
+
+	RenderThread(const RenderThread&) = delete;
+
+	RenderThread& operator=(const RenderThread&) = delete;
+
+	// packet to fill for the next frame, valid until end_frame()
+	FramePacket &begin_frame();
+
+	// hand the packet from begin_frame() to the render thread
+	void end_frame();
+
+	// run task on the render thread before the next packet, without waiting for it
+	void post(std::function<void()> task);
+
+	// run task on the render thread once every packet handed over so far has been issued, for deleting GL objects
+	// and pool ranges those packets may still draw from
+	void release(std::function<void()> task);
+
+	// run task on the render thread and wait for it, runs it directly when already on the render thread
+	void invoke(const std::function<void()> &task);
+
+	bool is_current() const {
+		return std::this_thread::get_id() == m_thread.get_id();
+	}
+
+private:
+	static constexpr std::size_t NONE{2};
+
+	GLFWwindow *m_window;
+	PacketCallback m_execute;
+	bool m_present;
+	std::array<FramePacket, 2> m_packets;
+	// packet the simulation writes, packet waiting to be issued and packet being issued (or NONE)
+	std::size_t m_writing{0};
+	std::size_t m_pending{NONE};
+	std::size_t m_issuing{NONE};
+	std::deque<std::function<void()>> m_tasks;
+	struct Release {
+		// packets that have to be issued before it runs
+		std::size_t packets;
+		std::function<void()> task;
+	};
+	std::deque<Release> m_releases;
+	std::size_t m_packets_ended{0};
+	std::size_t m_packets_issued{0};
+	std::size_t m_tasks_posted{0};
+	std::size_t m_tasks_done{0};
+	bool m_stopping{false};
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::thread m_thread;
+
+	void loop();
+
+	// run the releases whose packets are done, or all of them, with lock held on entry and exit
+	void run_releases(std::unique_lock<std::mutex> &lock, bool all);
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_RENDERTHREAD_H
@@ -21,10 +21,17 @@ SOFTWARE.
 #ifndef ENGINE_SHADER_H
 #define ENGINE_SHADER_H
 
+#include <algorithm>
+#include <engine/render/GLState.h>
 #include <engine/render/renderer.h>
+#include <engine/render/uniforms.h>
 #include <GL/glew.h>
 #include <iostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <utils/file_util.h>
+#include <vector>
 
 
 namespace engine::render {
@@ -44,14 +51,79 @@ public:
 		} catch(std::runtime_error e) {
 			std::cerr << e.what() << std::endl;
 		}
+		reflect();
 	}
 
-	void use() {
-		glUseProgram(m_id);
+	explicit Shader(GLuint program) : m_id(program) {
+		reflect();
+	}
+
+	void use() const {
+		gl_state().use_program(m_id);
 	}
 
 	void destroy() {
-		glDeleteProgram(m_id);
+		gl_state().delete_program(m_id);
+	}
+
+	GLuint get_id() const {
+		return m_id;
+	}
+
+	// resolve once at setup, then set through the handle without any lookup
+	template <typename T>
+	Uniform<T> get_uniform(const std::string &name) const {
+		return Uniform<T>{location(name)};
+	}
+
+	template <typename T>
+	void set(Uniform<T> uniform, const std::type_identity_t<T> &value) const {
+		if (uniform)
+			set_uniform(uniform.location, value);
+	}
+
+	// the uniforms the renderer sets on every camera's program each frame, resolved once after link
+	Uniform<glm::mat4> get_vp_uniform() const {
+		return m_vp_uniform;
+	}
+
+	Uniform<int> get_tex0_uniform() const {
+		return m_tex0_uniform;
+	}
+
+	bool has_uniform(const std::string &name) const {
+		return location(name) >= 0;
+	}
+
+	bool has_block(const std::string &name) const {
+		return m_blocks.contains(name);
+	}
+
+	// attach a uniform block to a buffer binding point
+	void bind_block(const std::string &name, GLuint binding) const {
+		auto it = m_blocks.find(name);
+		if (it != m_blocks.end())
+			glUniformBlockBinding(m_id, it->second.index, binding);
+	}
+
+	struct UniformInfo {
+		GLint location;
+		GLenum type;
+		GLint size;
+	};
+
+	struct BlockInfo {
+		GLuint index;
+		GLint data_size;
+	};
+
+	// the active uniforms, plus every other name looked up so far with its location (-1 when absent) and type 0
+	const std::unordered_map<std::string, UniformInfo> &get_uniforms() const {
+		return m_uniforms;
+	}
+
+	const std::unordered_map<std::string, BlockInfo> &get_blocks() const {
+		return m_blocks;
 	}
 
 	// REF: https://learnopengl.com/code_viewer_gh.php?code=includes/learnopengl/shader.h
@@ -59,63 +131,121 @@ public:
 	// ------------------------------------------------------------------------
 	void uniform_bool(const std::string &name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), (int)value);
+		glUniform1i(location(name), (int)value);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_int(const std::string &name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), value);
+		glUniform1i(location(name), value);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_float(const std::string &name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), value);
+		glUniform1f(location(name), value);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_vec2(const std::string &name, const glm::vec2 &value) const
 	{
-		glUniform2fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+		glUniform2fv(location(name), 1, &value[0]);
 	}
 	void uniform_vec2(const std::string &name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		glUniform2f(location(name), x, y);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_vec3(const std::string &name, const glm::vec3 &value) const
 	{
-		glUniform3fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+		glUniform3fv(location(name), 1, &value[0]);
 	}
 	void uniform_vec3(const std::string &name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		glUniform3f(location(name), x, y, z);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_vec4(const std::string &name, const glm::vec4 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+		glUniform4fv(location(name), 1, &value[0]);
 	}
 	void uniform_vec4(const std::string &name, float x, float y, float z, float w)
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		glUniform4f(location(name), x, y, z, w);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_mat2(const std::string &name, const glm::mat2 &mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_mat3(const std::string &name, const glm::mat3 &mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void uniform_mat4(const std::string &name, const glm::mat4 &mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
 	}
 
 private:
-	GLuint m_id;
+	GLuint m_id{0};
+	// filled in by lookups of names reflection doesn't list, e.g. "lights[2]" or "s.member[1]"
+	mutable std::unordered_map<std::string, UniformInfo> m_uniforms;
+	std::unordered_map<std::string, BlockInfo> m_blocks;
+	Uniform<glm::mat4> m_vp_uniform;
+	Uniform<int> m_tex0_uniform;
+
+	// reflection only reports element 0 of arrays, anything else goes to the driver once and is remembered, misses too
+	GLint location(const std::string &name) const {
+		auto it = m_uniforms.find(name);
+		if (it != m_uniforms.end())
+			return it->second.location;
+		auto uniform_location = m_id ? glGetUniformLocation(m_id, name.c_str()) : -1;
+		m_uniforms[name] = {uniform_location, 0, 0};
+		return uniform_location;
+	}
+
+	// record every active uniform and uniform block after link so they are never looked up through the driver
+	void reflect() {
+		m_uniforms.clear();
+		m_blocks.clear();
+		m_vp_uniform = {};
+		m_tex0_uniform = {};
+		if (!m_id)
+			return;
+		GLint count{0}, max_length{0};
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+		std::vector<char> buffer(std::max(max_length, 1));
+		for (GLint i = 0; i < count; ++i) {
+			GLsizei length{0};
+			GLint size{0};
+			GLenum type{0};
+			glGetActiveUniform(m_id, i, buffer.size(), &length, &size, &type, buffer.data());
+			std::string name(buffer.data(), length);
+			// block members have no location and are reached through their block instead
+			auto uniform_location = glGetUniformLocation(m_id, name.c_str());
+			if (uniform_location < 0)
+				continue;
+			// arrays are reported as name[0], register the bare name too
+			if (name.ends_with("[0]"))
+				m_uniforms[name.substr(0, name.size() - 3)] = {uniform_location, type, size};
+			m_uniforms[name] = {uniform_location, type, size};
+		}
+		m_vp_uniform = get_uniform<glm::mat4>("vp");
+		m_tex0_uniform = get_uniform<int>("tex0");
+
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+		buffer.resize(std::max(max_length, 1));
+		for (GLint i = 0; i < count; ++i) {
+			GLsizei length{0};
+			GLint data_size{0};
+			glGetActiveUniformBlockName(m_id, i, buffer.size(), &length, buffer.data());
+			glGetActiveUniformBlockiv(m_id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+			m_blocks[std::string(buffer.data(), length)] = {static_cast<GLuint>(i), data_size};
+		}
+		bind_block(FRAME_BLOCK_NAME, FRAME_BLOCK_BINDING);
+	}
 };
 
 } // namespace engine::render
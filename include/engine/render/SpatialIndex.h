@@ -0,0 +1,262 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_SPATIALINDEX_H
+#define ENGINE_SPATIALINDEX_H
+
+#include <chrono>
+#include <cstdint>
+#include <engine/render/culling.h>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+struct Aabb {
+	glm::vec3 min{0.f};
+	glm::vec3 max{0.f};
+};
+
+// world space box around bounds placed at transform
+Aabb transform_aabb(const MeshBounds &bounds, const glm::mat4 &transform);
+
+// distances along a ray are in multiples of direction's length
+struct Ray {
+	glm::vec3 origin{0.f};
+	glm::vec3 direction{0.f, 0.f, -1.f};
+};
+
+// distance at which ray enters box, 0 when it starts inside. False when it misses or only gets there past
+// max_distance
+bool intersect(const Aabb &box, const Ray &ray, float max_distance, float &distance);
+
+// Dynamic bounding volume hierarchy over boxes tagged with a caller defined item. Leaves hold the box grown by a
+// margin so small moves leave the tree untouched, inserts descend by surface area cost and rotations keep it
+// balanced like Box2D's dynamic tree. Queries report the items of every leaf whose grown box overlaps, the caller
+// tests its exact boxes if it needs to
+class AabbTree {
+public:
+	USEPTR(AabbTree);
+
+	static constexpr std::uint32_t NONE{~0u};
+
+	// fraction of a box's largest side it is grown by on each side
+	explicit AabbTree(float margin = 0.1f) : m_margin(margin) {}
+
+	// returns the leaf holding item. Leaves added with link false are left out of the hierarchy until rebuild()
+	std::uint32_t insert(const Aabb &box, std::uint32_t item, bool link = true);
+
+	void remove(std::uint32_t leaf);
+
+	// true when box left the leaf's grown box and the leaf was reinserted
+	bool move(std::uint32_t leaf, const Aabb &box);
+
+	// build the whole hierarchy again from the leaves sorted along a Morton curve, splitting where the highest
+	// differing bit of their codes flips. Much faster than inserting one by one when most leaves are new
+	void rebuild();
+
+	void clear();
+
+	// append the items of leaves overlapping the argument to items
+	void query(const Aabb &box, std::vector<std::uint32_t> &items) const;
+
+	void query(const glm::vec3 &center, float radius, std::vector<std::uint32_t> &items) const;
+
+	// subtrees entirely inside the frustum are reported without testing their leaves
+	void query(const Frustum &frustum, std::vector<std::uint32_t> &items) const;
+
+	void query(const Ray &ray, float max_distance, std::vector<std::uint32_t> &items) const;
+
+	std::uint32_t get_item(std::uint32_t leaf) const {
+		return m_nodes[leaf].item;
+	}
+
+	std::size_t size() const {
+		return m_leaves;
+	}
+
+	std::size_t get_node_count() const {
+		return m_nodes.size() - m_free_count;
+	}
+
+	int get_height() const {
+		return m_root == NONE ? 0 : m_nodes[m_root].height;
+	}
+
+private:
+	struct Node {
+		Aabb box;
+		// next free node while on the free list
+		std::uint32_t parent{NONE};
+		std::uint32_t left{NONE};
+		std::uint32_t right{NONE};
+		std::uint32_t item{NONE};
+		// 0 for leaves, -1 while free
+		int height{0};
+	};
+
+	// leaf and the Morton code of its box center
+	struct BuildEntry {
+		std::uint32_t code;
+		std::uint32_t leaf;
+	};
+
+	float m_margin;
+	std::vector<Node> m_nodes;
+	std::uint32_t m_root{NONE};
+	std::uint32_t m_free{NONE};
+	std::size_t m_free_count{0};
+	std::size_t m_leaves{0};
+
+	std::uint32_t allocate();
+
+	void release(std::uint32_t node);
+
+	bool is_leaf(std::uint32_t node) const {
+		return m_nodes[node].left == NONE;
+	}
+
+	void link_leaf(std::uint32_t leaf);
+
+	void unlink_leaf(std::uint32_t leaf);
+
+	// refit and rebalance from node up to the root
+	void refit(std::uint32_t node);
+
+	// rotate the taller grandchild up when node's children differ in height by more than one, returns the node now
+	// in its place
+	std::uint32_t balance(std::uint32_t node);
+
+	// subtree over entries[first, last)
+	std::uint32_t build(std::vector<BuildEntry> &entries, std::size_t first, std::size_t last);
+
+	template <typename Overlaps>
+	void collect(Overlaps overlaps, std::vector<std::uint32_t> &items) const;
+
+	void collect_all(std::uint32_t node, std::vector<std::uint32_t> &items) const;
+};
+
+// an instance slot of a mesh entity
+struct InstanceKey {
+	entt::entity mesh{entt::null};
+	std::uint32_t instance{0};
+
+	bool operator==(const InstanceKey &other) const {
+		return mesh == other.mesh && instance == other.instance;
+	}
+};
+
+struct SpatialIndexStats {
+	std::size_t instances{0};
+	std::size_t nodes{0};
+	int height{0};
+	// instance boxes recomputed and leaves moved within the tree by the last update
+	std::size_t checked{0};
+	std::size_t moved{0};
+	// whether the last update built the tree again instead of inserting into it
+	bool rebuilt{false};
+	std::chrono::nanoseconds time{0};
+};
+
+// World space boxes of every Mat4Instances slot of the entities that also have MeshBounds, in an AabbTree. Follows
+// the registry through its construct/update/destroy signals: an entity patched since the last update has all its
+// instance boxes recomputed over the parallel_for workers, and only the ones that left their grown box touch the
+// tree. Queries test the exact boxes of what the tree returns, so what they report is precise
+class SpatialIndex {
+public:
+	USEPTR(SpatialIndex);
+
+	// the key and exact box behind a tree item
+	struct Item {
+		InstanceKey key;
+		Aabb box;
+		std::uint32_t leaf{AabbTree::NONE};
+	};
+
+	explicit SpatialIndex(float margin = 0.1f) : m_tree(margin) {}
+
+	// also picks up the entities already in registry
+	void connect(entt::registry &registry);
+
+	void disconnect(entt::registry &registry);
+
+	void update(entt::registry &registry);
+
+	// replace the contents of keys with the instances touching the argument and return how many there are
+	std::size_t query(const Frustum &frustum, std::vector<InstanceKey> &keys) const;
+
+	std::size_t query(const glm::vec3 &center, float radius, std::vector<InstanceKey> &keys) const;
+
+	std::size_t query(const Aabb &box, std::vector<InstanceKey> &keys) const;
+
+	// instances whose box the ray enters within max_distance, nearest entry first
+	std::size_t query(const Ray &ray, float max_distance, std::vector<InstanceKey> &keys) const;
+
+	// world box of an instance as of the last update, nullptr when it isn't indexed
+	const Aabb *get_bounds(const InstanceKey &key) const;
+
+	const AabbTree &get_tree() const {
+		return m_tree;
+	}
+
+	const SpatialIndexStats &get_stats() const {
+		return m_stats;
+	}
+
+	const Item &get_item(std::uint32_t item) const {
+		return m_items[item];
+	}
+
+private:
+	struct Owner {
+		entt::entity entity{entt::null};
+		std::vector<std::uint32_t> items;
+		bool changed{false};
+	};
+
+	AabbTree m_tree;
+	std::vector<Item> m_items;
+	std::vector<std::uint32_t> m_free_items;
+	// by entity id
+	std::vector<Owner> m_owners;
+	std::vector<entt::entity> m_changed;
+	std::vector<Aabb> m_boxes;
+	SpatialIndexStats m_stats;
+
+	void on_change(entt::registry &registry, entt::entity entity);
+
+	void on_destroy(entt::registry &registry, entt::entity entity);
+
+	Owner *find(entt::entity entity);
+
+	const Owner *find(entt::entity entity) const;
+
+	void remove_all(Owner &owner);
+
+	// recompute the owner's boxes from its instances, new leaves stay out of the tree for a rebuild unless link
+	void sync(entt::registry &registry, Owner &owner, bool link);
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_SPATIALINDEX_H
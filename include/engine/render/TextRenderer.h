@@ -0,0 +1,103 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_TEXTRENDERER_H
+#define ENGINE_TEXTRENDERER_H
+
+#include <engine/render/buffer_objects.h>
+#include <engine/render/Font.h>
+#include <engine/render/Shader.h>
+#include <entt/entt.hpp>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <string>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+// one glyph quad, expanded from a unit quad in the vertex shader
+struct GlyphInstance {
+	// x, y, width, height in screen pixels
+	glm::vec4 rect;
+	glm::vec4 uv;
+	glm::vec4 color;
+};
+
+// every glyph drawn from one font atlas
+struct GlyphBatch {
+	GLuint atlas;
+	std::vector<GlyphInstance> glyphs;
+};
+
+// Turns every visible TextSprite in a registry into glyph instances and draws them with one instanced call per
+// font atlas
+class TextRenderer {
+public:
+	USEPTR(TextRenderer);
+
+	TextRenderer();
+
+	virtual ~TextRenderer();
+
+	TextRenderer(const TextRenderer&) = delete;
+
+	TextRenderer& operator=(const TextRenderer&) = delete;
+
+	// TextSprite::font refers to fonts by the name given here
+	void add_font(const std::string &name, Font::Ptr font);
+
+	// projection maps screen pixels to clip space
+	void render(entt::registry &registry, const glm::mat4 &projection);
+
+	// CPU half of render(), only reads the registry and fonts so it can run away from the context thread
+	void collect(entt::registry &registry, std::vector<GlyphBatch> &batches) const;
+
+	// GL half of render()
+	void draw(const std::vector<GlyphBatch> &batches, const glm::mat4 &projection);
+
+	std::size_t get_draw_calls() const {
+		return m_draw_calls;
+	}
+
+	std::size_t get_glyph_count() const {
+		return m_glyph_count;
+	}
+
+private:
+	Shader m_shader;
+	Uniform<glm::mat4> m_projection_uniform;
+	Uniform<int> m_atlas_uniform;
+	GLuint m_vao{0};
+	GLuint m_quad{0};
+	StreamBuffer m_instances{GL_ARRAY_BUFFER};
+	std::map<std::string, Font::Ptr> m_fonts;
+	std::vector<GlyphBatch> m_batches;
+	std::size_t m_draw_calls{0};
+	std::size_t m_glyph_count{0};
+
+	void bind_instance_attributes(GLintptr offset);
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_TEXTRENDERER_H
@@ -0,0 +1,140 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_TEXTURESTREAMER_H
+#define ENGINE_TEXTURESTREAMER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <engine/render/buffer_objects.h>
+#include <functional>
+#include <GL/glew.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+// tightly packed RGBA8 pixels, first row at the top
+struct DecodedImage {
+	int width{0};
+	int height{0};
+	std::vector<unsigned char> pixels;
+};
+
+// returns false if the file couldn't be decoded, called from worker threads
+using ImageDecoder = std::function<bool(const std::string &path, DecodedImage &image)>;
+
+struct TextureStreamStats {
+	// requests waiting for or being decoded
+	std::size_t decode_queue{0};
+	// decoded textures not fully uploaded yet
+	std::size_t upload_queue{0};
+	std::size_t bytes_uploaded_last_frame{0};
+	std::size_t bytes_uploaded_total{0};
+	std::size_t textures_completed{0};
+};
+
+// Decodes images on worker threads and uploads them through a pixel unpack buffer over as many frames as the per
+// frame byte budget needs. The texture name handed out by request() is valid immediately: it samples a small
+// placeholder mip (via GL_TEXTURE_BASE_LEVEL) until every row of level 0 is resident, then switches to the full
+// mip chain. All GL work happens in update() on the context thread
+class TextureStreamer {
+public:
+	USEPTR(TextureStreamer);
+
+	explicit TextureStreamer(std::size_t bytes_per_frame = 4 << 20,
+	                         unsigned int workers = std::max(1u, std::thread::hardware_concurrency() / 2),
+	                         ImageDecoder decoder = nullptr);
+
+	virtual ~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	GLuint request(const std::string &path);
+
+	// decode an encoded PNG already in memory (e.g. embedded in a glTF binary), name only labels errors. Always uses
+	// the built in decoder
+	GLuint request(std::vector<unsigned char> encoded, const std::string &name);
+
+	// move decoded images to the GPU within the byte budget, call once per frame
+	void update();
+
+	// a soft limit, each frame uploads at least one row so one row wider than the budget still goes past it
+	void set_bytes_per_frame(std::size_t bytes) {
+		m_bytes_per_frame = bytes;
+	}
+
+	TextureStreamStats get_stats();
+
+private:
+	struct DecodeJob {
+		GLuint texture;
+		std::string path;
+		// decoded instead of the file at path when not empty
+		std::vector<unsigned char> encoded;
+	};
+
+	struct Upload {
+		GLuint texture;
+		DecodedImage image;
+		// downsampled copy of the image shown as mip level placeholder_level while level 0 streams in
+		DecodedImage placeholder;
+		int placeholder_level{0};
+		int next_row{0};
+	};
+
+	std::size_t m_bytes_per_frame;
+	ImageDecoder m_decoder;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping{false};
+	std::deque<DecodeJob> m_jobs;
+	std::size_t m_decoding{0};
+	std::deque<Upload> m_decoded;
+	std::deque<Upload> m_uploads;
+	StreamBuffer m_unpack_buffer{GL_PIXEL_UNPACK_BUFFER};
+	// guarded by m_mutex, get_stats() is called from other threads
+	TextureStreamStats m_stats;
+
+	void work();
+
+	// a texture showing a gray texel until job's image arrives
+	GLuint queue(DecodeJob job);
+
+	// allocate level 0 and show the placeholder until the upload finishes
+	void begin(Upload &upload);
+
+	// returns bytes uploaded, at most budget unless a single row is larger
+	std::size_t upload_rows(Upload &upload, std::size_t budget);
+
+	void finish(Upload &upload);
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_TEXTURESTREAMER_H
@@ -0,0 +1,131 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_TRANSFORMHIERARCHY_H
+#define ENGINE_TRANSFORMHIERARCHY_H
+
+#include <chrono>
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+// Local transform of a node in the render registry, world = parent world * translate * rotate * scale. Patch it
+// to move the node, its descendants follow on the next update. When instances names an entity with Mat4Instances
+// the world matrix is written into slot instance of it whenever it changes
+struct Transform {
+	glm::vec3 translation{0.f};
+	glm::quat rotation{1.f, 0.f, 0.f, 0.f};
+	glm::vec3 scale{1.f};
+	// null, or a parent that lost its Transform, makes this a root
+	entt::entity parent{entt::null};
+	entt::entity instances{entt::null};
+	std::size_t instance{0};
+
+	glm::mat4 to_mat4() const;
+};
+
+struct TransformStats {
+	std::size_t nodes{0};
+	std::size_t levels{0};
+	// world matrices recomputed and written to instance slots by the last update
+	std::size_t updated{0};
+	std::size_t written{0};
+	// whether the last update had to re-sort the hierarchy after nodes were added, removed or re-parented
+	bool rebuilt{false};
+	std::chrono::nanoseconds time{0};
+};
+
+// Keeps every Transform of a registry in structure of arrays sorted breadth first, so each depth is a contiguous
+// range whose parents all sit in earlier ranges. Updates walk the depths in order with every depth split over the
+// parallel_for workers, recomputing only nodes whose own transform or an ancestor's changed
+class TransformHierarchy {
+public:
+	USEPTR(TransformHierarchy);
+
+	// track the Transforms of registry through its construct/update/destroy signals
+	void connect(entt::registry &registry);
+
+	void disconnect(entt::registry &registry);
+
+	// propagate changes since the last call and write the changed world matrices into their instance slots
+	void update(entt::registry &registry);
+
+	// as of the last update, nullptr when entity has no Transform
+	const glm::mat4 *get_world(entt::entity entity) const;
+
+	const TransformStats &get_stats() const {
+		return m_stats;
+	}
+
+private:
+	static constexpr std::uint32_t NONE{~0u};
+
+	// what the node was sorted and targeted by, patches changing any of it force a rebuild
+	struct Link {
+		entt::entity parent;
+		entt::entity instances;
+		std::size_t instance;
+	};
+
+	// per node, in breadth first order
+	std::vector<entt::entity> m_entities;
+	std::vector<std::uint32_t> m_parents;
+	std::vector<Link> m_links;
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+	std::vector<std::uint8_t> m_dirty;
+	// first node of every depth followed by the node count
+	std::vector<std::uint32_t> m_levels;
+	// node of every entity id, NONE when it has no Transform
+	std::vector<std::uint32_t> m_lookup;
+	// nodes with an instance slot ordered by owner so each owner is patched once
+	std::vector<std::uint32_t> m_targets;
+	// patched since the last update
+	std::vector<entt::entity> m_changed;
+	bool m_rebuild{true};
+	TransformStats m_stats;
+
+	void on_construct(entt::registry &registry, entt::entity entity);
+
+	void on_update(entt::registry &registry, entt::entity entity);
+
+	void on_destroy(entt::registry &registry, entt::entity entity);
+
+	std::uint32_t find(entt::entity entity) const;
+
+	void rebuild(entt::registry &registry);
+
+	// false when a re-parented node means the order has to be rebuilt
+	bool apply_changes(entt::registry &registry);
+
+	void propagate();
+
+	void write_instances(entt::registry &registry);
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_TRANSFORMHIERARCHY_H
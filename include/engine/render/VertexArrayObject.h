@@ -22,6 +22,7 @@ SOFTWARE.
 #define ENGINE_VERTEXARRAYOBJECT_H
 
 #include <engine/render/buffer_objects.h>
+#include <engine/render/GLState.h>
 #include <engine/render/VertexAttribute.h>
 #include <GL/glew.h>
 #include <utility>
@@ -36,7 +37,7 @@ public:
 
 	virtual ~VertexArrayObject() {
 		if (m_id)
-			glDeleteVertexArrays(1, &m_id);
+			gl_state().delete_vertex_arrays(1, &m_id);
 	}
 
 	void generate() {
@@ -44,13 +45,31 @@ public:
 	}
 
 	void bind() const {
-		glBindVertexArray(m_id);
+		gl_state().bind_vertex_array(m_id);
+	}
+
+	// give up ownership of the GL name so it can be deleted elsewhere (e.g. on the render thread)
+	GLuint release() {
+		auto id = m_id;
+		m_id = 0;
+		return id;
+	}
+
+	GLuint get_id() const {
+		return m_id;
+	}
+
+	GLuint *get_texture() {
+		return &m_texture;
 	}
 
 	virtual ElementBuffer::Ptr get_element_buffer() = 0;
 
 	virtual std::vector<std::pair<BufferObject::Ptr, VertexAttribute>> get_attribute_buffers() = 0;
 
+protected:
+	GLuint m_texture{0};
+
 private:
 	GLuint m_id{0};
 };
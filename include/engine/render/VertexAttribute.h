@@ -22,6 +22,7 @@ SOFTWARE.
 #define ENGINE_VERTEXATTRIBUTE_H
 
 #include <GL/glew.h>
+#include <utils/macros.h>
 
 namespace engine::render {
 
@@ -35,12 +36,14 @@ public:
 			GLenum type = GL_FLOAT,
 			bool normalized = false,
 			GLsizei stride = 0,
-			const void* initial_offset = nullptr)
+			const void* initial_offset = nullptr,
+			bool integer = false)
 			: m_size(num_components),
 			  m_data_type(type),
 			  m_normalized(normalized),
 			  m_stride(stride),
-			  m_offset(initial_offset) {}
+			  m_offset(initial_offset),
+			  m_integer(integer) {}
 
 	GLint get_num_components() const {
 		return m_size;
@@ -62,15 +65,29 @@ public:
 		return m_offset;
 	}
 
-	void bind(GLuint index, GLuint divisor = 0) const {
+	// read as ints/uints in the shader instead of being converted to float
+	bool is_integer() const {
+		return m_integer;
+	}
+
+	// base_offset shifts the attribute into a sub-range of the bound buffer (e.g. a streaming region)
+	void bind(GLuint index, GLuint divisor = 0, GLintptr base_offset = 0) const {
 		glEnableVertexAttribArray(index);
-		glVertexAttribPointer(
-				index,
-				m_size,
-				m_data_type,
-				m_normalized,
-				m_stride,
-				m_offset);
+		if (m_integer)
+			glVertexAttribIPointer(
+					index,
+					m_size,
+					m_data_type,
+					m_stride,
+					static_cast<const char*>(m_offset) + base_offset);
+		else
+			glVertexAttribPointer(
+					index,
+					m_size,
+					m_data_type,
+					m_normalized,
+					m_stride,
+					static_cast<const char*>(m_offset) + base_offset);
 		glVertexAttribDivisor(index, divisor);
 	}
 private:
@@ -79,6 +96,7 @@ private:
 	bool m_normalized;
 	GLsizei m_stride;
 	const void* m_offset;
+	bool m_integer;
 };
 
 } // namespace engine::render
@@ -25,13 +25,90 @@ SOFTWARE.
 #ifndef ENGINE_OPENGL_STORAGE_H
 #define ENGINE_OPENGL_STORAGE_H
 
+#include <engine/render/GLState.h>
 #include <GL/glew.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <utils/macros.h>
 #include <vector>
 #include <iostream>
 
 namespace engine::render {
 
+// running total of bytes handed to the driver by the buffer objects below, read by stats and benchmarks
+inline std::atomic<std::size_t> &uploaded_bytes() {
+	static std::atomic<std::size_t> bytes{0};
+	return bytes;
+}
+
+// Sorted, merged set of modified byte ranges [begin, end). Kept small by merging the closest neighbours once
+// there are more than MAX_RANGES entries, trading a few clean bytes for fewer glBufferSubData calls.
+class DirtyRanges {
+public:
+	using Range = std::pair<GLintptr, GLintptr>;
+
+	static constexpr std::size_t MAX_RANGES{16};
+
+	void mark(GLintptr begin, GLintptr end) {
+		if (begin >= end)
+			return;
+		auto it = std::lower_bound(m_ranges.begin(), m_ranges.end(), Range{begin, end});
+		// step back if the previous range touches the new one
+		if (it != m_ranges.begin() && std::prev(it)->second >= begin)
+			--it;
+		auto last = it;
+		while (last != m_ranges.end() && last->first <= end) {
+			begin = std::min(begin, last->first);
+			end = std::max(end, last->second);
+			++last;
+		}
+		it = m_ranges.erase(it, last);
+		m_ranges.insert(it, Range{begin, end});
+		if (m_ranges.size() > MAX_RANGES)
+			merge_closest();
+	}
+
+	void clear() {
+		m_ranges.clear();
+	}
+
+	bool empty() const {
+		return m_ranges.empty();
+	}
+
+	// total number of bytes covered
+	GLintptr covered() const {
+		GLintptr total{0};
+		for (const auto& range: m_ranges)
+			total += range.second - range.first;
+		return total;
+	}
+
+	const std::vector<Range>& get_ranges() const {
+		return m_ranges;
+	}
+
+private:
+	std::vector<Range> m_ranges;
+
+	void merge_closest() {
+		auto best = m_ranges.begin();
+		auto best_gap = std::next(best)->first - best->second;
+		for (auto it = m_ranges.begin(); std::next(it) != m_ranges.end(); ++it) {
+			auto gap = std::next(it)->first - it->second;
+			if (gap < best_gap) {
+				best = it;
+				best_gap = gap;
+			}
+		}
+		best->second = std::next(best)->second;
+		m_ranges.erase(std::next(best));
+	}
+};
+
 class BufferObject {
 public:
 	USEPTR(BufferObject);
@@ -40,19 +117,49 @@ public:
 
 	virtual ~BufferObject() {
 		if (m_id)
-			glDeleteBuffers(1, &m_id);
+			gl_state().delete_buffers(1, &m_id);
 	}
 
 	void generate() {
 		glGenBuffers(1, &m_id);
 	}
 
+	// give up ownership of the GL name so it can be deleted elsewhere (e.g. on the render thread)
+	GLuint release() {
+		auto id = m_id;
+		m_id = 0;
+		return id;
+	}
+
 	void bind() const {
-		glBindBuffer(m_target, m_id);
+		gl_state().bind_buffer(m_target, m_id);
 	}
 
 	void buffer() {
-		glBufferData(m_target, get_byte_size(), get_data(), m_usage);
+		m_buffered_size = get_byte_size();
+		glBufferData(m_target, m_buffered_size, get_data(), m_usage);
+		uploaded_bytes().fetch_add(m_buffered_size, std::memory_order_relaxed);
+		m_dirty.clear();
+	}
+
+	// upload only the modified ranges, falling back to a full orphan when the size changed or the dirty fraction
+	// is above the threshold. Expects the buffer to be bound
+	void update() {
+		auto size = get_byte_size();
+		if (size != m_buffered_size || m_dirty.covered() > m_full_upload_threshold * size) {
+			buffer();
+			return;
+		}
+		auto data = static_cast<const char*>(get_data());
+		for (const auto& [begin, end]: m_dirty.get_ranges())
+			glBufferSubData(m_target, begin, end - begin, data + begin);
+		uploaded_bytes().fetch_add(m_dirty.covered(), std::memory_order_relaxed);
+		m_dirty.clear();
+	}
+
+	// fraction of the buffer that may be dirty before update() reuploads the whole thing
+	void set_full_upload_threshold(float fraction) {
+		m_full_upload_threshold = fraction;
 	}
 
 	virtual GLuint get_id() const {
@@ -67,14 +174,27 @@ public:
 		return m_usage;
 	}
 
+	// bytes held by the GL buffer since the last buffer(), which can differ from get_byte_size() until updated
+	GLsizeiptr get_buffered_size() const {
+		return m_buffered_size;
+	}
+
 	virtual GLsizeiptr get_byte_size() = 0;
 
 	virtual const void* get_data() = 0;
 
+protected:
+	void mark_dirty(GLintptr begin, GLintptr end) {
+		m_dirty.mark(begin, end);
+	}
+
 private:
 	GLuint m_id{0};
 	GLenum m_target;
 	GLenum m_usage{GL_STATIC_DRAW};
+	GLsizeiptr m_buffered_size{0};
+	float m_full_upload_threshold{0.25f};
+	DirtyRanges m_dirty;
 };
 
 template <typename DataType>
@@ -97,10 +217,36 @@ public:
 
 	void set_data(std::vector<DataType> new_data) {
 		m_data = std::move(new_data);
+		mark_modified(0, m_data.size());
+	}
+
+	const std::vector<DataType>& get_data_vector() const {
+		return m_data;
+	}
+
+	void set_element(std::size_t index, const DataType& value) {
+		m_data[index] = value;
+		mark_modified(index, 1);
+	}
+
+	void set_elements(std::size_t first, const std::vector<DataType>& values) {
+		std::copy(values.begin(), values.end(), m_data.begin() + first);
+		mark_modified(first, values.size());
+	}
+
+	// flag elements written through other means for the next update()
+	void mark_modified(std::size_t first, std::size_t count) {
+		auto size = get_element_size();
+		mark_dirty(first * size, (first + count) * size);
 	}
 
 protected:
 	std::vector<DataType> m_data;
+
+	// bytes per element as stored on the GPU, which may be narrower than DataType
+	virtual std::size_t get_element_size() const {
+		return sizeof(DataType);
+	}
 };
 
 template<typename DataType>
@@ -113,7 +259,8 @@ struct ArrayBuffer : public VectoredBufferObject<DataType> {
 			: VectoredBufferObject<DataType>(GL_ARRAY_BUFFER, std::move(initial_data)) {}
 };
 
-// Buffer data to be used as indices
+// Buffer data to be used as indices. Always unsigned int on the CPU side, with GL_UNSIGNED_SHORT the GPU copy is
+// narrowed on upload which halves index memory and bandwidth for meshes of up to 65536 vertices
 struct ElementBuffer : public VectoredBufferObject<unsigned int> {
 	USEPTR(ElementBuffer);
 
@@ -122,8 +269,217 @@ struct ElementBuffer : public VectoredBufferObject<unsigned int> {
 	explicit ElementBuffer(std::vector<unsigned int> initial_data)
 			: VectoredBufferObject<unsigned int>(GL_ELEMENT_ARRAY_BUFFER, std::move(initial_data)) {}
 
-	GLuint count() {
-		return this->get_byte_size() / sizeof(unsigned int);
+	GLsizeiptr get_byte_size() override {
+		return m_data.size() * get_element_size();
+	}
+
+	const void *get_data() override {
+		if (m_index_type == GL_UNSIGNED_INT)
+			return m_data.data();
+		m_narrowed.assign(m_data.begin(), m_data.end());
+		return m_narrowed.data();
+	}
+
+	virtual GLuint count() {
+		return m_data.size();
+	}
+
+	// GL_UNSIGNED_INT or GL_UNSIGNED_SHORT, the caller makes sure every index fits
+	void set_index_type(GLenum index_type) {
+		m_index_type = index_type;
+		mark_modified(0, m_data.size());
+	}
+
+	GLenum get_index_type() const {
+		return m_index_type;
+	}
+
+protected:
+	std::size_t get_element_size() const override {
+		return m_index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	}
+
+private:
+	GLenum m_index_type{GL_UNSIGNED_INT};
+	std::vector<GLushort> m_narrowed;
+};
+
+// frame number the stream buffers below compare against to tell when a new frame started, bumped once per frame
+// by whoever issues the GL commands
+inline std::atomic<std::uint64_t> &stream_frame() {
+	static std::atomic<std::uint64_t> frame{0};
+	return frame;
+}
+
+inline void begin_stream_frame() {
+	stream_frame().fetch_add(1, std::memory_order_relaxed);
+}
+
+// Ring buffer for data rewritten every frame. The buffer is split into one region per frame in flight. Writes of
+// one frame are packed one after another into the same region, and the first write of a new frame fences the
+// region it leaves and moves on to the next one once the fence placed when that region was last left has
+// signaled, so the driver never has to orphan the storage or stall on an implicit sync. Memory stays persistently
+// mapped when ARB_buffer_storage is available, otherwise each write maps its range unsynchronized.
+class StreamBuffer {
+public:
+	USEPTR(StreamBuffer);
+
+	explicit StreamBuffer(GLenum target, unsigned int frames_in_flight = 3)
+			: m_target(target), m_num_regions(std::max(frames_in_flight, 1u)), m_fences(m_num_regions, nullptr) {}
+
+	virtual ~StreamBuffer() {
+		release();
+	}
+
+	StreamBuffer(const StreamBuffer&) = delete;
+
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	void bind() const {
+		gl_state().bind_buffer(m_target, m_id);
+	}
+
+	// copy size bytes behind the frame's previous writes and return their byte offset within the buffer. An empty
+	// write returns 0 without touching the buffer, not even binding it
+	GLintptr write(const void* data, GLsizeiptr size) {
+		if (size <= 0)
+			return 0;
+		auto frame = stream_frame().load(std::memory_order_relaxed);
+		if (m_frame != frame) {
+			m_frame = frame;
+			if (m_id) {
+				fence(m_region);
+				m_region = (m_region + 1) % m_num_regions;
+				wait(m_region);
+			}
+			m_used = 0;
+		}
+		// a frame that outgrew its region starts over in a larger buffer, earlier draws keep the old one alive
+		if (m_used + size > m_region_size)
+			reserve(m_used + size);
+
+		auto offset = static_cast<GLintptr>(m_region) * m_region_size + m_used;
+		m_used += ((size + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+		uploaded_bytes().fetch_add(size, std::memory_order_relaxed);
+		bind();
+		if (m_mapped != nullptr)
+			std::memcpy(m_mapped + offset, data, size);
+		else {
+			auto ptr = glMapBufferRange(m_target, offset, size,
+			                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (ptr == nullptr) {
+				// mapping failed, let the driver do the copy
+				glBufferSubData(m_target, offset, size, data);
+				return offset;
+			}
+			std::memcpy(ptr, data, size);
+			glUnmapBuffer(m_target);
+		}
+		return offset;
+	}
+
+	// make room for size bytes of writes per frame up front, so a frame with a known byte budget never has to
+	// reallocate halfway through
+	void reserve_frame(GLsizeiptr size) {
+		if (size > m_region_size)
+			reserve(size);
+	}
+
+	GLuint get_id() const {
+		return m_id;
+	}
+
+	GLenum get_target() const {
+		return m_target;
+	}
+
+	GLsizeiptr get_region_size() const {
+		return m_region_size;
+	}
+
+	unsigned int get_num_regions() const {
+		return m_num_regions;
+	}
+
+	bool is_persistent() const {
+		return m_mapped != nullptr;
+	}
+
+private:
+	// regions and the writes inside them are 256 byte aligned so their offsets are valid for any attribute or
+	// uniform block binding
+	static constexpr GLsizeiptr ALIGNMENT{256};
+
+	GLuint m_id{0};
+	GLenum m_target;
+	unsigned int m_num_regions;
+	unsigned int m_region{0};
+	GLsizeiptr m_region_size{0};
+	GLsizeiptr m_used{0};
+	std::uint64_t m_frame{0};
+	char* m_mapped{nullptr};
+	std::vector<GLsync> m_fences;
+
+	void reserve(GLsizeiptr size) {
+		release();
+		// leave headroom so a slowly growing data set doesn't reallocate every frame
+		m_region_size = ((size + size / 2 + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+		auto total = m_region_size * m_num_regions;
+		glGenBuffers(1, &m_id);
+		bind();
+		if (GLEW_ARB_buffer_storage) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(m_target, total, nullptr, flags);
+			m_mapped = static_cast<char*>(glMapBufferRange(m_target, 0, total, flags));
+		} else
+			glBufferData(m_target, total, nullptr, GL_STREAM_DRAW);
+		m_region = 0;
+		m_used = 0;
+	}
+
+	void release() {
+		for (auto i = 0u; i < m_num_regions; ++i)
+			clear_fence(i);
+		if (m_id) {
+			if (m_mapped != nullptr) {
+				bind();
+				glUnmapBuffer(m_target);
+				m_mapped = nullptr;
+			}
+			gl_state().delete_buffers(1, &m_id);
+			m_id = 0;
+		}
+	}
+
+	void fence(unsigned int region) {
+		clear_fence(region);
+		m_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	void wait(unsigned int region) {
+		auto sync = m_fences[region];
+		if (sync == nullptr)
+			return;
+		// flush on the first pass so the fence is guaranteed to eventually signal
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (true) {
+			auto result = glClientWaitSync(sync, flags, 1000000);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+				break;
+			if (result == GL_WAIT_FAILED) {
+				std::cerr << "Failed waiting on stream buffer fence" << std::endl;
+				break;
+			}
+			flags = 0;
+		}
+		clear_fence(region);
+	}
+
+	void clear_fence(unsigned int region) {
+		if (m_fences[region] != nullptr) {
+			glDeleteSync(m_fences[region]);
+			m_fences[region] = nullptr;
+		}
 	}
 };
 
@@ -0,0 +1,99 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_CULLING_H
+#define ENGINE_CULLING_H
+
+#include <array>
+#include <cstdint>
+#include <engine/render/buffer_objects.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENGINE_CULLING_X86
+#endif
+
+
+namespace engine::render {
+
+// object space bounds of a mesh, stored alongside Mesh<> in the render registry
+struct MeshBounds {
+	glm::vec3 min{0};
+	glm::vec3 max{0};
+	glm::vec3 center{0};
+	float radius{0};
+};
+
+MeshBounds compute_bounds(const std::vector<glm::vec3> &vertices);
+
+// planes extracted from a view projection matrix, normals point inward and are normalized
+struct Frustum {
+	explicit Frustum(const glm::mat4 &view_projection);
+
+	bool intersects(const glm::vec3 &center, float radius) const;
+
+	std::array<glm::vec4, 6> planes;
+};
+
+// world space spheres in structure of arrays layout so the kernels can test several per instruction
+struct SphereSet {
+	std::vector<float> x, y, z, radius;
+
+	void resize(std::size_t size) {
+		x.resize(size);
+		y.resize(size);
+		z.resize(size);
+		radius.resize(size);
+	}
+
+	std::size_t size() const {
+		return x.size();
+	}
+};
+
+// place the mesh bounding sphere at every instance transform, scaling by the largest axis scale
+void transform_bounds(const MeshBounds &bounds, const glm::mat4 *transforms, std::size_t count, SphereSet &out);
+
+// write indices of spheres intersecting the frustum into visible and return how many there are. Uses AVX2 or SSE4.1
+// (picked at run time) on x86, NEON on ARM, scalar otherwise. Spheres with a NaN coordinate or radius are kept
+std::size_t cull_spheres(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible);
+
+// reference implementation the SIMD kernels must agree with
+std::size_t cull_spheres_scalar(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible);
+
+#if defined(ENGINE_CULLING_X86)
+// the x86 kernels cull_spheres picks from, for testing each one. Only call those __builtin_cpu_supports reports
+std::size_t cull_spheres_sse41(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible);
+
+std::size_t cull_spheres_avx2(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible);
+#endif
+
+// per mesh copy of the instances that survived culling for the camera currently being drawn
+struct VisibleInstances {
+	StreamBuffer::Ptr buffer{std::make_shared<StreamBuffer>(GL_ARRAY_BUFFER)};
+	SphereSet spheres;
+	std::vector<std::uint32_t> indices;
+	std::vector<glm::mat4> transforms;
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_CULLING_H
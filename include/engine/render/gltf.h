@@ -0,0 +1,116 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_GLTF_H
+#define ENGINE_GLTF_H
+
+#include <chrono>
+#include <cstddef>
+#include <entt/entt.hpp>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+
+namespace engine::render {
+
+// wall clock time of each import stage
+struct GltfImportStats {
+	// the file and any external buffers
+	std::chrono::nanoseconds read{0};
+	// JSON and the accessor/material tables
+	std::chrono::nanoseconds parse{0};
+	// accessors into vertex and index vectors, spread over the worker threads
+	std::chrono::nanoseconds decode{0};
+	// node hierarchy into per mesh instance transforms
+	std::chrono::nanoseconds scene{0};
+	// entity creation, GL upload and texture requests, import_gltf only
+	std::chrono::nanoseconds upload{0};
+	std::chrono::nanoseconds total{0};
+	std::size_t primitives{0};
+	std::size_t instances{0};
+	std::size_t images{0};
+};
+
+// one triangle primitive in Mesh<> layout. Colors are COLOR_0 times the material's base color, or the base color
+// alone, and uvs fall back to zero when the file has none, so every stream has one entry per position
+struct GltfPrimitive {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> colors;
+	std::vector<glm::vec2> uvs;
+	std::vector<unsigned int> indices;
+	// into GltfScene::materials, -1 without one
+	int material{-1};
+};
+
+struct GltfMesh {
+	std::string name;
+	std::vector<GltfPrimitive> primitives;
+	// world transform of every node of the scene referencing this mesh, empty when none does
+	std::vector<glm::mat4> instances;
+};
+
+struct GltfMaterial {
+	glm::vec4 base_color{1.f};
+	// into GltfScene::images, -1 without a base color texture
+	int image{-1};
+};
+
+// a file next to the asset, or the encoded bytes when embedded through a buffer view or data uri
+struct GltfImage {
+	std::filesystem::path path;
+	std::vector<unsigned char> encoded;
+	std::string mime_type;
+};
+
+struct GltfScene {
+	std::vector<GltfMesh> meshes;
+	std::vector<GltfMaterial> materials;
+	std::vector<GltfImage> images;
+	GltfImportStats stats;
+};
+
+struct GltfImportOptions {
+	// scene to instantiate, -1 for the file's default (or first) scene
+	int scene{-1};
+	// request base color textures through load_texture_async, import_gltf only
+	bool load_images{true};
+};
+
+// Read a .gltf (external or data uri buffers) or .glb and decode the triangle primitives of every mesh in parallel
+// with parallel_for. Touches neither GL nor the registry so it can run on any thread. Sparse accessors and other
+// primitive modes are skipped with a warning. False with the reason on std::cerr when the file is unusable
+bool load_gltf(const std::filesystem::path &path, GltfScene &scene, const GltfImportOptions &options = {});
+
+// what import_gltf created
+struct GltfImport {
+	// one per primitive of every mesh the scene references, each a Mesh<> whose Mat4Instances hold the world
+	// transforms of all nodes referencing that mesh, textured with the material's base color image
+	std::vector<entt::entity> entities;
+	GltfImportStats stats;
+};
+
+// load_gltf into the render registry, images are decoded and streamed in over the following frames
+bool import_gltf(const std::filesystem::path &path, GltfImport &result, const GltfImportOptions &options = {});
+
+} // namespace engine::render
+
+#endif //ENGINE_GLTF_H
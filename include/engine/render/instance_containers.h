@@ -22,6 +22,7 @@ SOFTWARE.
 #define ENGINE_INSTANCE_CONTAINERS_H
 
 #include <engine/render/buffer_objects.h>
+#include <engine/render/instance_formats.h>
 #include <engine/render/VertexAttribute.h>
 #include <engine/render/glm_attributes.h>
 #include <GL/glew.h>
@@ -54,16 +55,62 @@ public:
 			: BufferObject(GL_ARRAY_BUFFER), m_render_strategy(render_strategy), m_num_indices(index_count) {}
 
 	void bind_to_vao(GLuint index_offset = 0) {
+		m_index_offset = index_offset;
 		bind();
 		buffer();
-		auto attrs = get_attributes();
+		bind_attributes();
+	}
+
+	// upload modified instance data, expects the owning VAO to be bound
+	void upload() {
+		if (m_stream == nullptr) {
+			bind();
+			update();
+			return;
+		}
+		if (m_transformations.empty())
+			return;
+		// ring regions don't hold the previous frame's data so streaming always writes the whole set, and
+		// each write lands at a different offset so attributes are re-pointed at it
+		m_stream_offset = m_stream->write(get_data(), get_byte_size());
+		bind_attributes(m_stream_offset);
+	}
+
+	// point attributes at whatever is bound to GL_ARRAY_BUFFER, e.g. a culled copy of the instances
+	void bind_attributes(GLintptr base_offset = 0) {
+		auto index = m_index_offset;
 		auto divisor = get_divisor();
-		for (const auto &attr: attrs) {
-			attr.bind(index_offset, divisor);
-			++index_offset;
+		for (const auto &attr: get_attributes()) {
+			attr.bind(index, divisor, base_offset);
+			++index;
+		}
+	}
+
+	// point attributes back at this container's own storage
+	void restore_attributes() {
+		if (m_stream != nullptr) {
+			m_stream->bind();
+			bind_attributes(m_stream_offset);
+		} else {
+			bind();
+			bind_attributes();
 		}
 	}
 
+	// opt in to writing instance data through a fenced ring buffer instead of reallocating on every upload
+	void enable_streaming(unsigned int frames_in_flight = 3) {
+		m_stream = std::make_shared<StreamBuffer>(GL_ARRAY_BUFFER, frames_in_flight);
+	}
+
+	bool is_streaming() const {
+		return m_stream != nullptr;
+	}
+
+	// first vertex attribute location used by the instance data
+	GLuint get_index_offset() const {
+		return m_index_offset;
+	}
+
 	GLuint get_divisor() const override {
 		return 1;
 	}
@@ -94,6 +141,22 @@ public:
 
 	void set_data(std::vector<ElementType> data) {
 		m_transformations = std::move(data);
+		mark_modified(0, m_transformations.size());
+	}
+
+	void set_instance(std::size_t index, const ElementType& value) {
+		m_transformations[index] = value;
+		mark_modified(index, 1);
+	}
+
+	void set_instances(std::size_t first, const std::vector<ElementType>& values) {
+		std::copy(values.begin(), values.end(), m_transformations.begin() + first);
+		mark_modified(first, values.size());
+	}
+
+	// flag instances written through other means for the next upload
+	void mark_modified(std::size_t first, std::size_t count) {
+		mark_dirty(first * sizeof(ElementType), (first + count) * sizeof(ElementType));
 	}
 
 	void set_num_indices(GLuint count) {
@@ -107,6 +170,9 @@ private:
 	std::vector<ElementType> m_transformations;
 	GLuint m_render_strategy;
 	GLsizeiptr m_num_indices;
+	GLuint m_index_offset{0};
+	StreamBuffer::Ptr m_stream{nullptr};
+	GLintptr m_stream_offset{0};
 };
 
 
@@ -140,6 +206,30 @@ struct Mat4Instances : public InstanceVector<glm::mat4> {
 	}
 };
 
+// Mat4Instances converted to a compact InstanceFormat, kept next to them by the renderer and repacked when they
+// change rather than for every camera that draws them
+struct PackedInstances {
+	InstanceFormat format{InstanceFormat::mat4};
+	ArrayBuffer<std::uint8_t>::Ptr buffer{std::make_shared<ArrayBuffer<std::uint8_t>>()};
+};
+
+
+// instances of any struct with a VertexLayout specialization, one attribute per field in order. Per instance data
+// beyond the transform (tint, entity id, animation phase) only needs the struct and its layout declared
+template <typename Instance>
+struct LayoutInstances : public InstanceVector<Instance> {
+	LayoutInstances(GLuint render_strat, GLsizeiptr index_count)
+	: InstanceVector<Instance>(render_strat, index_count) {}
+
+	[[nodiscard]] std::vector<VertexAttribute> get_attributes() const override {
+		return layout_attributes<Instance>();
+	}
+};
+
+using AffineInstances = LayoutInstances<AffineInstance>;
+using RigidInstances = LayoutInstances<RigidInstance>;
+using HalfRigidInstances = LayoutInstances<HalfRigidInstance>;
+using HalfAffineInstances = LayoutInstances<HalfAffineInstance>;
 
 } // namespace engine::render
 
@@ -0,0 +1,162 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_INSTANCE_FORMATS_H
+#define ENGINE_INSTANCE_FORMATS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <engine/render/vertex_format.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+
+namespace engine::render {
+
+// upper three rows of a model matrix, one vec4 attribute each (48 B against 64 for a mat4). The bottom row of an
+// affine transform is always (0, 0, 0, 1) so nothing is lost
+struct AffineInstance {
+	glm::vec4 row0{1.f, 0.f, 0.f, 0.f};
+	glm::vec4 row1{0.f, 1.f, 0.f, 0.f};
+	glm::vec4 row2{0.f, 0.f, 1.f, 0.f};
+
+	AffineInstance() = default;
+
+	explicit AffineInstance(const glm::mat4 &transform);
+
+	glm::mat4 to_mat4() const;
+};
+
+// translation with a uniform scale in w, and a unit quaternion stored (x, y, z, w) (32 B). Shear and non-uniform
+// scale can't be represented, mirroring transforms come through as a negative scale
+struct RigidInstance {
+	glm::vec4 position_scale{0.f, 0.f, 0.f, 1.f};
+	glm::vec4 rotation{0.f, 0.f, 0.f, 1.f};
+
+	RigidInstance() = default;
+
+	RigidInstance(const glm::vec3 &position, const glm::quat &rotation, float scale = 1.f);
+
+	explicit RigidInstance(const glm::mat4 &transform);
+
+	glm::mat4 to_mat4() const;
+};
+
+// RigidInstance with the rotation in half precision (24 B), around 1e-3 of angular error
+struct HalfRigidInstance {
+	glm::vec4 position_scale{0.f, 0.f, 0.f, 1.f};
+	Half4 rotation{glm::vec4(0.f, 0.f, 0.f, 1.f)};
+
+	HalfRigidInstance() = default;
+
+	explicit HalfRigidInstance(const RigidInstance &rigid);
+
+	explicit HalfRigidInstance(const glm::mat4 &transform) : HalfRigidInstance(RigidInstance(transform)) {}
+
+	glm::mat4 to_mat4() const;
+};
+
+// AffineInstance in half precision (24 B). Translations only keep 11 significant bits, so this suits instances
+// placed relative to a nearby origin (particles, foliage in a chunk) rather than world space positions
+struct HalfAffineInstance {
+	Half4 row0{glm::vec4(1.f, 0.f, 0.f, 0.f)};
+	Half4 row1{glm::vec4(0.f, 1.f, 0.f, 0.f)};
+	Half4 row2{glm::vec4(0.f, 0.f, 1.f, 0.f)};
+
+	HalfAffineInstance() = default;
+
+	explicit HalfAffineInstance(const glm::mat4 &transform);
+
+	glm::mat4 to_mat4() const;
+};
+
+template <>
+struct VertexLayout<AffineInstance> {
+	static constexpr std::array attributes{ENGINE_VERTEX_ATTRIBUTE(AffineInstance, row0),
+	                                       ENGINE_VERTEX_ATTRIBUTE(AffineInstance, row1),
+	                                       ENGINE_VERTEX_ATTRIBUTE(AffineInstance, row2)};
+};
+
+template <>
+struct VertexLayout<RigidInstance> {
+	static constexpr std::array attributes{ENGINE_VERTEX_ATTRIBUTE(RigidInstance, position_scale),
+	                                       ENGINE_VERTEX_ATTRIBUTE(RigidInstance, rotation)};
+};
+
+template <>
+struct VertexLayout<HalfRigidInstance> {
+	static constexpr std::array attributes{ENGINE_VERTEX_ATTRIBUTE(HalfRigidInstance, position_scale),
+	                                       ENGINE_VERTEX_ATTRIBUTE(HalfRigidInstance, rotation)};
+};
+
+template <>
+struct VertexLayout<HalfAffineInstance> {
+	static constexpr std::array attributes{ENGINE_VERTEX_ATTRIBUTE(HalfAffineInstance, row0),
+	                                       ENGINE_VERTEX_ATTRIBUTE(HalfAffineInstance, row1),
+	                                       ENGINE_VERTEX_ATTRIBUTE(HalfAffineInstance, row2)};
+};
+
+static_assert(sizeof(AffineInstance) == 48);
+static_assert(sizeof(RigidInstance) == 32);
+static_assert(sizeof(HalfRigidInstance) == 24);
+static_assert(sizeof(HalfAffineInstance) == 24);
+
+// what the renderer streams per instance in place of a full mat4
+enum class InstanceFormat {
+	mat4,
+	affine,
+	rigid,
+	half_rigid,
+	half_affine
+};
+
+// bytes per instance
+std::size_t instance_size(InstanceFormat format);
+
+// convert count model matrices into format, out is resized to fit
+void pack_instances(InstanceFormat format, const glm::mat4 *transforms, std::size_t count,
+                    std::vector<std::uint8_t> &out);
+
+// point per instance attributes for format at consecutive locations from first_location, reading the bound array
+// buffer from offset. Locations a mat4 would use past the format's own are disabled. Returns the next free location
+GLuint bind_instance_format(InstanceFormat format, GLuint first_location, GLintptr offset = 0);
+
+// GLSL rebuilding the model matrix, insert it after the #version line. The affine formats take three vec4 inputs
+// (row0-row2), the rigid ones two (position_scale, rotation); half precision attributes still arrive as vec4
+constexpr const char *INSTANCE_FORMAT_GLSL{R"(
+mat4 affine_model(vec4 row0, vec4 row1, vec4 row2) {
+	return transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+mat4 rigid_model(vec4 position_scale, vec4 q) {
+	vec3 x = vec3(1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y));
+	vec3 y = vec3(2.0 * (q.x * q.y - q.w * q.z), 1.0 - 2.0 * (q.x * q.x + q.z * q.z), 2.0 * (q.y * q.z + q.w * q.x));
+	vec3 z = vec3(2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+	float s = position_scale.w;
+	return mat4(vec4(x * s, 0.0), vec4(y * s, 0.0), vec4(z * s, 0.0), vec4(position_scale.xyz, 1.0));
+}
+)"};
+
+} // namespace engine::render
+
+#endif //ENGINE_INSTANCE_FORMATS_H
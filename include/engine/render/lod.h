@@ -0,0 +1,114 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_LOD_H
+#define ENGINE_LOD_H
+
+#include <cstdint>
+#include <engine/render/culling.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+
+namespace engine::render {
+
+// one detail level as a range of a mesh's element buffer, level 0 is the untouched original
+struct LodLevel {
+	GLuint first_index{0};
+	GLuint index_count{0};
+	// world space distance the simplified surface may be from the original at this level
+	float error{0};
+	// drawn while the instance's bounding sphere covers at least this fraction of half the viewport height
+	float min_screen_size{0};
+};
+
+struct LodSettings {
+	std::size_t max_levels{4};
+	// target index count of each level relative to the one before it
+	float reduction{0.5f};
+	// screen size below which level 0 gives way to level 1, further thresholds scale with the square root of
+	// the triangle ratio so triangle density on screen stays roughly constant
+	float full_detail_size{0.5f};
+	// stop adding levels once a collapse would move the surface further than this
+	float max_error{std::numeric_limits<float>::max()};
+};
+
+// every level's indices back to back plus where each one starts
+struct LodChain {
+	std::vector<unsigned int> indices;
+	std::vector<LodLevel> levels;
+};
+
+// Quadric error edge collapse (Garland & Heckbert) down to target_index_count or until max_error is reached.
+// Vertices are only ever collapsed onto other existing vertices so the result indexes the same vertex buffers
+// and colors/uvs stay valid. Vertices on open borders or on attribute seams (several vertices sharing a position)
+// are kept in place so simplified levels don't crack or tear their texturing
+std::vector<unsigned int> simplify(const std::vector<glm::vec3> &positions,
+                                   const std::vector<unsigned int> &indices,
+                                   std::size_t target_index_count,
+                                   float max_error = std::numeric_limits<float>::max(),
+                                   float *result_error = nullptr);
+
+// simplify repeatedly until max_levels or the simplifier stops making progress
+LodChain build_lod_chain(const std::vector<glm::vec3> &positions,
+                         const std::vector<unsigned int> &indices,
+                         const LodSettings &settings = {});
+
+// fraction of half the viewport height covered by a sphere, tan_half_fovy is tan(fovy / 2) of the projection
+inline float screen_size(float radius, float distance, float tan_half_fovy) {
+	if (distance <= radius)
+		return std::numeric_limits<float>::max();
+	return radius / (distance * tan_half_fovy);
+}
+
+// most detailed level is the fallback when levels is empty or nothing else fits
+std::size_t select_lod(const std::vector<LodLevel> &levels, float size);
+
+// sort the instances listed in indices into one bucket per level by the screen size of their sphere
+void bucket_instances(const std::vector<LodLevel> &levels,
+                      const SphereSet &spheres,
+                      const std::uint32_t *indices,
+                      std::size_t count,
+                      const glm::vec3 &eye,
+                      float tan_half_fovy,
+                      std::vector<std::vector<std::uint32_t>> &buckets);
+
+// Stored next to a Mesh<> by render::generate_lods and rebuilt whenever the mesh is updated. Each level has its own
+// VAO over the mesh's vertex buffers and the chain's element buffer, so the instances of every level can be pointed
+// at their own slice of one write on 4.1 contexts without base instance. Pooled meshes keep the chain in the pool
+// and draw sub-ranges of it instead
+struct MeshLods {
+	LodSettings settings;
+	std::vector<LodLevel> levels;
+	ElementBuffer::Ptr elements{std::make_shared<ElementBuffer>()};
+	std::vector<GLuint> vaos;
+	// per frame scratch
+	SphereSet spheres;
+	std::vector<std::uint32_t> indices;
+	std::vector<std::vector<std::uint32_t>> buckets;
+	std::vector<glm::mat4> transforms;
+	StreamBuffer::Ptr buffer{std::make_shared<StreamBuffer>(GL_ARRAY_BUFFER)};
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_LOD_H
@@ -0,0 +1,140 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_MESH_ASSET_H
+#define ENGINE_MESH_ASSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <engine/render/culling.h>
+#include <engine/render/lod.h>
+#include <filesystem>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <span>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+constexpr char MESH_ASSET_MAGIC[4] = {'E', 'M', 'S', 'H'};
+constexpr std::uint32_t MESH_ASSET_VERSION{1};
+// every section starts on a multiple of this, so the mapped streams can be read in place
+constexpr std::size_t MESH_ASSET_ALIGNMENT{16};
+
+// byte range of one stream within the file
+struct MeshAssetSection {
+	std::uint64_t offset{0};
+	std::uint64_t size{0};
+};
+
+// Engine native mesh file: this header followed by aligned sections in Mesh<> attribute order (vec3 positions,
+// vec3 colors, vec2 uvs), the indices, then an optional LOD table and the indices of its levels. Multi-byte values
+// are stored little endian, i.e. as the machines this runs on lay them out
+struct MeshAssetHeader {
+	char magic[4];
+	std::uint32_t version;
+	std::uint32_t vertex_count;
+	std::uint32_t index_count;
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, for both index sections
+	std::uint32_t index_type;
+	std::uint32_t lod_count;
+	MeshBounds bounds;
+	MeshAssetSection positions;
+	MeshAssetSection colors;
+	MeshAssetSection uvs;
+	MeshAssetSection indices;
+	MeshAssetSection lod_levels;
+	MeshAssetSection lod_indices;
+};
+
+// A mesh asset mapped read only into memory. Nothing is parsed or copied on open beyond validating the header,
+// pages are faulted in as the streams are read, e.g. by glBufferData uploading straight from them
+class MeshAsset {
+public:
+	USEPTR(MeshAsset);
+
+	// nullptr when path can't be mapped or isn't a valid asset, the reason is printed to std::cerr
+	static Ptr open(const std::filesystem::path &path);
+
+	~MeshAsset();
+
+	MeshAsset(const MeshAsset&) = delete;
+
+	MeshAsset& operator=(const MeshAsset&) = delete;
+
+	const MeshAssetHeader &get_header() const {
+		return *reinterpret_cast<const MeshAssetHeader*>(m_data);
+	}
+
+	std::span<const glm::vec3> get_positions() const {
+		return stream<glm::vec3>(get_header().positions);
+	}
+
+	std::span<const glm::vec3> get_colors() const {
+		return stream<glm::vec3>(get_header().colors);
+	}
+
+	std::span<const glm::vec2> get_uvs() const {
+		return stream<glm::vec2>(get_header().uvs);
+	}
+
+	std::span<const LodLevel> get_lod_levels() const {
+		return stream<LodLevel>(get_header().lod_levels);
+	}
+
+	// start of a section in the mapping
+	const void *get_section(const MeshAssetSection &section) const {
+		return m_data + section.offset;
+	}
+
+	// whole file size
+	std::size_t get_size() const {
+		return m_size;
+	}
+
+private:
+	const std::uint8_t *m_data{nullptr};
+	std::size_t m_size{0};
+	// files are read into memory where mmap isn't available
+	std::vector<std::uint8_t> m_contents;
+
+	MeshAsset() = default;
+
+	template <typename T>
+	std::span<const T> stream(const MeshAssetSection &section) const {
+		return {reinterpret_cast<const T*>(m_data + section.offset), section.size / sizeof(T)};
+	}
+};
+
+// Write a mesh asset to path. colors and uvs may be empty and are then filled with white and zero, so every
+// attribute of a mapped mesh has data. Indices are stored as 16 bit when the vertex count allows it. lods is
+// optional, as returned by build_lod_chain for the same vertices. False with a message on std::cerr on failure
+bool write_mesh_asset(const std::filesystem::path &path,
+                      const std::vector<glm::vec3> &positions,
+                      const std::vector<glm::vec3> &colors,
+                      const std::vector<glm::vec2> &uvs,
+                      const std::vector<unsigned int> &indices,
+                      const LodChain *lods = nullptr);
+
+} // namespace engine::render
+
+#endif //ENGINE_MESH_ASSET_H
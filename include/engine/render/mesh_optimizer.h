@@ -0,0 +1,125 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_MESH_OPTIMIZER_H
+#define ENGINE_MESH_OPTIMIZER_H
+
+#include <cstdint>
+#include <engine/render/Mesh.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+
+namespace engine::render {
+
+// efficiency of an index order against a FIFO post-transform cache
+struct VertexCacheStats {
+	// average cache misses per triangle, 0.5 is the practical best for large regular meshes, 3 the worst
+	float acmr{0};
+	// average transforms per referenced vertex, 1 is perfect
+	float atvr{0};
+};
+
+struct MeshOptimizeOptions {
+	bool vertex_cache{true};
+	// renumber vertices in first use order so fetches walk each attribute buffer linearly
+	bool vertex_fetch{true};
+	// reorder clusters of triangles so outward facing ones come first, only kept if the ACMR stays within
+	// overdraw_threshold times the cache optimized one
+	bool overdraw{false};
+	float overdraw_threshold{1.05f};
+	// upload indices as 16 bit when the vertex count allows
+	bool compact_indices{true};
+};
+
+struct MeshOptimizeReport {
+	VertexCacheStats before;
+	VertexCacheStats after;
+	GLenum index_type{GL_UNSIGNED_INT};
+};
+
+VertexCacheStats analyze_vertex_cache(const std::vector<unsigned int> &indices, std::size_t vertex_count,
+                                      std::size_t cache_size = 16);
+
+// Forsyth's linear speed triangle reordering, in place
+void optimize_vertex_cache(std::vector<unsigned int> &indices, std::size_t vertex_count);
+
+// Same on [first, first + count) only, e.g. one LOD level of a chain
+void optimize_vertex_cache(unsigned int *indices, std::size_t count, std::size_t vertex_count);
+
+// Sander et al.'s cluster sort: split the cache optimized order where the cache restarts and sort the clusters by
+// how much they face away from the mesh center. Returns false, leaving indices as they were, when
+// that costs more than threshold times the current ACMR
+bool optimize_overdraw(std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions, float threshold);
+
+// rewrite indices to first use order and return old index -> new index, unreferenced vertices go last
+std::vector<unsigned int> optimize_vertex_fetch(std::vector<unsigned int> &indices, std::size_t vertex_count);
+
+template <typename T>
+std::vector<T> remap_vertices(const std::vector<T> &vertices, const std::vector<unsigned int> &remap) {
+	std::vector<T> remapped(vertices.size());
+	for (std::size_t i = 0; i < vertices.size(); ++i)
+		remapped[remap[i]] = vertices[i];
+	return remapped;
+}
+
+// GL_UNSIGNED_SHORT when every vertex can be addressed with 16 bits
+inline GLenum smallest_index_type(std::size_t vertex_count) {
+	return vertex_count <= std::numeric_limits<GLushort>::max() + std::size_t{1} ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+// Run the selected passes over the CPU side data of a mesh that hasn't been uploaded yet. Vertices are renumbered,
+// so indices the application kept into the old order are invalid afterwards
+template <typename V, typename C, typename T>
+MeshOptimizeReport optimize_mesh(Mesh<V, C, T> &mesh, const MeshOptimizeOptions &options = {}) {
+	MeshOptimizeReport report;
+	auto elements = mesh.get_element_buffer();
+	auto indices = elements->get_data_vector();
+	const auto &positions = mesh.get_vertex_buffer()->get_data_vector();
+	auto vertex_count = positions.size();
+	report.before = analyze_vertex_cache(indices, vertex_count);
+	if (options.vertex_cache)
+		optimize_vertex_cache(indices, vertex_count);
+	if (options.overdraw)
+		optimize_overdraw(indices, positions, options.overdraw_threshold);
+	if (options.vertex_fetch) {
+		auto remap = optimize_vertex_fetch(indices, vertex_count);
+		// attributes the mesh doesn't have are left empty
+		auto remap_buffer = [&](auto buffer) {
+			if (buffer->get_data_vector().size() == vertex_count)
+				buffer->set_data(remap_vertices(buffer->get_data_vector(), remap));
+		};
+		remap_buffer(mesh.get_color_buffer());
+		remap_buffer(mesh.get_uv_buffer());
+		remap_buffer(mesh.get_vertex_buffer());
+	}
+	report.after = analyze_vertex_cache(indices, vertex_count);
+	elements->set_data(std::move(indices));
+	if (options.compact_indices)
+		elements->set_index_type(smallest_index_type(vertex_count));
+	report.index_type = elements->get_index_type();
+	return report;
+}
+
+} // namespace engine::render
+
+#endif //ENGINE_MESH_OPTIMIZER_H
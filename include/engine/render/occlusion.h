@@ -0,0 +1,126 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_OCCLUSION_H
+#define ENGINE_OCCLUSION_H
+
+#include <chrono>
+#include <cstdint>
+#include <engine/render/culling.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+// tag for Mesh<> entities whose instances hide what is behind them, e.g. buildings. Their triangles are drawn into
+// the occlusion buffer before any instance is tested, so keep them low poly
+struct Occluder {};
+
+struct OcclusionStats {
+	// front facing triangles in front of the near plane that were rasterized
+	std::size_t triangles{0};
+	// instances tested and found hidden since begin()
+	std::size_t tested{0};
+	std::size_t occluded{0};
+	std::chrono::nanoseconds raster_time{0};
+	std::chrono::nanoseconds test_time{0};
+};
+
+// Low resolution depth buffer rasterized on the CPU plus a max depth per 8x8 tile. Occluder triangles are set up
+// as they are added and rasterized by finish() in row bands spread over the parallel_for workers, four pixels per
+// instruction with SSE2 or NEON. Instance boxes are then tested against the tile maxima first and the pixels only
+// where a tile doesn't settle it. A pixel is only written when a triangle covers all of it, with the farthest depth
+// the triangle has over it, and triangles crossing the near plane are dropped, so the buffer can miss occluders
+// but never claims more than is there. That includes the pixels along edges shared by two triangles, which
+// neither covers whole: big triangles occlude best. No GL involved
+class OcclusionBuffer {
+public:
+	USEPTR(OcclusionBuffer);
+
+	// rounded up to whole tiles
+	explicit OcclusionBuffer(int width = 256, int height = 128);
+
+	// start over for a view, everything reads as far away until finish()
+	void begin(const glm::mat4 &view_projection);
+
+	// queue the front facing (counter clockwise) triangles of a mesh placed at each of the transforms
+	void add_occluder(const std::vector<glm::vec3> &positions,
+	                  const std::vector<unsigned int> &indices,
+	                  const glm::mat4 *transforms,
+	                  std::size_t count);
+
+	// rasterize everything queued and build the tile maxima, tests are valid from here until the next begin()
+	void finish();
+
+	// false only when bounds placed at transform are certainly behind the occluders
+	bool is_visible(const MeshBounds &bounds, const glm::mat4 &transform) const;
+
+	// keep the entries of indices[0, count) whose instance may be visible, in order, and return how many
+	std::size_t cull(const MeshBounds &bounds, const glm::mat4 *transforms, std::uint32_t *indices, std::size_t count);
+
+	// depth as 8 bit grey, near is bright and nothing drawn is black. False with the reason on std::cerr on failure
+	bool write_png(const std::string &path) const;
+
+	int get_width() const {
+		return m_width;
+	}
+
+	int get_height() const {
+		return m_height;
+	}
+
+	// window space depth in [0, 1] by row from the bottom
+	const std::vector<float> &get_depth() const {
+		return m_depth;
+	}
+
+	const OcclusionStats &get_stats() const {
+		return m_stats;
+	}
+
+private:
+	// edge functions and depth as planes a * x + b * y + c evaluated at pixel centers, rows clamped to the screen.
+	// The edges are pulled in and the depth pushed back by half a pixel so a center stands for its whole pixel
+	struct Triangle {
+		glm::vec3 edges[3];
+		glm::vec3 depth;
+		int min_x, max_x, min_y, max_y;
+	};
+
+	int m_width, m_height;
+	int m_tiles_x, m_tiles_y;
+	glm::mat4 m_view_projection{1.f};
+	std::vector<float> m_depth;
+	std::vector<float> m_tiles;
+	std::vector<Triangle> m_triangles;
+	// clip space positions of the occluder being added
+	std::vector<glm::vec4> m_clip;
+	std::vector<std::uint8_t> m_keep;
+	OcclusionStats m_stats;
+
+	void rasterize(int first_row, int last_row);
+};
+
+} // namespace engine::render
+
+#endif //ENGINE_OCCLUSION_H
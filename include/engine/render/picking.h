@@ -0,0 +1,120 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_PICKING_H
+#define ENGINE_PICKING_H
+
+#include <cstdint>
+#include <engine/render/SpatialIndex.h>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <limits>
+#include <span>
+#include <utils/macros.h>
+#include <vector>
+
+
+namespace engine::render {
+
+// world space ray through cursor, in window coordinates from the top left as GLFW reports them, for a viewport of
+// the given size. Starts on the near plane and has a unit direction, so distances along it are world units
+Ray make_ray(const glm::vec2 &cursor, const glm::vec2 &viewport, const glm::mat4 &view, const glm::mat4 &projection);
+
+struct TriangleHit {
+	// index of the triangle in the index list, its vertices are indices[3 * triangle] onwards
+	std::uint32_t triangle{0};
+	// weights of the triangle's three vertices at the hit point
+	glm::vec3 barycentrics{0.f};
+	float distance{std::numeric_limits<float>::max()};
+};
+
+// Bounding volume hierarchy over the triangles of a mesh, split by binned surface area heuristic and laid out depth
+// first with siblings side by side. Built once from the CPU copy of the mesh and stored next to it in the render
+// registry, the renderer drops it when the mesh is updated. Triangles are two sided
+class TriangleBvh {
+public:
+	USEPTR(TriangleBvh);
+
+	TriangleBvh() = default;
+
+	// triangles with an index past the end of positions are left out
+	TriangleBvh(std::span<const glm::vec3> positions, std::span<const unsigned int> indices);
+
+	// nearest triangle the ray hits closer than hit.distance, in the space of the positions. hit is only written
+	// when it returns true
+	bool intersect(const Ray &ray, TriangleHit &hit) const;
+
+	std::size_t get_triangle_count() const {
+		return m_triangles.size();
+	}
+
+	std::size_t get_node_count() const {
+		return m_nodes.size();
+	}
+
+	Aabb get_bounds() const {
+		return m_nodes.empty() ? Aabb{} : m_nodes[0].box;
+	}
+
+private:
+	struct Node {
+		Aabb box;
+		// first triangle for leaves, left child otherwise with the right one after it
+		std::uint32_t first{0};
+		// triangles in a leaf, 0 for interior nodes
+		std::uint32_t count{0};
+	};
+
+	// a corner and the edges leaving it, what the Moller-Trumbore test works from
+	struct Triangle {
+		glm::vec3 origin;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+	std::vector<Node> m_nodes;
+	// in leaf order
+	std::vector<Triangle> m_triangles;
+	// index list triangle of each
+	std::vector<std::uint32_t> m_ids;
+};
+
+struct PickHit {
+	entt::entity mesh{entt::null};
+	std::uint32_t instance{0};
+	std::uint32_t triangle{0};
+	glm::vec3 barycentrics{0.f};
+	float distance{std::numeric_limits<float>::max()};
+	// world space
+	glm::vec3 position{0.f};
+};
+
+// Nearest triangle along ray within max_distance among the instances of index. Instances are visited nearest box
+// first, stopping once the next box starts past the best hit, and each is tested in object space against the
+// TriangleBvh stored with its mesh entity in registry. Meshes without one are skipped
+bool pick(const SpatialIndex &index,
+          entt::registry &registry,
+          const Ray &ray,
+          PickHit &hit,
+          float max_distance = std::numeric_limits<float>::max());
+
+} // namespace engine::render
+
+#endif //ENGINE_PICKING_H
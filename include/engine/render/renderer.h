@@ -26,27 +26,60 @@ SOFTWARE.
 #define ENGINE_RENDERER_H
 
 #include <chrono>
+#include <engine/render/camera/Camera.h>
+#include <engine/render/GLState.h>
 #include <engine/render/Glyph.h>
+#include <engine/render/instance_formats.h>
+#include <engine/render/lod.h>
+#include <engine/render/mesh_optimizer.h>
+#include <engine/render/occlusion.h>
+#include <engine/render/picking.h>
+#include <engine/render/ProgramCache.h>
 #include <engine/render/RenderContext.h>
+#include <engine/render/RenderQueue.h>
+#include <engine/render/SpatialIndex.h>
+#include <engine/render/TextureStreamer.h>
+#include <engine/render/TransformHierarchy.h>
 #include <entt/entt.hpp>
 #include <ft2build.h>
 #include <freetype/freetype.h>
+#include <functional>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include <limits>
+#include <map>
+#include <memory>
 #include <string>
 #include <utils/macros.h>
+#include <vector>
 
 // essentially a singleton namespace. Private "member" variables/functions are in renderer.cpp anonymous namespace
 // Might switch away from this if I have  a good reason
 namespace engine::render {
 
-bool init();
+class Font;
 
-void render(std::chrono::nanoseconds dt);
+struct InitOptions {
+	int width{800};
+	int height{600};
+	bool vsync{true};
+	// no visible window, everything renders into an offscreen framebuffer of width x height
+	bool headless{false};
+	// with headless, create the context through OSMesa so it works without a display or GPU (e.g. CI machines
+	// with llvmpipe). Requires GLFW built with OSMesa support
+	bool osmesa{false};
+};
 
+bool init(const InitOptions &options = {});
+
+// alpha is the fixed step interpolation factor from engine::run, shaders read it from the Frame block
+void render(std::chrono::nanoseconds dt, float alpha = 1.f);
+
+// no-op with a render thread, which swaps after each packet
 void swap_buffers();
 
+// no-op with a render thread, which clears before each packet
 void clear_screen();
 
 void cleanup();
@@ -60,6 +93,134 @@ const RenderContext &get_context();
 
 glm::mat4 get_projection();
 
+glm::mat4 get_projection(const RenderContext &context);
+
+// test instances against each camera frustum and only draw the visible ones, requires instance transforms to
+// be model matrices. Turning it off turns occlusion culling off too
+void set_frustum_culling(bool enabled);
+
+bool is_frustum_culling();
+
+// also skip instances hidden behind the Mesh<> instances of Occluder entities, rasterized on the CPU per camera into
+// a width x height depth buffer. Turns frustum culling on, which it builds on
+void set_occlusion_culling(bool enabled, int width = 256, int height = 128);
+
+bool is_occlusion_culling();
+
+// occluder triangles and instances hidden for the last camera drawn
+OcclusionStats get_occlusion_stats();
+
+// write the last camera's occlusion depth buffer as a grey PNG, false if occlusion culling is off or writing fails
+bool write_occlusion_buffer(const std::string &path);
+
+// allocate meshes constructed from now on out of shared buffers and draw them with multi draw indirect.
+// Meshes created before the call keep their own buffers
+void enable_geometry_pool();
+
+bool has_geometry_pool();
+
+// reorder the triangles and vertices of meshes constructed from now on for the post-transform cache and fetch
+// locality, and narrow their indices where possible, before they are uploaded. Each gets a MeshOptimizeReport
+// with its ACMR/ATVR before and after. Vertices are renumbered, so leave it off for meshes edited per vertex
+void set_mesh_optimization(bool enabled, const MeshOptimizeOptions &options = {});
+
+// stream instance transforms as format instead of full mat4s, cutting instance bandwidth up to 2.7x. Every
+// instanced program then has to declare the matching attributes and rebuild its model matrix with
+// INSTANCE_FORMAT_GLSL. Conversion assumes the transforms are affine (rigid with uniform scale for the rigid formats)
+void set_instance_format(InstanceFormat format);
+
+InstanceFormat get_instance_format();
+
+// simplify entity's mesh into a chain of detail levels and draw each instance at the level matching its projected
+// size from then on. The chain is rebuilt whenever the mesh is updated. False when nothing could be simplified
+bool generate_lods(entt::entity entity, const LodSettings &settings = {});
+
+// nullptr without LODs
+const std::vector<LodLevel> *get_lod_levels(entt::entity entity);
+
+// propagate Transform changes down the hierarchy and into the Mat4Instances slots they target. render() does this
+// first thing, call it directly when world matrices are needed earlier in the frame
+void update_transforms();
+
+// world matrix of entity's Transform as of the last update, nullptr without one
+const glm::mat4 *get_world_transform(entt::entity entity);
+
+// nodes, depths and matrices recomputed/written by the last update
+TransformStats get_transform_stats();
+
+// keep a bounding volume hierarchy over every instance of every mesh, updated from instance changes at the start
+// of render() and before each query. Costs a box per changed instance, so leave it off when nothing queries it
+void enable_spatial_index();
+
+bool has_spatial_index();
+
+// replace the contents of keys with the (mesh entity, instance slot) of every instance whose world box touches the
+// frustum, sphere or box and return how many there are. Empty without the index
+std::size_t query_instances(const Frustum &frustum, std::vector<InstanceKey> &keys);
+
+std::size_t query_instances(const glm::vec3 &center, float radius, std::vector<InstanceKey> &keys);
+
+std::size_t query_instances(const Aabb &box, std::vector<InstanceKey> &keys);
+
+SpatialIndexStats get_spatial_index_stats();
+
+// world space ray through cursor, in window coordinates as GLFW reports them, for camera under get_projection()
+Ray get_mouse_ray(const Camera &camera, const glm::vec2 &cursor);
+
+// nearest triangle of any mesh instance under cursor as seen by camera. False when there is none
+bool pick(const Camera &camera, const glm::vec2 &cursor, PickHit &hit);
+
+// Nearest triangle of any mesh instance along ray within max_distance. Turns the spatial index on for the broadphase
+// and gives each instanced mesh a TriangleBvh from its CPU side geometry the first time, which it keeps until the
+// mesh is updated. Only the full detail geometry is tested, whatever level of detail is drawn
+bool pick(const Ray &ray, PickHit &hit, float max_distance = std::numeric_limits<float>::max());
+
+// make font available to TextSprite components in the render registry under name
+void register_font(const std::string &name, std::shared_ptr<Font> font);
+
+// cache linked program binaries in directory, programs loaded afterwards are restored from it when the sources
+// and driver match. Call after init(), an empty path disables the cache
+void set_program_cache_directory(const std::string &directory);
+
+// hits, misses and time saved by the program cache so far
+ProgramCacheStats get_program_cache_stats();
+
+// total bytes given to the driver through buffer objects since startup, diff it across frames for a per frame cost
+std::size_t get_bytes_uploaded();
+
+bool is_headless();
+
+// draws and state changes issued/avoided by the render queue over the last render() call
+QueueStats get_queue_stats();
+
+// GL binds issued and skipped as redundant by the state cache over the last frame, uploads included
+GLStateStats get_gl_state_stats();
+
+// Move the context to a dedicated render thread: render() then only snapshots the registry into a frame packet
+// and returns while the previous one is being issued. Loading functions in this header forward to the render
+// thread, other GL work (e.g. constructing a Shader) has to go through run_on_render_context
+void start_render_thread();
+
+// issue the last packet, join and make the context current on the calling thread again
+void stop_render_thread();
+
+bool has_render_thread();
+
+// runs task with the context current and waits for it, directly when there is no render thread
+void run_on_render_context(const std::function<void()> &task);
+
+// returns a texture name immediately, the image is decoded off thread and uploaded over the following frames
+GLuint load_texture_async(const std::string &path);
+
+// same for an encoded PNG in memory, e.g. embedded in a glTF binary. name only labels decode errors
+GLuint load_texture_async(std::vector<unsigned char> encoded, const std::string &name);
+
+// bytes of streamed texture data uploaded per render() call. A soft limit: at least one row of the next texture goes
+// up every frame, so a single row wider than the budget, or the last rows before it runs out, can go past it
+void set_texture_upload_budget(std::size_t bytes);
+
+TextureStreamStats get_texture_stream_stats();
+
 void load_texture(GLuint *texture, unsigned int width, unsigned int height, int internalformat, int format, int type, void *data);
 
 GLuint load_transform_shader(const char *vertex_source, const char *fragment_source, const char *geometry_source);
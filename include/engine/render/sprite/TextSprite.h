@@ -25,14 +25,14 @@ SOFTWARE.
 #ifndef ENGINE_TEXTSPRITE_H
 #define ENGINE_TEXTSPRITE_H
 
-#include <engine/render/VertexArrayObject.h>
 #include <glm/glm.hpp>
 #include <string>
 #include <utility>
 
 
 namespace engine::render {
-struct TextSprite : VertexArrayObject {
+// text drawn in screen pixels by the batched text renderer, (x, y) is the start of the baseline
+struct TextSprite {
 	TextSprite() = default;
 
 	TextSprite(std::string font, std::string text, float x, float y, float scale, glm::vec3 color)
@@ -0,0 +1,93 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_UNIFORMS_H
+#define ENGINE_UNIFORMS_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+
+namespace engine::render {
+
+// Pre-resolved uniform location, the type parameter picks the glUniform* call at compile time
+template <typename T>
+struct Uniform {
+	GLint location{-1};
+
+	explicit operator bool() const {
+		return location >= 0;
+	}
+};
+
+inline void set_uniform(GLint location, bool value) {
+	glUniform1i(location, (int)value);
+}
+
+inline void set_uniform(GLint location, int value) {
+	glUniform1i(location, value);
+}
+
+inline void set_uniform(GLint location, float value) {
+	glUniform1f(location, value);
+}
+
+inline void set_uniform(GLint location, const glm::vec2 &value) {
+	glUniform2fv(location, 1, &value[0]);
+}
+
+inline void set_uniform(GLint location, const glm::vec3 &value) {
+	glUniform3fv(location, 1, &value[0]);
+}
+
+inline void set_uniform(GLint location, const glm::vec4 &value) {
+	glUniform4fv(location, 1, &value[0]);
+}
+
+inline void set_uniform(GLint location, const glm::mat2 &value) {
+	glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]);
+}
+
+inline void set_uniform(GLint location, const glm::mat3 &value) {
+	glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
+}
+
+inline void set_uniform(GLint location, const glm::mat4 &value) {
+	glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+}
+
+// Per camera data shared by every program through a std140 uniform block. Declare it in GLSL as
+//   layout(std140) uniform Frame { mat4 vp; mat4 view; mat4 projection; vec4 camera_position; vec4 time; };
+// and it is bound automatically when the program is reflected
+struct FrameUniforms {
+	glm::mat4 vp;
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 camera_position;
+	// x: seconds since init, y: seconds since last frame, z: interpolation alpha between fixed steps
+	glm::vec4 time;
+};
+
+constexpr const char *FRAME_BLOCK_NAME{"Frame"};
+constexpr GLuint FRAME_BLOCK_BINDING{0};
+
+} // namespace engine::render
+
+#endif //ENGINE_UNIFORMS_H
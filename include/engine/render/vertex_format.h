@@ -0,0 +1,201 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ENGINE_VERTEX_FORMAT_H
+#define ENGINE_VERTEX_FORMAT_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <engine/render/VertexAttribute.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <type_traits>
+#include <vector>
+
+
+namespace engine::render {
+
+// two 16 bit floats, GL_HALF_FLOAT. Plenty for texture coordinates within a few repeats of [0, 1]
+struct Half2 {
+	std::uint16_t x{0}, y{0};
+
+	Half2() = default;
+
+	explicit Half2(const glm::vec2 &value) : x(glm::packHalf1x16(value.x)), y(glm::packHalf1x16(value.y)) {}
+
+	glm::vec2 unpack() const {
+		return {glm::unpackHalf1x16(x), glm::unpackHalf1x16(y)};
+	}
+};
+
+// four 16 bit floats, three would leave the next field misaligned
+struct Half4 {
+	std::uint16_t x{0}, y{0}, z{0}, w{0};
+
+	Half4() = default;
+
+	explicit Half4(const glm::vec4 &value)
+			: x(glm::packHalf1x16(value.x)),
+			  y(glm::packHalf1x16(value.y)),
+			  z(glm::packHalf1x16(value.z)),
+			  w(glm::packHalf1x16(value.w)) {}
+
+	glm::vec4 unpack() const {
+		return {glm::unpackHalf1x16(x), glm::unpackHalf1x16(y), glm::unpackHalf1x16(z), glm::unpackHalf1x16(w)};
+	}
+};
+
+// signed normalized xyz in 10 bits each plus a 2 bit w, GL_INT_2_10_10_10_REV. For normals, or tangents with the
+// bitangent sign in w
+struct PackedNormal {
+	std::uint32_t bits{0};
+
+	PackedNormal() = default;
+
+	explicit PackedNormal(const glm::vec3 &normal, float w = 0.f)
+			: bits(glm::packSnorm3x10_1x2(glm::vec4(normal, w))) {}
+
+	glm::vec4 unpack() const {
+		return glm::unpackSnorm3x10_1x2(bits);
+	}
+};
+
+// unsigned normalized 8 bit channels, GL_UNSIGNED_BYTE
+struct Color8 {
+	std::uint8_t r{0}, g{0}, b{0}, a{255};
+
+	Color8() = default;
+
+	explicit Color8(const glm::vec4 &color)
+			: r(to_byte(color.x)), g(to_byte(color.y)), b(to_byte(color.z)), a(to_byte(color.w)) {}
+
+	explicit Color8(const glm::vec3 &color) : Color8(glm::vec4(color, 1.f)) {}
+
+	glm::vec4 unpack() const {
+		return glm::vec4(r, g, b, a) / 255.f;
+	}
+
+private:
+	static std::uint8_t to_byte(float value) {
+		return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+	}
+};
+
+// how a field type is handed to glVertexAttrib(I)Pointer, specialize for other field types
+template <typename T>
+struct AttributeTraits;
+
+template <GLint Components, GLenum Type, bool Normalized = false, bool Integer = false>
+struct AttributeTraitsOf {
+	static constexpr GLint components{Components};
+	static constexpr GLenum type{Type};
+	static constexpr bool normalized{Normalized};
+	static constexpr bool integer{Integer};
+};
+
+template <> struct AttributeTraits<float> : AttributeTraitsOf<1, GL_FLOAT> {};
+template <> struct AttributeTraits<glm::vec2> : AttributeTraitsOf<2, GL_FLOAT> {};
+template <> struct AttributeTraits<glm::vec3> : AttributeTraitsOf<3, GL_FLOAT> {};
+template <> struct AttributeTraits<glm::vec4> : AttributeTraitsOf<4, GL_FLOAT> {};
+template <> struct AttributeTraits<Half2> : AttributeTraitsOf<2, GL_HALF_FLOAT> {};
+template <> struct AttributeTraits<Half4> : AttributeTraitsOf<4, GL_HALF_FLOAT> {};
+template <> struct AttributeTraits<PackedNormal> : AttributeTraitsOf<4, GL_INT_2_10_10_10_REV, true> {};
+template <> struct AttributeTraits<Color8> : AttributeTraitsOf<4, GL_UNSIGNED_BYTE, true> {};
+template <> struct AttributeTraits<std::int32_t> : AttributeTraitsOf<1, GL_INT, false, true> {};
+template <> struct AttributeTraits<std::uint32_t> : AttributeTraitsOf<1, GL_UNSIGNED_INT, false, true> {};
+
+// one field of a vertex struct, everything needed to point an attribute at it
+struct AttributeFormat {
+	GLint components;
+	GLenum type;
+	bool normalized;
+	bool integer;
+	std::size_t offset;
+
+	VertexAttribute to_attribute(GLsizei stride) const {
+		return VertexAttribute(components, type, normalized, stride, reinterpret_cast<const void*>(offset), integer);
+	}
+};
+
+template <typename T>
+constexpr AttributeFormat attribute_format(std::size_t offset) {
+	using Traits = AttributeTraits<T>;
+	return {Traits::components, Traits::type, Traits::normalized, Traits::integer, offset};
+}
+
+// describes the field member of the standard layout struct type
+#define ENGINE_VERTEX_ATTRIBUTE(type, member) \
+	::engine::render::attribute_format<decltype(type::member)>(offsetof(type, member))
+
+// Specialize for a vertex struct, fields in attribute location order:
+//   template <> struct VertexLayout<MyVertex> {
+//       static constexpr std::array attributes{ENGINE_VERTEX_ATTRIBUTE(MyVertex, position),
+//                                              ENGINE_VERTEX_ATTRIBUTE(MyVertex, normal)};
+//   };
+template <typename Vertex>
+struct VertexLayout;
+
+// enable every attribute of Vertex at consecutive locations from first_location, reading the bound array buffer.
+// Returns the next free location
+template <typename Vertex>
+GLuint bind_vertex_layout(GLuint first_location = 0, GLuint divisor = 0, GLintptr base_offset = 0) {
+	static_assert(std::is_standard_layout_v<Vertex>, "offsetof needs a standard layout vertex type");
+	auto location = first_location;
+	for (const auto &format: VertexLayout<Vertex>::attributes)
+		format.to_attribute(sizeof(Vertex)).bind(location++, divisor, base_offset);
+	return location;
+}
+
+// the attributes of Vertex in location order, e.g. for InstanceSet::get_attributes
+template <typename Vertex>
+std::vector<VertexAttribute> layout_attributes() {
+	static_assert(std::is_standard_layout_v<Vertex>, "offsetof needs a standard layout vertex type");
+	std::vector<VertexAttribute> attributes;
+	for (const auto &format: VertexLayout<Vertex>::attributes)
+		attributes.push_back(format.to_attribute(sizeof(Vertex)));
+	return attributes;
+}
+
+// 24 bytes against the 32 of Mesh<>'s three float streams, and it has a normal. Locations 0-2 line up with Mesh<>
+// (position, color, uv) so shaders only have to add the normal at 3 and move the instance attributes to 4
+struct PackedVertex {
+	glm::vec3 position{0};
+	Color8 color;
+	Half2 uv;
+	PackedNormal normal;
+};
+
+template <>
+struct VertexLayout<PackedVertex> {
+	static constexpr std::array attributes{ENGINE_VERTEX_ATTRIBUTE(PackedVertex, position),
+	                                       ENGINE_VERTEX_ATTRIBUTE(PackedVertex, color),
+	                                       ENGINE_VERTEX_ATTRIBUTE(PackedVertex, uv),
+	                                       ENGINE_VERTEX_ATTRIBUTE(PackedVertex, normal)};
+};
+
+static_assert(sizeof(PackedVertex) == 24);
+
+} // namespace engine::render
+
+#endif //ENGINE_VERTEX_FORMAT_H
@@ -0,0 +1,96 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/AtlasPacker.h>
+
+#include <algorithm>
+#include <limits>
+
+
+namespace engine::render {
+
+AtlasPacker::AtlasPacker(int width, int height) : m_width(width), m_height(height) {
+	m_skyline.push_back({0, 0, width});
+}
+
+bool AtlasPacker::pack(int width, int height, glm::ivec2 &position) {
+	auto best_y = std::numeric_limits<int>::max();
+	auto best_width = std::numeric_limits<int>::max();
+	auto best = m_skyline.size();
+	for (std::size_t i = 0; i < m_skyline.size(); ++i) {
+		auto y = fit(i, width, height);
+		if (y < 0)
+			continue;
+		// prefer the lowest spot, then the narrowest segment to keep wide gaps for wide rectangles
+		if (y < best_y || (y == best_y && m_skyline[i].width < best_width)) {
+			best = i;
+			best_y = y;
+			best_width = m_skyline[i].width;
+		}
+	}
+	if (best == m_skyline.size())
+		return false;
+	position = {m_skyline[best].x, best_y};
+
+	// raise the skyline under the new rectangle and trim whatever it now covers
+	Segment placed{position.x, best_y + height, width};
+	m_skyline.insert(m_skyline.begin() + best, placed);
+	auto right = placed.x + placed.width;
+	auto i = best + 1;
+	while (i < m_skyline.size() && m_skyline[i].x < right) {
+		auto &segment = m_skyline[i];
+		auto overlap = right - segment.x;
+		if (overlap >= segment.width) {
+			m_skyline.erase(m_skyline.begin() + i);
+			continue;
+		}
+		segment.x += overlap;
+		segment.width -= overlap;
+		break;
+	}
+	// merge neighbours left at the same height
+	for (i = 0; i + 1 < m_skyline.size();) {
+		if (m_skyline[i].y == m_skyline[i + 1].y) {
+			m_skyline[i].width += m_skyline[i + 1].width;
+			m_skyline.erase(m_skyline.begin() + i + 1);
+		} else
+			++i;
+	}
+	return true;
+}
+
+int AtlasPacker::fit(std::size_t index, int width, int height) const {
+	auto x = m_skyline[index].x;
+	if (x + width > m_width)
+		return -1;
+	auto y = m_skyline[index].y;
+	auto remaining = width;
+	for (auto i = index; remaining > 0; ++i) {
+		if (i == m_skyline.size())
+			return -1;
+		y = std::max(y, m_skyline[i].y);
+		if (y + height > m_height)
+			return -1;
+		remaining -= m_skyline[i].width;
+	}
+	return y;
+}
+
+} // namespace engine::render
@@ -0,0 +1,291 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/GeometryPool.h>
+
+#include <algorithm>
+#include <engine/render/glm_attributes.h>
+#include <engine/render/GLState.h>
+
+
+namespace engine::render {
+
+namespace {
+
+constexpr GLuint INITIAL_VERTICES{1 << 16};
+constexpr GLuint INITIAL_INDICES{1 << 18};
+
+// move buffer contents into a larger allocation, the old name is deleted
+void grow(GLuint &buffer, GLsizeiptr old_size, GLsizeiptr new_size) {
+	GLuint resized;
+	glGenBuffers(1, &resized);
+	gl_state().bind_buffer(GL_COPY_WRITE_BUFFER, resized);
+	glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+	if (buffer) {
+		if (old_size > 0) {
+			gl_state().bind_buffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+		}
+		gl_state().delete_buffers(1, &buffer);
+	}
+	buffer = resized;
+}
+
+template <typename T>
+void write_buffer(GLuint buffer, GLuint offset, const std::vector<T> &data, std::size_t count) {
+	gl_state().bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+	uploaded_bytes().fetch_add(count * sizeof(T), std::memory_order_relaxed);
+	if (data.size() >= count) {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset * sizeof(T), count * sizeof(T), data.data());
+		return;
+	}
+	// pad missing attributes so every stream stays aligned with the positions
+	std::vector<T> padded(data);
+	padded.resize(count, T(0));
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset * sizeof(T), count * sizeof(T), padded.data());
+}
+
+} // anonymous
+
+GLuint RangeAllocator::allocate(GLuint size) {
+	for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+		if (it->size < size)
+			continue;
+		auto offset = it->offset;
+		it->offset += size;
+		it->size -= size;
+		if (it->size == 0)
+			m_free.erase(it);
+		return offset;
+	}
+	auto offset = m_end;
+	m_end += size;
+	return offset;
+}
+
+void RangeAllocator::release(GLuint offset, GLuint size) {
+	if (size == 0)
+		return;
+	auto it = std::lower_bound(m_free.begin(), m_free.end(), offset,
+	                           [](const Block &block, GLuint value) { return block.offset < value; });
+	it = m_free.insert(it, Block{offset, size});
+	// merge with the following block then the preceding one
+	auto next = std::next(it);
+	if (next != m_free.end() && it->offset + it->size == next->offset) {
+		it->size += next->size;
+		m_free.erase(next);
+	}
+	if (it != m_free.begin()) {
+		auto prev = std::prev(it);
+		if (prev->offset + prev->size == it->offset) {
+			prev->size += it->size;
+			m_free.erase(it);
+		}
+	}
+}
+
+GeometryPool::GeometryPool() {
+	glGenVertexArrays(1, &m_vao);
+	reserve(INITIAL_VERTICES, INITIAL_INDICES);
+}
+
+GeometryPool::~GeometryPool() {
+	GLuint buffers[] = {m_positions, m_colors, m_uvs, m_indices};
+	gl_state().delete_buffers(4, buffers);
+	gl_state().delete_vertex_arrays(1, &m_vao);
+}
+
+GeometryRange GeometryPool::add(const std::vector<glm::vec3> &vertices,
+                                const std::vector<glm::vec3> &colors,
+                                const std::vector<glm::vec2> &uvs,
+                                const std::vector<unsigned int> &indices) {
+	GeometryRange range;
+	range.vertex_count = vertices.size();
+	range.index_count = indices.size();
+	range.base_vertex = m_vertex_allocator.allocate(range.vertex_count);
+	range.first_index = m_index_allocator.allocate(range.index_count);
+	reserve(m_vertex_allocator.end(), m_index_allocator.end());
+	write(range, vertices, colors, uvs, indices);
+	return range;
+}
+
+GeometryRange GeometryPool::update(const GeometryRange &range,
+                                   const std::vector<glm::vec3> &vertices,
+                                   const std::vector<glm::vec3> &colors,
+                                   const std::vector<glm::vec2> &uvs,
+                                   const std::vector<unsigned int> &indices) {
+	if (vertices.size() > range.vertex_count || indices.size() > range.index_count) {
+		remove(range);
+		return add(vertices, colors, uvs, indices);
+	}
+	// shrink in place and hand the tail back to the allocators
+	GeometryRange updated = range;
+	updated.vertex_count = vertices.size();
+	updated.index_count = indices.size();
+	m_vertex_allocator.release(range.base_vertex + updated.vertex_count, range.vertex_count - updated.vertex_count);
+	m_index_allocator.release(range.first_index + updated.index_count, range.index_count - updated.index_count);
+	write(updated, vertices, colors, uvs, indices);
+	return updated;
+}
+
+void GeometryPool::remove(const GeometryRange &range) {
+	m_vertex_allocator.release(range.base_vertex, range.vertex_count);
+	m_index_allocator.release(range.first_index, range.index_count);
+}
+
+void GeometryPool::draw(const GeometryRange &range, GLenum mode, GLuint texture, const glm::mat4 *transforms,
+                        std::size_t count) {
+	if (count == 0 || range.index_count == 0)
+		return;
+	DrawElementsIndirectCommand command{
+			range.index_count,
+			static_cast<GLuint>(count),
+			range.first_index,
+			static_cast<GLint>(range.base_vertex),
+			static_cast<GLuint>(m_transforms.size())};
+	m_transforms.insert(m_transforms.end(), transforms, transforms + count);
+	m_draws.push_back({mode, texture, command});
+}
+
+void GeometryPool::submit() {
+	m_draw_calls = 0;
+	m_command_count = m_draws.size();
+	if (m_draws.empty())
+		return;
+	// group by texture so each group can go out as a single multi draw
+	std::stable_sort(m_draws.begin(), m_draws.end(), [](const PendingDraw &a, const PendingDraw &b) {
+		return a.texture < b.texture || (a.texture == b.texture && a.mode < b.mode);
+	});
+	m_commands.clear();
+	for (const auto &draw: m_draws)
+		m_commands.push_back(draw.command);
+
+	gl_state().bind_vertex_array(m_vao);
+	GLintptr instance_offset;
+	if (m_instance_format == InstanceFormat::mat4)
+		instance_offset = m_instance_buffer.write(m_transforms.data(), m_transforms.size() * sizeof(glm::mat4));
+	else {
+		pack_instances(m_instance_format, m_transforms.data(), m_transforms.size(), m_packed);
+		instance_offset = m_instance_buffer.write(m_packed.data(), m_packed.size());
+	}
+	bind_instance_attributes(instance_offset);
+
+	bool multi_draw = GLEW_ARB_multi_draw_indirect;
+	GLintptr indirect_offset{0};
+	if (multi_draw)
+		indirect_offset = m_indirect_buffer.write(m_commands.data(),
+		                                          m_commands.size() * sizeof(DrawElementsIndirectCommand));
+
+	std::size_t first{0};
+	while (first < m_draws.size()) {
+		auto last = first;
+		while (last < m_draws.size() && m_draws[last].texture == m_draws[first].texture
+		       && m_draws[last].mode == m_draws[first].mode)
+			++last;
+		auto mode = m_draws[first].mode;
+		if (m_draws[first].texture) {
+			gl_state().bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, m_draws[first].texture);
+		}
+		if (multi_draw) {
+			glMultiDrawElementsIndirect(mode,
+			                            GL_UNSIGNED_INT,
+			                            (void*) (indirect_offset + first * sizeof(DrawElementsIndirectCommand)),
+			                            static_cast<GLsizei>(last - first),
+			                            0);
+			++m_draw_calls;
+		} else {
+			for (auto i = first; i < last; ++i) {
+				const auto &command = m_commands[i];
+				auto index_offset = (void*) (command.first_index * sizeof(unsigned int));
+				if (GLEW_ARB_base_instance)
+					glDrawElementsInstancedBaseVertexBaseInstance(mode,
+					                                              command.count,
+					                                              GL_UNSIGNED_INT,
+					                                              index_offset,
+					                                              command.instance_count,
+					                                              command.base_vertex,
+					                                              command.base_instance);
+				else {
+					m_instance_buffer.bind();
+					bind_instance_attributes(instance_offset + command.base_instance * instance_size(m_instance_format));
+					glDrawElementsInstancedBaseVertex(mode,
+					                                  command.count,
+					                                  GL_UNSIGNED_INT,
+					                                  index_offset,
+					                                  command.instance_count,
+					                                  command.base_vertex);
+				}
+				++m_draw_calls;
+			}
+		}
+		first = last;
+	}
+	m_draws.clear();
+	m_transforms.clear();
+}
+
+void GeometryPool::reserve(GLuint vertex_count, GLuint index_count) {
+	bool rebind{false};
+	if (vertex_count > m_vertex_capacity) {
+		auto capacity = std::max(vertex_count, 2 * m_vertex_capacity);
+		grow(m_positions, m_vertex_capacity * sizeof(glm::vec3), capacity * sizeof(glm::vec3));
+		grow(m_colors, m_vertex_capacity * sizeof(glm::vec3), capacity * sizeof(glm::vec3));
+		grow(m_uvs, m_vertex_capacity * sizeof(glm::vec2), capacity * sizeof(glm::vec2));
+		m_vertex_capacity = capacity;
+		rebind = true;
+	}
+	if (index_count > m_index_capacity) {
+		auto capacity = std::max(index_count, 2 * m_index_capacity);
+		grow(m_indices, m_index_capacity * sizeof(unsigned int), capacity * sizeof(unsigned int));
+		m_index_capacity = capacity;
+		rebind = true;
+	}
+	if (rebind)
+		bind_vertex_attributes();
+}
+
+void GeometryPool::write(const GeometryRange &range,
+                         const std::vector<glm::vec3> &vertices,
+                         const std::vector<glm::vec3> &colors,
+                         const std::vector<glm::vec2> &uvs,
+                         const std::vector<unsigned int> &indices) {
+	write_buffer(m_positions, range.base_vertex, vertices, range.vertex_count);
+	write_buffer(m_colors, range.base_vertex, colors, range.vertex_count);
+	write_buffer(m_uvs, range.base_vertex, uvs, range.vertex_count);
+	write_buffer(m_indices, range.first_index, indices, range.index_count);
+}
+
+void GeometryPool::bind_vertex_attributes() {
+	gl_state().bind_vertex_array(m_vao);
+	gl_state().bind_buffer(GL_ARRAY_BUFFER, m_positions);
+	Vec3Attribute().bind(0);
+	gl_state().bind_buffer(GL_ARRAY_BUFFER, m_colors);
+	Vec3Attribute().bind(1);
+	gl_state().bind_buffer(GL_ARRAY_BUFFER, m_uvs);
+	Vec2Attribute().bind(2);
+	gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, m_indices);
+	gl_state().bind_vertex_array(0);
+}
+
+void GeometryPool::bind_instance_attributes(GLintptr offset) {
+	bind_instance_format(m_instance_format, 3, offset);
+}
+
+} // namespace engine::render
@@ -0,0 +1,154 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/ProgramCache.h>
+
+#include <cstring>
+#include <engine/render/GLState.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+
+
+namespace engine::render {
+
+namespace {
+
+constexpr char MAGIC[4] = {'E', 'P', 'G', 'C'};
+
+struct FileHeader {
+	char magic[4];
+	GLenum format;
+	GLint length;
+};
+
+// 64 bit FNV-1a, stable across runs and platforms unlike std::hash
+std::uint64_t fnv1a(const char *data, std::size_t length, std::uint64_t hash = 0xcbf29ce484222325ull) {
+	for (std::size_t i = 0; i < length; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+std::string gl_string(GLenum name) {
+	auto value = glGetString(name);
+	return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+} // anonymous
+
+ProgramCache::ProgramCache(std::filesystem::path directory) : m_directory(std::move(directory)) {
+	m_driver = gl_string(GL_VENDOR) + '\n' + gl_string(GL_RENDERER) + '\n' + gl_string(GL_VERSION);
+	GLint formats{0};
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	m_supported = formats > 0;
+	if (!m_supported)
+		return;
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	if (error) {
+		std::cerr << "Could not create program cache directory '" << m_directory << "': " << error.message()
+		          << std::endl;
+		m_supported = false;
+	}
+}
+
+std::uint64_t ProgramCache::make_key(const std::vector<const char*> &sources) const {
+	auto hash = fnv1a(m_driver.data(), m_driver.size());
+	for (auto source: sources) {
+		// separate stages so moving text between them changes the key
+		hash = fnv1a("\0", 1, hash);
+		if (source != nullptr)
+			hash = fnv1a(source, std::strlen(source), hash);
+	}
+	return hash;
+}
+
+GLuint ProgramCache::load(std::uint64_t key) {
+	if (!m_supported)
+		return 0;
+	auto start = std::chrono::steady_clock::now();
+	std::ifstream file(path_for(key), std::ios::binary);
+	if (!file)
+		return 0;
+	FileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.length <= 0)
+		return 0;
+	std::vector<char> binary(header.length);
+	file.read(binary.data(), header.length);
+	if (!file)
+		return 0;
+
+	auto program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), header.length);
+	GLint success{0};
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		// the driver rejected it (e.g. changed under the same version string), fall back to compiling
+		gl_state().delete_program(program);
+		return 0;
+	}
+	++m_stats.hits;
+	m_stats.hit_time += std::chrono::steady_clock::now() - start;
+	return program;
+}
+
+void ProgramCache::store(std::uint64_t key, GLuint program, std::chrono::nanoseconds compile_time) {
+	++m_stats.misses;
+	m_stats.miss_time += compile_time;
+	if (!m_supported)
+		return;
+	GLint length{0};
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	FileHeader header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	glGetProgramBinary(program, length, &header.length, &header.format, binary.data());
+	if (header.length <= 0)
+		return;
+
+	// write next to the final name and rename so a crash never leaves a truncated entry behind
+	auto path = path_for(key);
+	auto temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), header.length);
+		if (!file) {
+			std::cerr << "Could not write program cache entry '" << temporary << "'" << std::endl;
+			return;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+		std::filesystem::remove(temporary, error);
+}
+
+std::filesystem::path ProgramCache::path_for(std::uint64_t key) const {
+	return m_directory / fmt::format("{:016x}.bin", key);
+}
+
+} // namespace engine::render
@@ -0,0 +1,79 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/RenderQueue.h>
+
+#include <algorithm>
+
+
+namespace engine::render {
+
+std::uint64_t RenderQueue::make_key(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth) {
+	// depth is expected in [0, 1], front to back
+	auto quantized = static_cast<std::uint64_t>(std::clamp(depth, 0.f, 1.f) * 0xffff);
+	return (static_cast<std::uint64_t>(pass & 0xf) << 60)
+	       | (static_cast<std::uint64_t>(program & 0xfff) << 48)
+	       | (static_cast<std::uint64_t>(texture & 0xffff) << 32)
+	       | (static_cast<std::uint64_t>(vao & 0xffff) << 16)
+	       | quantized;
+}
+
+void RenderQueue::push(std::uint64_t key, const DrawCommand &command) {
+	m_keys.push_back(key);
+	m_commands.push_back(command);
+}
+
+void RenderQueue::sort() {
+	auto n = m_keys.size();
+	m_sorted.resize(n);
+	m_scratch.resize(n);
+	for (std::uint32_t i = 0; i < n; ++i)
+		m_sorted[i] = {m_keys[i], i};
+
+	// LSD radix sort one byte at a time, all eight histograms are built in a single pass over the keys
+	std::size_t counts[8][256]{};
+	for (auto key: m_keys)
+		for (int b = 0; b < 8; ++b)
+			++counts[b][(key >> (8 * b)) & 0xff];
+
+	for (int b = 0; b < 8; ++b) {
+		auto &count = counts[b];
+		// every key shares this byte so the pass wouldn't move anything
+		if (n == 0 || count[(m_keys[0] >> (8 * b)) & 0xff] == n)
+			continue;
+		std::size_t offsets[256];
+		std::size_t sum{0};
+		for (int i = 0; i < 256; ++i) {
+			offsets[i] = sum;
+			sum += count[i];
+		}
+		for (const auto &item: m_sorted)
+			m_scratch[offsets[(item.key >> (8 * b)) & 0xff]++] = item;
+		std::swap(m_sorted, m_scratch);
+	}
+}
+
+void RenderQueue::clear() {
+	m_keys.clear();
+	m_commands.clear();
+	m_sorted.clear();
+}
+
+} // namespace engine::render
@@ -0,0 +1,148 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/RenderThread.h>
+
+#include <engine/profiler.h>
+
+
+namespace engine::render {
+
+RenderThread::RenderThread(GLFWwindow *window, PacketCallback execute, bool present)
+		: m_window(window), m_execute(std::move(execute)), m_present(present) {
+	// a context can only be current on one thread at a time
+	glfwMakeContextCurrent(nullptr);
+	m_thread = std::thread(&RenderThread::loop, this);
+}
+
+RenderThread::~RenderThread() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+	glfwMakeContextCurrent(m_window);
+}
+
+FramePacket &RenderThread::begin_frame() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this] { return m_issuing != m_writing; });
+	m_packets[m_writing].clear();
+	return m_packets[m_writing];
+}
+
+void RenderThread::end_frame() {
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		// at most one packet waits, a second would mean the simulation is more than a frame ahead
+		m_condition.wait(lock, [this] { return m_pending == NONE; });
+		m_pending = m_writing;
+		m_writing = 1 - m_writing;
+		++m_packets_ended;
+	}
+	m_condition.notify_all();
+}
+
+void RenderThread::post(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+		++m_tasks_posted;
+	}
+	m_condition.notify_all();
+}
+
+void RenderThread::release(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_releases.push_back({m_packets_ended, std::move(task)});
+	}
+	m_condition.notify_all();
+}
+
+void RenderThread::invoke(const std::function<void()> &task) {
+	if (is_current()) {
+		task();
+		return;
+	}
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_tasks.emplace_back(task);
+	auto ticket = ++m_tasks_posted;
+	m_condition.notify_all();
+	m_condition.wait(lock, [this, ticket] { return m_tasks_done >= ticket; });
+}
+
+void RenderThread::loop() {
+	ENGINE_PROFILE_THREAD("render");
+	glfwMakeContextCurrent(m_window);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_condition.wait(lock, [this] {
+			return m_stopping || !m_tasks.empty() || m_pending != NONE
+			       || (!m_releases.empty() && m_releases.front().packets <= m_packets_issued);
+		});
+		// tasks first so resources created for a frame exist before it is issued
+		while (!m_tasks.empty()) {
+			auto task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+			++m_tasks_done;
+			m_condition.notify_all();
+		}
+		run_releases(lock, false);
+		if (m_pending != NONE) {
+			m_issuing = m_pending;
+			m_pending = NONE;
+			m_condition.notify_all();
+			lock.unlock();
+			m_execute(m_packets[m_issuing]);
+			if (m_present)
+				glfwSwapBuffers(m_window);
+			else
+				glFlush();
+			ENGINE_PROFILE_FRAME();
+			lock.lock();
+			m_issuing = NONE;
+			++m_packets_issued;
+			m_condition.notify_all();
+			// whatever was released while the packet was built or waiting can go now that it has been issued
+			run_releases(lock, false);
+		} else if (m_stopping)
+			break;
+	}
+	// no packets follow
+	run_releases(lock, true);
+	glfwMakeContextCurrent(nullptr);
+}
+
+void RenderThread::run_releases(std::unique_lock<std::mutex> &lock, bool all) {
+	while (!m_releases.empty() && (all || m_releases.front().packets <= m_packets_issued)) {
+		auto task = std::move(m_releases.front().task);
+		m_releases.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+} // namespace engine::render
@@ -24,16 +24,40 @@ SOFTWARE.
 
 #include <engine/render/renderer.h>
 
+#include <algorithm>
+#include <cstring>
+#include <engine/profiler.h>
+#include <engine/render/AtlasPacker.h>
 #include <engine/render/buffer_objects.h>
 #include <engine/render/camera/Camera.h>
+#include <engine/render/culling.h>
+#include <engine/render/GeometryPool.h>
 #include <engine/render/glm_attributes.h>
+#include <engine/render/GLState.h>
 #include <engine/render/instance_containers.h>
+#include <engine/render/InterleavedMesh.h>
+#include <engine/render/lod.h>
+#include <engine/render/MappedMesh.h>
 #include <engine/render/Mesh.h>
+#include <engine/render/mesh_optimizer.h>
+#include <engine/render/occlusion.h>
+#include <engine/render/picking.h>
+#include <engine/render/ProgramCache.h>
+#include <engine/render/RenderQueue.h>
+#include <engine/render/RenderThread.h>
 #include <engine/render/Shader.h>
+#include <engine/render/SpatialIndex.h>
+#include <engine/render/TextRenderer.h>
+#include <engine/render/TextureStreamer.h>
+#include <engine/render/TransformHierarchy.h>
 #include <fmt/format.h>
+#include <functional>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <set>
 #include <stdexcept>
 #include <utils/file_util.h>
 
@@ -44,6 +68,35 @@ namespace { // pseudo-member namespace
 
 entt::registry s_registry;
 entt::entity s_window_entity;
+bool s_frustum_culling{false};
+// set while occlusion culling is on
+OcclusionBuffer::Ptr s_occlusion{nullptr};
+bool s_optimize_meshes{false};
+MeshOptimizeOptions s_optimize_options;
+InstanceFormat s_instance_format{InstanceFormat::mat4};
+// transforms converted to s_instance_format before streaming
+std::vector<std::uint8_t> s_packed_instances;
+RenderQueue s_queue;
+QueueStats s_queue_stats;
+GeometryPool::Ptr s_geometry_pool{nullptr};
+StreamBuffer::Ptr s_frame_uniforms{nullptr};
+ProgramCache::Ptr s_program_cache{nullptr};
+TextRenderer::Ptr s_text_renderer{nullptr};
+TextureStreamer::Ptr s_texture_streamer{nullptr};
+RenderThread::Ptr s_render_thread{nullptr};
+TransformHierarchy s_transforms;
+SpatialIndex::Ptr s_spatial_index{nullptr};
+// instance transforms of the packet being issued
+StreamBuffer::Ptr s_packet_instances{nullptr};
+GLStateStats s_gl_stats;
+// guards s_queue_stats and s_gl_stats while the render thread writes them
+std::mutex s_stats_mutex;
+bool s_headless{false};
+// render target standing in for the window's framebuffer when headless
+GLuint s_offscreen_fbo{0};
+GLuint s_offscreen_color{0};
+GLuint s_offscreen_depth{0};
+std::chrono::nanoseconds s_elapsed{0};
 
 void print_glfw_error(const char* text) {
 	const char** description;
@@ -51,10 +104,17 @@ void print_glfw_error(const char* text) {
 	std::cerr << text << std::endl << *description << std::endl;
 }
 
-bool init_glfw() {
+bool init_glfw(const InitOptions &options) {
 	if (!glfwInit())
 		return false;
 
+	if (options.headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		// software rendering without any display server, needs a GLFW built with OSMesa
+		if (options.osmesa)
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+	}
+
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -75,12 +135,12 @@ bool init_glew() {
 	return true;
 }
 
-bool init_window() {
+bool init_window(const InitOptions &options) {
 	s_window_entity = s_registry.create();
 	auto& window = s_registry.emplace<GLFWwindow*>(s_window_entity);
 	auto& context = s_registry.emplace<RenderContext>(s_window_entity);
-	context.screen_width = 800;
-	context.screen_height = 600;
+	context.screen_width = options.width;
+	context.screen_height = options.height;
 	context.fovy = 45.0f;
 	context.z_near = 0.1f;
 	context.z_far = 1000.0f;
@@ -97,6 +157,7 @@ bool init_window() {
 		return false;
 	}
 	glfwMakeContextCurrent(window); // focus
+	glfwSwapInterval(options.vsync ? 1 : 0);
 
 	// set window projection matrix
 	s_registry.emplace<glm::mat4>(
@@ -106,68 +167,826 @@ bool init_window() {
 	return true;
 }
 
-// entt object lifecycles
-void construct_mesh(entt::registry& registry, entt::entity entity) {
-	auto& mesh = registry.get<Mesh<>>(entity);
+// Invisible windows may not have a usable default framebuffer (and never present it), so headless rendering goes
+// to an FBO of the window's size that stays bound for the lifetime of the context
+bool init_offscreen_target() {
+	const auto &context = get_context();
+	glGenRenderbuffers(1, &s_offscreen_color);
+	glBindRenderbuffer(GL_RENDERBUFFER, s_offscreen_color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, context.screen_width, context.screen_height);
+	glGenRenderbuffers(1, &s_offscreen_depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, s_offscreen_depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, context.screen_width, context.screen_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &s_offscreen_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, s_offscreen_fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, s_offscreen_color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, s_offscreen_depth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+		return false;
+	}
+	glViewport(0, 0, context.screen_width, context.screen_height);
+	return true;
+}
+
+void destroy_offscreen_target() {
+	if (s_offscreen_fbo == 0)
+		return;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &s_offscreen_fbo);
+	GLuint renderbuffers[] = {s_offscreen_color, s_offscreen_depth};
+	glDeleteRenderbuffers(2, renderbuffers);
+	s_offscreen_fbo = s_offscreen_color = s_offscreen_depth = 0;
+}
+
+// GL work from registry callbacks and setup functions runs on the render thread when there is one, the calling
+// thread waits so the components it hands over stay put
+void on_context(const std::function<void()> &task) {
+	if (s_render_thread != nullptr)
+		s_render_thread->invoke(task);
+	else
+		task();
+}
+
+// true when the calling thread has no context and has to go through the render thread
+bool off_context() {
+	return s_render_thread != nullptr && !s_render_thread->is_current();
+}
+
+// point the instance attributes starting at index at offset into the bound array buffer
+void point_instance_attributes(GLuint index, GLintptr offset) {
+	bind_instance_format(s_instance_format, index, offset);
+}
+
+// stream count transforms in the current instance format and leave buffer bound, returns where they landed
+GLintptr write_instances(StreamBuffer &buffer, const glm::mat4 *transforms, std::size_t count) {
+	if (s_instance_format == InstanceFormat::mat4)
+		return buffer.write(transforms, count * sizeof(glm::mat4));
+	pack_instances(s_instance_format, transforms, count, s_packed_instances);
+	return buffer.write(s_packed_instances.data(), s_packed_instances.size());
+}
+
+// convert all instances of entity to the current format into its PackedInstances and leave their buffer bound
+void pack_entity_instances(entt::entity entity, Mat4Instances &instances) {
+	ENGINE_PROFILE_ZONE("render::pack_instances");
+	auto &packed = s_registry.get_or_emplace<PackedInstances>(entity);
+	packed.format = s_instance_format;
+	const auto &transforms = instances.get_data_vector();
+	std::vector<std::uint8_t> bytes;
+	pack_instances(s_instance_format, transforms.data(), transforms.size(), bytes);
+	if (!packed.buffer->get_id())
+		packed.buffer->generate();
+	packed.buffer->bind();
+	if (bytes.empty())
+		return;
+	packed.buffer->set_data(std::move(bytes));
+	packed.buffer->buffer();
+}
+
+// move a pooled mesh's geometry into the pool after it changed, on the context. Packets already built may still draw
+// the old range, so with a render thread the data goes to a fresh range and the old one is only handed back to the
+// allocators once those are issued, the same way destroy_mesh releases it
+GeometryRange update_pool_range(const GeometryRange &range,
+                                const std::vector<glm::vec3> &vertices,
+                                const std::vector<glm::vec3> &colors,
+                                const std::vector<glm::vec2> &uvs,
+                                const std::vector<unsigned int> &indices) {
+	if (s_render_thread == nullptr)
+		return s_geometry_pool->update(range, vertices, colors, uvs, indices);
+	auto updated = s_geometry_pool->add(vertices, colors, uvs, indices);
+	s_render_thread->release([pool = s_geometry_pool, range] { pool->remove(range); });
+	return updated;
+}
+
+// the slice of a pooled mesh's range holding one LOD level
+GeometryRange level_range(const GeometryRange &range, const LodLevel &level) {
+	return {range.base_vertex, range.vertex_count, range.first_index + level.first_index, level.index_count};
+}
+
+void upload_lods(VertexArrayObject &mesh, MeshLods &lods);
+
+// (re)build the LOD chain of entity from its current mesh data
+void build_lods(entt::entity entity, MeshLods &lods) {
+	auto &mesh = s_registry.get<Mesh<>>(entity);
+	const auto &positions = mesh.get_vertex_buffer()->get_data_vector();
+	auto chain = build_lod_chain(positions, mesh.get_element_buffer()->get_data_vector(), lods.settings);
+	lods.levels = std::move(chain.levels);
+	// level 0 is the mesh's own order, already optimized at construction when enabled
+	if (s_optimize_meshes && s_optimize_options.vertex_cache)
+		for (std::size_t level = 1; level < lods.levels.size(); ++level)
+			optimize_vertex_cache(&chain.indices[lods.levels[level].first_index], lods.levels[level].index_count,
+			                      positions.size());
+	if (auto range = s_registry.try_get<GeometryRange>(entity)) {
+		on_context([&] {
+			*range = update_pool_range(*range,
+			                           positions,
+			                           mesh.get_color_buffer()->get_data_vector(),
+			                           mesh.get_uv_buffer()->get_data_vector(),
+			                           chain.indices);
+		});
+		return;
+	}
+	lods.elements->set_data(std::move(chain.indices));
+	lods.elements->set_index_type(mesh.get_element_buffer()->get_index_type());
+	upload_lods(mesh, lods);
+}
+
+// send the LOD indices of mesh and give every level a VAO over its vertex buffers
+void upload_lods(VertexArrayObject &mesh, MeshLods &lods) {
+	// level index counts in packets already built may be past the new ones, so their elements and VAOs are retired
+	if (s_render_thread != nullptr && lods.elements->get_id() != 0) {
+		s_render_thread->release([elements = lods.elements->release(), vaos = std::move(lods.vaos)] {
+			gl_state().delete_buffers(1, &elements);
+			gl_state().delete_vertex_arrays(static_cast<GLsizei>(vaos.size()), vaos.data());
+		});
+		lods.vaos.clear();
+	}
+	on_context([&] {
+		gl_state().bind_vertex_array(0);
+		if (lods.elements->get_id() == 0)
+			lods.elements->generate();
+		lods.elements->bind();
+		lods.elements->buffer();
+		if (lods.vaos.size() != lods.levels.size()) {
+			gl_state().delete_vertex_arrays(static_cast<GLsizei>(lods.vaos.size()), lods.vaos.data());
+			lods.vaos.resize(lods.levels.size());
+			glGenVertexArrays(static_cast<GLsizei>(lods.vaos.size()), lods.vaos.data());
+		}
+		// instance attributes are pointed per frame, at whichever slice the level's instances were written to
+		auto attribute_data = mesh.get_attribute_buffers();
+		for (auto vao: lods.vaos) {
+			gl_state().bind_vertex_array(vao);
+			GLuint index{0};
+			for (const auto &pair: attribute_data) {
+				pair.first->bind();
+				pair.second.bind(index++);
+			}
+			lods.elements->bind();
+		}
+		gl_state().bind_vertex_array(0);
+	});
+}
+
+// give mesh a VAO over freshly generated buffers holding its data and leave it unbound, returns the first free
+// attribute index. Buffers shared by several attributes (interleaved meshes) are only uploaded once. Expects a context
+GLuint upload_vertex_array(VertexArrayObject &mesh) {
+	GLuint index = 0;
 	mesh.generate();
 	mesh.bind();
-	auto index = 0;
 	auto attribute_data = mesh.get_attribute_buffers();
-	for(const auto& pair: attribute_data) {
-		pair.first->generate();
-		pair.first->bind();
-		pair.first->buffer();
+	for (std::size_t i = 0; i < attribute_data.size(); ++i) {
+		const auto &pair = attribute_data[i];
+		auto uploaded = std::any_of(attribute_data.begin(), attribute_data.begin() + i,
+		                            [&](const auto &other) { return other.first == pair.first; });
+		if (!uploaded) {
+			pair.first->generate();
+			pair.first->bind();
+			pair.first->buffer();
+		} else
+			pair.first->bind();
 		pair.second.bind(index); // divisor 0
 		++index;
 	}
 	mesh.get_element_buffer()->generate();
 	mesh.get_element_buffer()->bind();
 	mesh.get_element_buffer()->buffer();
+	gl_state().bind_vertex_array(0);
+	return index;
+}
+
+// upload the buffers of a mesh with its own VAO and give it an instance container after its vertex attributes
+void construct_vertex_array(entt::registry& registry, entt::entity entity, VertexArrayObject &mesh,
+                            const MeshBounds &bounds) {
+	GLuint index = 0;
+	on_context([&] { index = upload_vertex_array(mesh); });
+	registry.emplace_or_replace<MeshBounds>(entity, bounds);
 	auto& instances = s_registry.emplace<Mat4Instances>(entity, GL_TRIANGLES, mesh.get_element_buffer()->count());
-	instances.generate();
-	instances.bind_to_vao(index);
-	glBindVertexArray(0);
+	on_context([&] {
+		mesh.bind();
+		instances.generate();
+		instances.bind_to_vao(index);
+		gl_state().bind_vertex_array(0);
+	});
 }
 
-void update_mesh(entt::registry& registry, entt::entity entity) {
-	auto& mesh = registry.get<Mesh<>>(entity);
-	mesh.bind();
+// hand the VAO and buffer names of mesh to the render thread, they go once the packets already built are issued
+void retire_vertex_array(VertexArrayObject &mesh) {
+	std::vector<GLuint> buffers;
+	// a buffer shared by several attributes gives its name once, then 0
+	for (const auto &pair: mesh.get_attribute_buffers())
+		if (auto id = pair.first->release())
+			buffers.push_back(id);
+	buffers.push_back(mesh.get_element_buffer()->release());
+	s_render_thread->release([vao = mesh.release(), buffers] {
+		if (vao)
+			gl_state().delete_vertex_arrays(1, &vao);
+		gl_state().delete_buffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+	});
+}
+
+// send what changed in a mesh with its own VAO
+void update_vertex_array(entt::registry& registry, entt::entity entity, VertexArrayObject &mesh,
+                         const std::vector<glm::vec3> &positions) {
+	// a mesh narrowed to 16 bit indices at construction may since have outgrown them
+	auto elements = mesh.get_element_buffer();
+	auto index_type = elements->get_index_type();
+	if (index_type == GL_UNSIGNED_SHORT && smallest_index_type(positions.size()) != GL_UNSIGNED_SHORT)
+		elements->set_index_type(GL_UNSIGNED_INT);
+	// packets built before this still draw with the old index count and type, so data rewritten in place must not
+	// shrink under them: under a render thread such a mesh moves to new buffers and the old ones are retired
 	auto attribute_data = mesh.get_attribute_buffers();
-	for(const auto& pair: attribute_data) {
-		pair.first->bind();
-		pair.first->buffer();
+	auto shrinks = [](const auto &buffer) { return buffer->get_byte_size() < buffer->get_buffered_size(); };
+	auto retire = elements->get_index_type() != index_type || shrinks(elements) ||
+	              std::any_of(attribute_data.begin(), attribute_data.end(),
+	                          [&](const auto &pair) { return shrinks(pair.first); });
+	if (s_render_thread != nullptr && retire) {
+		retire_vertex_array(mesh);
+		on_context([&] {
+			auto index = upload_vertex_array(mesh);
+			mesh.bind();
+			s_registry.get<Mat4Instances>(entity).bind_to_vao(index);
+			gl_state().bind_vertex_array(0);
+		});
+	} else {
+		on_context([&] {
+			mesh.bind();
+			// only modified ranges are sent, untouched buffers cost nothing (and shared ones nothing the second time)
+			for(const auto& pair: attribute_data) {
+				pair.first->bind();
+				pair.first->update();
+			}
+			elements->bind();
+			elements->update();
+			gl_state().bind_vertex_array(0);
+		});
 	}
-	mesh.get_element_buffer()->bind();
-	mesh.get_element_buffer()->buffer();
+	registry.emplace_or_replace<MeshBounds>(entity, compute_bounds(positions));
 	s_registry.patch<Mat4Instances>(entity, [&](Mat4Instances &instances) {
-		instances.set_num_indices(mesh.get_element_buffer()->count());
+		instances.set_num_indices(elements->count());
+	});
+}
+
+// the component dies on the calling thread, so hand its GL names and its last buffer references to the render thread.
+// Packets already built may still draw with them, so they go once those are issued
+void release_vertex_array(VertexArrayObject &mesh) {
+	if (s_render_thread == nullptr)
+		return;
+	s_render_thread->release([vao = mesh.release(),
+	                       buffers = mesh.get_attribute_buffers(),
+	                       elements = mesh.get_element_buffer()] {
+		if (vao)
+			gl_state().delete_vertex_arrays(1, &vao);
+	});
+}
+
+// the VAO drawn for entity, its Mesh<>, MappedMesh or InterleavedMesh
+VertexArrayObject &get_vertex_array(entt::entity entity) {
+	if (auto mesh = s_registry.try_get<Mesh<>>(entity))
+		return *mesh;
+	if (auto mesh = s_registry.try_get<MappedMesh>(entity))
+		return *mesh;
+	return s_registry.get<InterleavedMesh>(entity);
+}
+
+// entt object lifecycles
+void construct_pooled_mesh(entt::registry& registry, entt::entity entity) {
+	auto& mesh = registry.get<Mesh<>>(entity);
+	GeometryRange range;
+	on_context([&] {
+		range = s_geometry_pool->add(mesh.get_vertex_buffer()->get_data_vector(),
+		                             mesh.get_color_buffer()->get_data_vector(),
+		                             mesh.get_uv_buffer()->get_data_vector(),
+		                             mesh.get_element_buffer()->get_data_vector());
+	});
+	registry.emplace_or_replace<GeometryRange>(entity, range);
+	registry.emplace_or_replace<MeshBounds>(entity, compute_bounds(mesh.get_vertex_buffer()->get_data_vector()));
+	// instance data is streamed by the pool at draw time so the container never gets its own buffer
+	s_registry.emplace<Mat4Instances>(entity, GL_TRIANGLES, range.index_count);
+}
+
+void construct_mesh(entt::registry& registry, entt::entity entity) {
+	if (s_optimize_meshes) {
+		ENGINE_PROFILE_ZONE("render::optimize_mesh");
+		registry.emplace_or_replace<MeshOptimizeReport>(entity, optimize_mesh(registry.get<Mesh<>>(entity),
+		                                                                     s_optimize_options));
+	}
+	if (s_geometry_pool != nullptr) {
+		construct_pooled_mesh(registry, entity);
+		return;
+	}
+	auto& mesh = registry.get<Mesh<>>(entity);
+	construct_vertex_array(registry, entity, mesh, compute_bounds(mesh.get_vertex_buffer()->get_data_vector()));
+}
+
+void construct_interleaved_mesh(entt::registry& registry, entt::entity entity) {
+	auto& mesh = registry.get<InterleavedMesh>(entity);
+	construct_vertex_array(registry, entity, mesh, compute_bounds(mesh.get_positions()));
+}
+
+void construct_mapped_mesh(entt::registry& registry, entt::entity entity) {
+	ENGINE_PROFILE_ZONE("render::construct_mapped_mesh");
+	auto& mesh = registry.get<MappedMesh>(entity);
+	// no instance container either, so nothing ever tries to draw or pick it
+	if (mesh.empty()) {
+		std::cerr << "MappedMesh emplaced without an asset, it won't be drawn" << std::endl;
+		return;
+	}
+	const auto &asset = *mesh.get_asset();
+	construct_vertex_array(registry, entity, mesh, asset.get_header().bounds);
+	auto levels = asset.get_lod_levels();
+	if (levels.size() < 2)
+		return;
+	auto &lods = registry.emplace_or_replace<MeshLods>(entity);
+	lods.levels.assign(levels.begin(), levels.end());
+	lods.elements = mesh.get_lod_elements();
+	upload_lods(mesh, lods);
+}
+
+void update_mesh(entt::registry& registry, entt::entity entity) {
+	ENGINE_PROFILE_ZONE("render::update_mesh");
+	auto& mesh = registry.get<Mesh<>>(entity);
+	// rebuilt by the next pick
+	registry.remove<TriangleBvh>(entity);
+	if (auto range = registry.try_get<GeometryRange>(entity)) {
+		on_context([&] {
+			*range = update_pool_range(*range,
+			                           mesh.get_vertex_buffer()->get_data_vector(),
+			                           mesh.get_color_buffer()->get_data_vector(),
+			                           mesh.get_uv_buffer()->get_data_vector(),
+			                           mesh.get_element_buffer()->get_data_vector());
+		});
+		registry.emplace_or_replace<MeshBounds>(entity, compute_bounds(mesh.get_vertex_buffer()->get_data_vector()));
+		s_registry.patch<Mat4Instances>(entity, [&](Mat4Instances &instances) {
+			instances.set_num_indices(range->index_count);
+		});
+		if (auto lods = registry.try_get<MeshLods>(entity))
+			build_lods(entity, *lods);
+		return;
+	}
+	update_vertex_array(registry, entity, mesh, mesh.get_vertex_buffer()->get_data_vector());
+	if (auto lods = registry.try_get<MeshLods>(entity))
+		build_lods(entity, *lods);
+}
+
+void update_interleaved_mesh(entt::registry& registry, entt::entity entity) {
+	ENGINE_PROFILE_ZONE("render::update_mesh");
+	auto& mesh = registry.get<InterleavedMesh>(entity);
+	registry.remove<TriangleBvh>(entity);
+	update_vertex_array(registry, entity, mesh, mesh.get_positions());
+}
+
+void destroy_mesh(entt::registry& registry, entt::entity entity) {
+	if (auto range = registry.try_get<GeometryRange>(entity)) {
+		// the range can't be handed out again while a packet in flight still draws from it
+		if (s_render_thread != nullptr)
+			s_render_thread->release([pool = s_geometry_pool, range = *range] { pool->remove(range); });
+		else
+			s_geometry_pool->remove(*range);
+	}
+	release_vertex_array(registry.get<Mesh<>>(entity));
+}
+
+void destroy_interleaved_mesh(entt::registry& registry, entt::entity entity) {
+	release_vertex_array(registry.get<InterleavedMesh>(entity));
+}
+
+void destroy_mapped_mesh(entt::registry& registry, entt::entity entity) {
+	release_vertex_array(registry.get<MappedMesh>(entity));
+}
+
+void destroy_mat4_instances(entt::registry& registry, entt::entity entity) {
+	if (s_render_thread == nullptr)
+		return;
+	auto buffer = registry.get<Mat4Instances>(entity).release();
+	if (buffer)
+		s_render_thread->post([buffer] { gl_state().delete_buffers(1, &buffer); });
+}
+
+void destroy_mesh_lods(entt::registry& registry, entt::entity entity) {
+	auto& lods = registry.get<MeshLods>(entity);
+	if (s_render_thread == nullptr) {
+		gl_state().delete_vertex_arrays(static_cast<GLsizei>(lods.vaos.size()), lods.vaos.data());
+		return;
+	}
+	s_render_thread->release([vaos = lods.vaos, elements = lods.elements] {
+		gl_state().delete_vertex_arrays(static_cast<GLsizei>(vaos.size()), vaos.data());
 	});
-	glBindVertexArray(0);
 }
 
 void update_mat4_instances(entt::registry& registry, entt::entity entity) {
+	// pooled meshes stream their instances every frame, as does everything once frames are built as packets
+	if (registry.all_of<GeometryRange>(entity) || s_render_thread != nullptr)
+		return;
+	ENGINE_PROFILE_ZONE("render::upload_instances");
 	auto& instances = registry.get<Mat4Instances>(entity);
-	auto& mesh = registry.get<Mesh<>>(entity);
-	mesh.bind();
-	instances.bind();
-	instances.buffer();
-	glBindVertexArray(0);
+	// culled meshes draw from the copy render() writes per camera. Changes wait in the container's dirty ranges
+	// until culling is switched off, which the VisibleInstances makes render() catch up on, and a copy packed
+	// earlier is stale
+	if (s_frustum_culling && !registry.all_of<MeshLods>(entity)) {
+		registry.get_or_emplace<VisibleInstances>(entity);
+		if (auto packed = registry.try_get<PackedInstances>(entity))
+			packed->format = InstanceFormat::mat4;
+		return;
+	}
+	// compact formats draw unculled meshes from a copy packed here once per change. The container's own buffer
+	// catches up with its pending ranges if the format goes back to mat4
+	if (s_instance_format != InstanceFormat::mat4 && !registry.all_of<MeshLods>(entity)) {
+		pack_entity_instances(entity, instances);
+		return;
+	}
+	// a copy packed earlier is stale from here on
+	if (auto packed = registry.try_get<PackedInstances>(entity))
+		packed->format = InstanceFormat::mat4;
+	get_vertex_array(entity).bind();
+	instances.upload();
+	gl_state().bind_vertex_array(0);
 }
 
 void register_entt_callbacks() {
 	s_registry.on_construct<Mesh<>>().connect<&construct_mesh>();
 	s_registry.on_update<Mesh<>>().connect<&update_mesh>();
+	s_registry.on_destroy<Mesh<>>().connect<&destroy_mesh>();
+	s_registry.on_construct<InterleavedMesh>().connect<&construct_interleaved_mesh>();
+	s_registry.on_update<InterleavedMesh>().connect<&update_interleaved_mesh>();
+	s_registry.on_destroy<InterleavedMesh>().connect<&destroy_interleaved_mesh>();
+	s_registry.on_construct<MappedMesh>().connect<&construct_mapped_mesh>();
+	s_registry.on_destroy<MappedMesh>().connect<&destroy_mapped_mesh>();
 	s_registry.on_update<Mat4Instances>().connect<&update_mat4_instances>();
+	s_registry.on_destroy<Mat4Instances>().connect<&destroy_mat4_instances>();
+	s_registry.on_destroy<MeshLods>().connect<&destroy_mesh_lods>();
+	s_transforms.connect(s_registry);
+}
+
+// give every instanced mesh without a TriangleBvh one, built from the CPU side copy of its geometry
+void build_triangle_bvhs() {
+	for (auto entity: s_registry.view<Mesh<>, Mat4Instances>()) {
+		if (s_registry.all_of<TriangleBvh>(entity))
+			continue;
+		ENGINE_PROFILE_ZONE("render::build_triangle_bvh");
+		auto &mesh = s_registry.get<Mesh<>>(entity);
+		s_registry.emplace<TriangleBvh>(entity, mesh.get_vertex_buffer()->get_data_vector(),
+		                                mesh.get_element_buffer()->get_data_vector());
+	}
+	for (auto entity: s_registry.view<InterleavedMesh, Mat4Instances>()) {
+		if (s_registry.all_of<TriangleBvh>(entity))
+			continue;
+		ENGINE_PROFILE_ZONE("render::build_triangle_bvh");
+		auto &mesh = s_registry.get<InterleavedMesh>(entity);
+		s_registry.emplace<TriangleBvh>(entity, mesh.get_positions(), mesh.get_element_buffer()->get_data_vector());
+	}
+	// mapped meshes are read straight from the asset, widening 16 bit indices
+	for (auto entity: s_registry.view<MappedMesh, Mat4Instances>()) {
+		const auto &mesh = s_registry.get<MappedMesh>(entity);
+		if (s_registry.all_of<TriangleBvh>(entity) || mesh.empty())
+			continue;
+		ENGINE_PROFILE_ZONE("render::build_triangle_bvh");
+		const auto &asset = *mesh.get_asset();
+		const auto &header = asset.get_header();
+		auto data = asset.get_section(header.indices);
+		std::vector<unsigned int> indices(header.index_count);
+		if (header.index_type == GL_UNSIGNED_SHORT) {
+			auto narrow = static_cast<const std::uint16_t*>(data);
+			std::copy(narrow, narrow + header.index_count, indices.begin());
+		} else
+			std::memcpy(indices.data(), data, header.index_count * sizeof(unsigned int));
+		s_registry.emplace<TriangleBvh>(entity, asset.get_positions(), indices);
+	}
+}
+
+// gather the instances of entity that intersect frustum into its VisibleInstances transforms and return how many
+std::size_t cull_instances(entt::entity entity, Mat4Instances &instances, const Frustum &frustum) {
+	ENGINE_PROFILE_ZONE("render::cull");
+	const auto &bounds = s_registry.get<MeshBounds>(entity);
+	auto &visible = s_registry.get_or_emplace<VisibleInstances>(entity);
+	const auto &transforms = instances.get_data_vector();
+	transform_bounds(bounds, transforms.data(), transforms.size(), visible.spheres);
+	auto count = cull_spheres(frustum, visible.spheres, visible.indices);
+	// occluders would hide themselves
+	if (s_occlusion != nullptr && count > 0 && !s_registry.all_of<Occluder>(entity))
+		count = s_occlusion->cull(bounds, transforms.data(), visible.indices.data(), count);
+	if (count == 0)
+		return 0;
+	visible.transforms.resize(count);
+	for (std::size_t i = 0; i < count; ++i)
+		visible.transforms[i] = transforms[visible.indices[i]];
+	return count;
+}
+
+// rasterize the occluders as seen through view_projection for cull_instances to test against
+void draw_occluders(const glm::mat4 &view_projection) {
+	ENGINE_PROFILE_ZONE("render::occluders");
+	s_occlusion->begin(view_projection);
+	auto occluders = s_registry.view<Occluder, Mesh<>, Mat4Instances>();
+	for (auto entity: occluders) {
+		auto &mesh = occluders.get<Mesh<>>(entity);
+		const auto &instances = occluders.get<Mat4Instances>(entity).get_data_vector();
+		s_occlusion->add_occluder(mesh.get_vertex_buffer()->get_data_vector(),
+		                          mesh.get_element_buffer()->get_data_vector(),
+		                          instances.data(),
+		                          instances.size());
+	}
+	s_occlusion->finish();
+}
+
+// sort the instances of entity, culled when enabled, into its LOD levels. lods.transforms ends up grouped by level
+// in bucket order, returns how many there are in total
+std::size_t bucket_lods(entt::entity entity, Mat4Instances &instances, MeshLods &lods, const Frustum &frustum,
+                        const glm::vec3 &eye, float tan_half_fovy) {
+	ENGINE_PROFILE_ZONE("render::bucket_lods");
+	const auto &transforms = instances.get_data_vector();
+	if (s_frustum_culling) {
+		auto count = cull_instances(entity, instances, frustum);
+		const auto &visible = s_registry.get<VisibleInstances>(entity);
+		bucket_instances(lods.levels, visible.spheres, visible.indices.data(), count, eye, tan_half_fovy,
+		                 lods.buckets);
+	} else {
+		transform_bounds(s_registry.get<MeshBounds>(entity), transforms.data(), transforms.size(), lods.spheres);
+		lods.indices.resize(transforms.size());
+		std::iota(lods.indices.begin(), lods.indices.end(), 0u);
+		bucket_instances(lods.levels, lods.spheres, lods.indices.data(), lods.indices.size(), eye, tan_half_fovy,
+		                 lods.buckets);
+	}
+	lods.transforms.clear();
+	for (const auto &bucket: lods.buckets)
+		for (auto index: bucket)
+			lods.transforms.push_back(transforms[index]);
+	return lods.transforms.size();
+}
+
+// one packet draw per non-empty LOD level of entity
+void pack_lods(FramePacket &packet, entt::entity entity, Mat4Instances &instances, VertexArrayObject &mesh,
+               MeshLods &lods, GLuint program, const Frustum &frustum, const glm::vec3 &eye, float tan_half_fovy) {
+	if (bucket_lods(entity, instances, lods, frustum, eye, tan_half_fovy) == 0)
+		return;
+	auto first = packet.transforms.size();
+	packet.transforms.insert(packet.transforms.end(), lods.transforms.begin(), lods.transforms.end());
+	auto range = s_registry.try_get<GeometryRange>(entity);
+	auto texture = *mesh.get_texture();
+	for (std::size_t level = 0; level < lods.levels.size(); ++level) {
+		auto count = lods.buckets[level].size();
+		if (count == 0)
+			continue;
+		const auto &lod = lods.levels[level];
+		PacketDraw draw{0,
+		                DrawCommand{program,
+		                            texture,
+		                            range ? mesh.get_id() : lods.vaos[level],
+		                            instances.get_render_strategy(),
+		                            static_cast<GLsizei>(lod.index_count),
+		                            lods.elements->get_index_type(),
+		                            static_cast<GLsizei>(count),
+		                            lod.first_index},
+		                instances.get_index_offset(),
+		                first,
+		                range != nullptr,
+		                range ? level_range(*range, lod) : GeometryRange{}};
+		if (range == nullptr) {
+			auto depth = glm::length(glm::vec3(packet.transforms[first][3]) - eye) / get_context().z_far;
+			draw.key = RenderQueue::make_key(0, program, texture, lods.vaos[level], depth);
+		}
+		packet.draws.push_back(draw);
+		first += count;
+	}
+}
+
+// copy instance transforms, culled when enabled, into the packet and return how many were added
+std::size_t pack_transforms(FramePacket &packet, entt::entity entity, Mat4Instances &instances, const Frustum &frustum) {
+	if (s_frustum_culling) {
+		auto count = cull_instances(entity, instances, frustum);
+		const auto &visible = s_registry.get<VisibleInstances>(entity);
+		packet.transforms.insert(packet.transforms.end(), visible.transforms.begin(), visible.transforms.begin() + count);
+		return count;
+	}
+	const auto &transforms = instances.get_data_vector();
+	packet.transforms.insert(packet.transforms.end(), transforms.begin(), transforms.end());
+	return transforms.size();
+}
+
+// simulation side of a threaded frame, the only place the registry is read
+void build_packet(FramePacket &packet, std::chrono::nanoseconds dt, float alpha) {
+	ENGINE_PROFILE_ZONE("render::build_packet");
+	s_elapsed += dt;
+	packet.dt = dt;
+	packet.alpha = alpha;
+	const auto &context = get_context();
+	auto projection = get_projection();
+	auto cameras = s_registry.view<Camera::Ptr>();
+	for (auto entity: cameras) {
+		auto camera = s_registry.get<Camera::Ptr>(entity);
+		const auto &shader = s_registry.get<Shader>(entity);
+		auto view = camera->get_view();
+		auto vp = projection * view;
+		auto eye = camera->get_position();
+		auto tan_half_fovy = 1.f / projection[1][1];
+		Frustum frustum(vp);
+		if (s_occlusion != nullptr)
+			draw_occluders(vp);
+		PacketView packet_view{{vp, view, projection, glm::vec4(eye, 1.f),
+		                        glm::vec4(std::chrono::duration<float>(s_elapsed).count(),
+		                                  std::chrono::duration<float>(dt).count(), alpha, 0.f)},
+		                       shader.get_id(),
+		                       shader.get_vp_uniform().location,
+		                       shader.get_tex0_uniform().location,
+		                       packet.draws.size(),
+		                       0};
+
+		auto view3d = s_registry.view<Mat4Instances>();
+		for (auto e: view3d) {
+			auto &instances = view3d.get<Mat4Instances>(e);
+			auto &mesh = get_vertex_array(e);
+			if (auto lods = s_registry.try_get<MeshLods>(e)) {
+				pack_lods(packet, e, instances, mesh, *lods, shader.get_id(), frustum, eye, tan_half_fovy);
+				continue;
+			}
+			auto first = packet.transforms.size();
+			auto count = pack_transforms(packet, e, instances, frustum);
+			if (count == 0)
+				continue;
+			auto texture = *mesh.get_texture();
+			PacketDraw draw{0,
+			                DrawCommand{shader.get_id(),
+			                            texture,
+			                            mesh.get_id(),
+			                            instances.get_render_strategy(),
+			                            static_cast<GLsizei>(instances.num_indices()),
+			                            mesh.get_element_buffer()->get_index_type(),
+			                            static_cast<GLsizei>(count)},
+			                instances.get_index_offset(),
+			                first,
+			                false,
+			                {}};
+			if (auto range = s_registry.try_get<GeometryRange>(e)) {
+				draw.pooled = true;
+				draw.range = *range;
+			} else {
+				auto depth = glm::length(glm::vec3(packet.transforms[first][3]) - eye) / context.z_far;
+				draw.key = RenderQueue::make_key(0, shader.get_id(), texture, mesh.get_id(), depth);
+			}
+			packet.draws.push_back(draw);
+		}
+		packet_view.draw_count = packet.draws.size() - packet_view.first_draw;
+		packet.views.push_back(packet_view);
+	}
+
+	if (s_text_renderer != nullptr) {
+		packet.screen_projection = s_registry.get<glm::mat4>(s_window_entity);
+		s_text_renderer->collect(s_registry, packet.text);
+	} else
+		packet.text.clear();
+}
+
+// render thread side, only GL and the packet
+void execute_packet(const FramePacket &packet) {
+	ENGINE_PROFILE_ZONE("render::execute_packet");
+	ENGINE_PROFILE_GPU_ZONE("render");
+	QueueStats totals;
+	begin_stream_frame();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (s_texture_streamer != nullptr)
+		s_texture_streamer->update();
+	for (const auto &view: packet.views) {
+		auto frame_offset = s_frame_uniforms->write(&view.frame, sizeof(FrameUniforms));
+		gl_state().bind_buffer_range(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, s_frame_uniforms->get_id(), frame_offset,
+		                             sizeof(FrameUniforms));
+		if (view.draw_count == 0)
+			continue;
+
+		// every draw of the view reads its instances from one write, each VAO is pointed at its slice
+		const auto &first = packet.draws[view.first_draw];
+		const auto &last = packet.draws[view.first_draw + view.draw_count - 1];
+		auto transform_count = last.first_transform + last.command.instances - first.first_transform;
+		auto instance_offset = write_instances(*s_packet_instances, &packet.transforms[first.first_transform],
+		                                       transform_count);
+		s_queue.clear();
+		for (auto i = view.first_draw; i < view.first_draw + view.draw_count; ++i) {
+			const auto &draw = packet.draws[i];
+			if (draw.pooled) {
+				s_geometry_pool->draw(draw.range, draw.command.mode, draw.command.texture,
+				                      &packet.transforms[draw.first_transform], draw.command.instances);
+				continue;
+			}
+			gl_state().bind_vertex_array(draw.command.vao);
+			auto offset = instance_offset
+			              + (draw.first_transform - first.first_transform) * instance_size(s_instance_format);
+			point_instance_attributes(draw.instance_attribute, offset);
+			s_queue.push(draw.key, draw.command);
+		}
+
+		s_queue.sort();
+		s_queue.submit([&](GLuint) {
+			set_uniform(view.vp_location, view.frame.vp);
+			set_uniform(view.tex0_location, 0);
+		});
+		if (s_geometry_pool != nullptr && !s_geometry_pool->empty()) {
+			gl_state().use_program(view.program);
+			set_uniform(view.vp_location, view.frame.vp);
+			set_uniform(view.tex0_location, 0);
+			s_geometry_pool->submit();
+			totals.draws += s_geometry_pool->get_draw_calls();
+		}
+		const auto &stats = s_queue.get_stats();
+		totals.draws += stats.draws;
+		totals.program_binds += stats.program_binds;
+		totals.texture_binds += stats.texture_binds;
+		totals.vao_binds += stats.vao_binds;
+		totals.program_binds_saved += stats.program_binds_saved;
+		totals.texture_binds_saved += stats.texture_binds_saved;
+		totals.vao_binds_saved += stats.vao_binds_saved;
+	}
+
+	if (s_text_renderer != nullptr) {
+		s_text_renderer->draw(packet.text, packet.screen_projection);
+		totals.draws += s_text_renderer->get_draw_calls();
+	}
+	std::lock_guard<std::mutex> lock(s_stats_mutex);
+	s_queue_stats = totals;
+	s_gl_stats = gl_state().take_stats();
+}
+
+GLuint compile_program(const char *vertex_source, const char *fragment_source, const char *geometry_source) {
+	int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertex_shader, 1, &vertex_source, nullptr);
+	glCompileShader(vertex_shader);
+	int success;
+	char infoLog[512];
+	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		glGetShaderInfoLog(vertex_shader, 512, nullptr, infoLog);
+		std::string message = fmt::format("Error on vertex compilation {}", infoLog);
+		throw std::runtime_error(message.c_str());
+	}
+	int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragment_shader, 1, &fragment_source, nullptr);
+	glCompileShader(fragment_shader);
+	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		glGetShaderInfoLog(fragment_shader, 512, nullptr, infoLog);
+		std::string message = fmt::format("Error on fragment compilation {}", infoLog);
+		throw std::runtime_error(message.c_str());
+	}
+	// load geometry shader if given
+	int geometry_shader;
+	if(geometry_source != nullptr) {
+		geometry_shader = glCreateShader(GL_GEOMETRY_SHADER);
+		glShaderSource(geometry_shader, 1, &geometry_source, nullptr);
+		glCompileShader(geometry_shader);
+		glGetShaderiv(geometry_shader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(geometry_shader, 512, nullptr, infoLog);
+			std::string message = fmt::format("Error on geometry compilation {}", infoLog);
+			throw std::runtime_error(message.c_str());
+		}
+	}
+	auto shader = glCreateProgram();
+	glAttachShader(shader, vertex_shader);
+	glAttachShader(shader, fragment_shader);
+	if(geometry_source != nullptr)
+		glAttachShader(shader, geometry_shader);
+	// keep the binary around for the program cache
+	glProgramParameteri(shader, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(shader);
+	glValidateProgram(shader);
+	glGetProgramiv(shader, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(shader, 512, nullptr, infoLog);
+		std::string message = fmt::format("Error linking program {}", infoLog);
+		throw std::runtime_error(message.c_str());
+	}
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+	if(geometry_source != nullptr)
+		glDeleteShader(geometry_shader);
+	return shader;
+}
+
+// restore from the program cache when possible, otherwise compile and populate it
+GLuint load_program(const char *vertex_source, const char *fragment_source, const char *geometry_source) {
+	ENGINE_PROFILE_ZONE("render::load_program");
+	if (off_context()) {
+		GLuint program{0};
+		s_render_thread->invoke([&] { program = load_program(vertex_source, fragment_source, geometry_source); });
+		return program;
+	}
+	if (s_program_cache == nullptr)
+		return compile_program(vertex_source, fragment_source, geometry_source);
+	auto key = s_program_cache->make_key({vertex_source, fragment_source, geometry_source});
+	if (auto program = s_program_cache->load(key))
+		return program;
+	auto start = std::chrono::steady_clock::now();
+	auto program = compile_program(vertex_source, fragment_source, geometry_source);
+	s_program_cache->store(key, program, std::chrono::steady_clock::now() - start);
+	return program;
 }
 
 } // anonymous
 
-bool init() {
-	if (!init_glfw()) {
+bool init(const InitOptions &options) {
+	if (!init_glfw(options)) {
 		std::cerr << "Failed to init GLFW" << std::endl;
 		return false;
 	}
-	if (!init_window()) {
+	if (!init_window(options)) {
 		std::cerr << "Failed to init window" << std::endl;
 		return false;
 	}
@@ -175,13 +994,21 @@ bool init() {
 		std::cerr << "Failed to init GLEW" << std::endl;
 		return false;
 	}
+	s_headless = options.headless;
+	if (s_headless && !init_offscreen_target()) {
+		glfwTerminate();
+		return false;
+	}
 
 	register_entt_callbacks();
+	s_frame_uniforms = std::make_shared<StreamBuffer>(GL_UNIFORM_BUFFER);
 
+	// a new context, nothing the cache remembers from a previous one holds
+	gl_state().invalidate();
 	// cull triangles facing away from camera
-	glEnable(GL_CULL_FACE);
+	gl_state().enable(GL_CULL_FACE);
 	// enable depth buffer
-	glEnable(GL_DEPTH_TEST);
+	gl_state().enable(GL_DEPTH_TEST);
 	// background color
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -206,57 +1033,237 @@ void render_scene(std::chrono::nanoseconds dt, entt::entity scene_entity) {
 	}*/
 }
 
-void render(std::chrono::nanoseconds dt) {
+void render(std::chrono::nanoseconds dt, float alpha) {
+	ENGINE_PROFILE_ZONE("render::render");
+	s_transforms.update(s_registry);
+	if (s_spatial_index != nullptr)
+		s_spatial_index->update(s_registry);
+	if (s_render_thread != nullptr) {
+		build_packet(s_render_thread->begin_frame(), dt, alpha);
+		s_render_thread->end_frame();
+		return;
+	}
+	ENGINE_PROFILE_GPU_ZONE("render");
+	s_queue_stats = {};
+	s_elapsed += dt;
+	begin_stream_frame();
+	if (s_texture_streamer != nullptr)
+		s_texture_streamer->update();
+	const auto &context = get_context();
+	auto projection = get_projection();
 	auto cameras = s_registry.view<Camera::Ptr>();
 	for(auto entity: cameras) {
 		auto camera = s_registry.get<Camera::Ptr>(entity);
-		auto shader = s_registry.get<Shader>(entity);
-		shader.use();
-		shader.uniform_mat4("vp", get_projection() * camera->get_view());
+		const auto &shader = s_registry.get<Shader>(entity);
+		auto view = camera->get_view();
+		auto vp = projection * view;
+		auto eye = camera->get_position();
+		auto tan_half_fovy = 1.f / projection[1][1];
+		Frustum frustum(vp);
+		if (s_occlusion != nullptr)
+			draw_occluders(vp);
+
+		// per camera data goes out once through the Frame block, programs without it still get a plain vp uniform
+		FrameUniforms frame{vp, view, projection, glm::vec4(eye, 1.f),
+		                    glm::vec4(std::chrono::duration<float>(s_elapsed).count(),
+		                              std::chrono::duration<float>(dt).count(), alpha, 0.f)};
+		auto frame_offset = s_frame_uniforms->write(&frame, sizeof(FrameUniforms));
+		gl_state().bind_buffer_range(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, s_frame_uniforms->get_id(), frame_offset,
+		                             sizeof(FrameUniforms));
+		auto vp_uniform = shader.get_vp_uniform();
+		auto tex0_uniform = shader.get_tex0_uniform();
 
 		// TODO: rerender only relevant matrices (i.e. update, new, cull old matrices etc.)
+		s_queue.clear();
 		auto view3d = s_registry.view<Mat4Instances>();
 		for (auto e: view3d) {
 			auto &instances = view3d.get<Mat4Instances>(e);
-			auto &mesh = s_registry.get<Mesh<>>(e);
-			auto texture = *mesh.get_texture();
-			if (texture) {
-				shader.uniform_int("tex0", texture); // setup texture0
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, texture);
+			auto &mesh = get_vertex_array(e);
+			if (auto lods = s_registry.try_get<MeshLods>(e)) {
+				auto count = bucket_lods(e, instances, *lods, frustum, eye, tan_half_fovy);
+				if (count == 0)
+					continue;
+				auto range = s_registry.try_get<GeometryRange>(e);
+				auto texture = *mesh.get_texture();
+				GLintptr offset{0};
+				if (range == nullptr)
+					offset = write_instances(*lods->buffer, lods->transforms.data(), count);
+				std::size_t first{0};
+				for (std::size_t level = 0; level < lods->levels.size(); ++level) {
+					auto level_count = lods->buckets[level].size();
+					if (level_count == 0)
+						continue;
+					const auto &lod = lods->levels[level];
+					if (range != nullptr)
+						s_geometry_pool->draw(level_range(*range, lod), instances.get_render_strategy(), texture,
+						                      &lods->transforms[first], level_count);
+					else {
+						auto vao = lods->vaos[level];
+						gl_state().bind_vertex_array(vao);
+						point_instance_attributes(instances.get_index_offset(),
+						                          offset + first * instance_size(s_instance_format));
+						auto depth = glm::length(glm::vec3(lods->transforms[first][3]) - eye) / context.z_far;
+						s_queue.push(RenderQueue::make_key(0, shader.get_id(), texture, vao, depth),
+						             DrawCommand{shader.get_id(),
+						                         texture,
+						                         vao,
+						                         instances.get_render_strategy(),
+						                         static_cast<GLsizei>(lod.index_count),
+						                         lods->elements->get_index_type(),
+						                         static_cast<GLsizei>(level_count),
+						                         lod.first_index});
+					}
+					first += level_count;
+				}
+				continue;
+			}
+			if (auto range = s_registry.try_get<GeometryRange>(e)) {
+				if (s_frustum_culling) {
+					auto count = cull_instances(e, instances, frustum);
+					const auto &visible = s_registry.get<VisibleInstances>(e);
+					s_geometry_pool->draw(*range, instances.get_render_strategy(), *mesh.get_texture(),
+					                      visible.transforms.data(), count);
+				} else
+					s_geometry_pool->draw(*range, instances.get_render_strategy(), *mesh.get_texture(),
+					                      instances.get_data_vector().data(), instances.num_instances());
+				continue;
 			}
 			mesh.bind();
-			glDrawElementsInstanced(instances.get_render_strategy(),
-									instances.num_indices(),
-									GL_UNSIGNED_INT,
-									(void*) 0,
-									instances.num_instances());
-			glBindVertexArray(0);
+			auto count = instances.num_instances();
+			if (s_frustum_culling) {
+				// point the VAO at a culled copy for this camera, packed on the way
+				count = cull_instances(e, instances, frustum);
+				if (count > 0) {
+					const auto &visible = s_registry.get<VisibleInstances>(e);
+					auto offset = write_instances(*visible.buffer, visible.transforms.data(), count);
+					point_instance_attributes(instances.get_index_offset(), offset);
+				}
+			} else if (s_instance_format != InstanceFormat::mat4) {
+				// packed when the instances last changed, only a format switch repacks here
+				auto packed = s_registry.try_get<PackedInstances>(e);
+				if (packed == nullptr || packed->format != s_instance_format)
+					pack_entity_instances(e, instances);
+				else
+					packed->buffer->bind();
+				point_instance_attributes(instances.get_index_offset(), 0);
+			} else if (s_registry.any_of<VisibleInstances, PackedInstances>(e)) {
+				// culling or packing was switched off since the last frame, bring the container's own buffer up to
+				// date and point the VAO back at it
+				instances.upload();
+				instances.restore_attributes();
+				s_registry.remove<VisibleInstances>(e);
+				s_registry.remove<PackedInstances>(e);
+			}
+			if (count == 0)
+				continue;
+			// approximate the depth of the whole set by its first instance
+			auto first = glm::vec3(instances.get_data_vector()[0][3]);
+			auto depth = glm::length(first - eye) / context.z_far;
+			auto texture = *mesh.get_texture();
+			s_queue.push(RenderQueue::make_key(0, shader.get_id(), texture, mesh.get_id(), depth),
+			             DrawCommand{shader.get_id(),
+			                         texture,
+			                         mesh.get_id(),
+			                         instances.get_render_strategy(),
+			                         static_cast<GLsizei>(instances.num_indices()),
+			                         mesh.get_element_buffer()->get_index_type(),
+			                         static_cast<GLsizei>(count)});
+		}
+
+		{
+			ENGINE_PROFILE_ZONE("render::queue_sort");
+			s_queue.sort();
 		}
+		{
+			ENGINE_PROFILE_ZONE("render::queue_submit");
+			ENGINE_PROFILE_GPU_ZONE("queue");
+			s_queue.submit([&](GLuint) {
+				shader.set(vp_uniform, vp);
+				shader.set(tex0_uniform, 0); // samplers read texture unit 0
+			});
+		}
+		if (s_geometry_pool != nullptr && !s_geometry_pool->empty()) {
+			ENGINE_PROFILE_ZONE("render::geometry_pool");
+			ENGINE_PROFILE_GPU_ZONE("geometry pool");
+			shader.use();
+			shader.set(vp_uniform, vp);
+			shader.set(tex0_uniform, 0);
+			s_geometry_pool->submit();
+			s_queue_stats.draws += s_geometry_pool->get_draw_calls();
+		}
+		const auto &stats = s_queue.get_stats();
+		s_queue_stats.draws += stats.draws;
+		s_queue_stats.program_binds += stats.program_binds;
+		s_queue_stats.texture_binds += stats.texture_binds;
+		s_queue_stats.vao_binds += stats.vao_binds;
+		s_queue_stats.program_binds_saved += stats.program_binds_saved;
+		s_queue_stats.texture_binds_saved += stats.texture_binds_saved;
+		s_queue_stats.vao_binds_saved += stats.vao_binds_saved;
+	}
+
+	// screen space text over everything else
+	if (s_text_renderer != nullptr) {
+		ENGINE_PROFILE_ZONE("render::text");
+		ENGINE_PROFILE_GPU_ZONE("text");
+		s_text_renderer->render(s_registry, s_registry.get<glm::mat4>(s_window_entity));
+		s_queue_stats.draws += s_text_renderer->get_draw_calls();
 	}
+	std::lock_guard<std::mutex> lock(s_stats_mutex);
+	s_gl_stats = gl_state().take_stats();
 }
 
 void swap_buffers() {
-	auto window = s_registry.get<GLFWwindow*>(s_window_entity);
-	glfwSwapBuffers(window);
+	// the render thread swaps after issuing each packet
+	if (s_render_thread != nullptr)
+		return;
+	{
+		ENGINE_PROFILE_ZONE("render::swap_buffers");
+		auto window = s_registry.get<GLFWwindow*>(s_window_entity);
+		// nothing to present offscreen, just make sure the frame's commands are on their way
+		if (s_headless)
+			glFlush();
+		else
+			glfwSwapBuffers(window);
+	}
+	ENGINE_PROFILE_FRAME();
 }
 
 void clear_screen() {
+	if (s_render_thread != nullptr)
+		return;
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
 void cleanup() {
+	stop_render_thread();
 	auto view = s_registry.view<Shader>();
 	for(auto e: view)
 		view.get<Shader>(e).destroy();
-	glfwTerminate();
+	if (s_spatial_index != nullptr) {
+		s_spatial_index->disconnect(s_registry);
+		s_spatial_index = nullptr;
+	}
 	s_registry.clear();
+	s_geometry_pool = nullptr;
+	s_occlusion = nullptr;
+	s_frame_uniforms = nullptr;
+	s_program_cache = nullptr;
+	s_text_renderer = nullptr;
+	// joins the decode workers and releases the unpack buffer while the context still exists
+	s_texture_streamer = nullptr;
+	destroy_offscreen_target();
+	ENGINE_PROFILE_SHUTDOWN();
+	glfwTerminate();
 }
 
 void load_texture(GLuint *texture, unsigned int width, unsigned int height, int internalformat, int format, int type,
                   void *data) {
+	if (off_context()) {
+		s_render_thread->invoke([&] { load_texture(texture, width, height, internalformat, format, type, data); });
+		return;
+	}
 	glGenTextures(1, texture);
-	glBindTexture(GL_TEXTURE_2D, *texture);
+	gl_state().bind_texture(GL_TEXTURE_2D, *texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -266,117 +1273,22 @@ void load_texture(GLuint *texture, unsigned int width, unsigned int height, int
 }
 
 GLuint load_transform_shader(const char *vertex_source, const char *fragment_source, const char *geometry_source) {
-	int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex_shader, 1, &vertex_source, nullptr);
-	glCompileShader(vertex_shader);
-	int success;
-	char infoLog[512];
-	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vertex_shader, 512, nullptr, infoLog);
-		std::string message = fmt::format("Error on vertex compilation ", infoLog);
-		throw std::runtime_error(message.c_str());
-	}
-	int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment_shader, 1, &fragment_source, nullptr);
-	glCompileShader(fragment_shader);
-	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragment_shader, 512, nullptr, infoLog);
-		std::string message = fmt::format("Error on fragment compilation ", infoLog);
-		throw std::runtime_error(message.c_str());
-	}
-	// load geometry shader if given
-	int geometry_shader;
-	if(geometry_source != nullptr) {
-		geometry_shader = glCreateShader(GL_GEOMETRY_SHADER);
-		glShaderSource(geometry_shader, 1, &geometry_source, nullptr);
-		glCompileShader(geometry_shader);
-		glGetShaderiv(geometry_shader, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(geometry_shader, 512, nullptr, infoLog);
-			std::string message = fmt::format("Error on geometry compilation ", infoLog);
-			throw std::runtime_error(message.c_str());
-		}
-	}
-	auto shader = glCreateProgram();
-	glAttachShader(shader, vertex_shader);
-	glAttachShader(shader, fragment_shader);
-	if(geometry_source != nullptr)
-		glAttachShader(shader, geometry_shader);
-	glLinkProgram(shader);
-	glValidateProgram(shader);
-	glGetProgramiv(shader, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shader, 512, nullptr, infoLog);
-		std::string message = fmt::format("Error linking program ", infoLog);
-		throw std::runtime_error(message.c_str());
-	}
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
-	if(geometry_source != nullptr)
-		glDeleteShader(geometry_shader);
-	return shader;
+	return load_program(vertex_source, fragment_source, geometry_source);
 }
 
 GLuint load_shader(const char *vertex_source, const char *fragment_source, const char *geometry_source) {
-	int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex_shader, 1, &vertex_source, nullptr);
-	glCompileShader(vertex_shader);
-	int success;
-	char infoLog[512];
-	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vertex_shader, 512, nullptr, infoLog);
-		std::string message = fmt::format("Error on vertex compilation ", infoLog);
-		throw std::runtime_error(message.c_str());
-	}
-	int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment_shader, 1, &fragment_source, nullptr);
-	glCompileShader(fragment_shader);
-	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragment_shader, 512, nullptr, infoLog);
-		std::string message = fmt::format("Error on fragment compilation ", infoLog);
-		throw std::runtime_error(message.c_str());
-	}
-	// load geometry shader if given
-	int geometry_shader;
-	if(geometry_source != nullptr) {
-		geometry_shader = glCreateShader(GL_GEOMETRY_SHADER);
-		glShaderSource(geometry_shader, 1, &geometry_source, nullptr);
-		glCompileShader(geometry_shader);
-		glGetShaderiv(geometry_shader, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(geometry_shader, 512, nullptr, infoLog);
-			std::string message = fmt::format("Error on geometry compilation ", infoLog);
-			throw std::runtime_error(message.c_str());
-		}
-	}
-	auto shader = glCreateProgram();
-	glAttachShader(shader, vertex_shader);
-	glAttachShader(shader, fragment_shader);
-	if(geometry_source != nullptr)
-		glAttachShader(shader, geometry_shader);
-	glLinkProgram(shader);
-	glValidateProgram(shader);
-	glGetProgramiv(shader, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shader, 512, nullptr, infoLog);
-		std::string message = fmt::format("Error linking program ", infoLog);
-		throw std::runtime_error(message.c_str());
-	}
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
-	if(geometry_source != nullptr)
-		glDeleteShader(geometry_shader);
-	return shader;
+	return load_program(vertex_source, fragment_source, geometry_source);
 }
 
 std::map<unsigned long, Glyph> load_font(FT_Library ft,
 										const std::string& fontfile,
 										unsigned int font_size,
 										const std::string& text) {
+	if (off_context()) {
+		std::map<unsigned long, Glyph> glyphs;
+		s_render_thread->invoke([&] { glyphs = load_font(ft, fontfile, font_size, text); });
+		return glyphs;
+	}
 	std::cout << "Loading font at '" << fontfile << "'" << std::endl;
 	FT_Face face;
 	if (FT_New_Face(ft, fontfile.c_str(), 0, &face)) {
@@ -387,46 +1299,94 @@ std::map<unsigned long, Glyph> load_font(FT_Library ft,
 	// set size to load glyphs as
 	FT_Set_Pixel_Sizes(face, 0, font_size);
 
-	// disable byte-alignment restriction
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-	std::map<unsigned long, Glyph> glyphs;
+	// rasterize everything first so the atlas can be sized before any GL work
+	struct Bitmap {
+		unsigned long c;
+		Glyph glyph;
+		std::vector<unsigned char> pixels;
+	};
+	std::vector<Bitmap> bitmaps;
+	std::set<unsigned long> loaded;
 	for (unsigned char c: text) {
-		if (glyphs.contains(c))
+		if (!loaded.insert(c).second)
 			continue;
 		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
 			std::cout << "ERROR::FREETYTPE: Failed to load Glyph '" << c << "'" << std::endl;
 			continue;
 		}
-		// generate texture
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(
-				GL_TEXTURE_2D,
-				0,
-				GL_RED,
-				face->glyph->bitmap.width,
-				face->glyph->bitmap.rows,
-				0,
-				GL_RED,
-				GL_UNSIGNED_BYTE,
-				face->glyph->bitmap.buffer);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		Glyph glyph = {
-			texture,
-			glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-			glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-			static_cast<unsigned int>(face->glyph->advance.x)
-		};
-		glyphs.insert({c, glyph});
-	}
-	glBindTexture(GL_TEXTURE_2D, 0);
+		const auto &bitmap = face->glyph->bitmap;
+		Bitmap entry{c,
+		             Glyph{0,
+		                   glm::ivec2(bitmap.width, bitmap.rows),
+		                   glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
+		                   static_cast<long>(face->glyph->advance.x)},
+		             {}};
+		// copy row by row since FreeType rows may be padded to the pitch
+		entry.pixels.resize(bitmap.width * bitmap.rows);
+		for (unsigned int row = 0; row < bitmap.rows; ++row)
+			std::memcpy(&entry.pixels[row * bitmap.width], bitmap.buffer + row * bitmap.pitch, bitmap.width);
+		bitmaps.push_back(std::move(entry));
+	}
 	// destroy FreeType once we're finished
 	FT_Done_Face(face);
+
+	// pack tallest first into the smallest square atlas that holds everything, with a pixel of padding against
+	// bleeding between neighbours under linear filtering
+	std::sort(bitmaps.begin(), bitmaps.end(), [](const Bitmap &a, const Bitmap &b) {
+		return a.glyph.size.y > b.glyph.size.y;
+	});
+	GLint max_size{0};
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	constexpr int padding{1};
+	int atlas_size{128};
+	std::vector<glm::ivec2> positions(bitmaps.size());
+	while (true) {
+		AtlasPacker packer(atlas_size, atlas_size);
+		bool packed{true};
+		for (std::size_t i = 0; i < bitmaps.size() && packed; ++i) {
+			const auto &size = bitmaps[i].glyph.size;
+			packed = packer.pack(size.x + padding, size.y + padding, positions[i]);
+		}
+		if (packed)
+			break;
+		if (atlas_size * 2 > max_size) {
+			std::cerr << "Glyphs of " << fontfile << " at size " << font_size << " do not fit in one texture" << std::endl;
+			return {};
+		}
+		atlas_size *= 2;
+	}
+
+	std::vector<unsigned char> atlas(atlas_size * atlas_size, 0);
+	for (std::size_t i = 0; i < bitmaps.size(); ++i) {
+		const auto &size = bitmaps[i].glyph.size;
+		for (int row = 0; row < size.y; ++row)
+			std::memcpy(&atlas[(positions[i].y + row) * atlas_size + positions[i].x],
+			            &bitmaps[i].pixels[row * size.x],
+			            size.x);
+	}
+
+	// disable byte-alignment restriction
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	gl_state().bind_texture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlas_size, atlas_size, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	std::map<unsigned long, Glyph> glyphs;
+	auto scale = 1.f / atlas_size;
+	for (std::size_t i = 0; i < bitmaps.size(); ++i) {
+		auto glyph = bitmaps[i].glyph;
+		glyph.tex_id = texture;
+		glyph.uv = glm::vec4(positions[i].x * scale,
+		                     positions[i].y * scale,
+		                     (positions[i].x + glyph.size.x) * scale,
+		                     (positions[i].y + glyph.size.y) * scale);
+		glyphs.insert({bitmaps[i].c, glyph});
+	}
 	return glyphs;
 }
 
@@ -442,8 +1402,286 @@ const RenderContext &get_context() {
 	return s_registry.get<RenderContext>(s_window_entity);
 }
 
+void set_frustum_culling(bool enabled) {
+	s_frustum_culling = enabled;
+	if (!enabled)
+		s_occlusion = nullptr;
+}
+
+bool is_frustum_culling() {
+	return s_frustum_culling;
+}
+
+void set_occlusion_culling(bool enabled, int width, int height) {
+	if (!enabled) {
+		s_occlusion = nullptr;
+		return;
+	}
+	s_frustum_culling = true;
+	s_occlusion = std::make_shared<OcclusionBuffer>(width, height);
+}
+
+bool is_occlusion_culling() {
+	return s_occlusion != nullptr;
+}
+
+OcclusionStats get_occlusion_stats() {
+	return s_occlusion != nullptr ? s_occlusion->get_stats() : OcclusionStats{};
+}
+
+bool write_occlusion_buffer(const std::string &path) {
+	return s_occlusion != nullptr && s_occlusion->write_png(path);
+}
+
+void enable_geometry_pool() {
+	if (off_context()) {
+		s_render_thread->invoke(enable_geometry_pool);
+		return;
+	}
+	if (s_geometry_pool == nullptr) {
+		s_geometry_pool = std::make_shared<GeometryPool>();
+		s_geometry_pool->set_instance_format(s_instance_format);
+	}
+}
+
+bool has_geometry_pool() {
+	return s_geometry_pool != nullptr;
+}
+
+void set_mesh_optimization(bool enabled, const MeshOptimizeOptions &options) {
+	s_optimize_meshes = enabled;
+	s_optimize_options = options;
+}
+
+void set_instance_format(InstanceFormat format) {
+	// the render thread reads it mid packet, so switch between frames
+	on_context([format] {
+		s_instance_format = format;
+		if (s_geometry_pool != nullptr)
+			s_geometry_pool->set_instance_format(format);
+	});
+}
+
+InstanceFormat get_instance_format() {
+	return s_instance_format;
+}
+
+bool generate_lods(entt::entity entity, const LodSettings &settings) {
+	ENGINE_PROFILE_ZONE("render::generate_lods");
+	if (!s_registry.all_of<Mesh<>>(entity))
+		return false;
+	s_registry.remove<MeshLods>(entity);
+	auto &lods = s_registry.emplace<MeshLods>(entity);
+	lods.settings = settings;
+	build_lods(entity, lods);
+	if (lods.levels.size() > 1)
+		return true;
+	s_registry.remove<MeshLods>(entity);
+	return false;
+}
+
+const std::vector<LodLevel> *get_lod_levels(entt::entity entity) {
+	auto lods = s_registry.try_get<MeshLods>(entity);
+	return lods ? &lods->levels : nullptr;
+}
+
+void update_transforms() {
+	s_transforms.update(s_registry);
+}
+
+const glm::mat4 *get_world_transform(entt::entity entity) {
+	return s_transforms.get_world(entity);
+}
+
+void enable_spatial_index() {
+	if (s_spatial_index != nullptr)
+		return;
+	s_spatial_index = std::make_shared<SpatialIndex>();
+	s_spatial_index->connect(s_registry);
+}
+
+bool has_spatial_index() {
+	return s_spatial_index != nullptr;
+}
+
+std::size_t query_instances(const Frustum &frustum, std::vector<InstanceKey> &keys) {
+	keys.clear();
+	if (s_spatial_index == nullptr)
+		return 0;
+	s_spatial_index->update(s_registry);
+	return s_spatial_index->query(frustum, keys);
+}
+
+std::size_t query_instances(const glm::vec3 &center, float radius, std::vector<InstanceKey> &keys) {
+	keys.clear();
+	if (s_spatial_index == nullptr)
+		return 0;
+	s_spatial_index->update(s_registry);
+	return s_spatial_index->query(center, radius, keys);
+}
+
+std::size_t query_instances(const Aabb &box, std::vector<InstanceKey> &keys) {
+	keys.clear();
+	if (s_spatial_index == nullptr)
+		return 0;
+	s_spatial_index->update(s_registry);
+	return s_spatial_index->query(box, keys);
+}
+
+Ray get_mouse_ray(const Camera &camera, const glm::vec2 &cursor) {
+	const auto &context = get_context();
+	return make_ray(cursor, glm::vec2(context.screen_width, context.screen_height), camera.get_view(), get_projection());
+}
+
+bool pick(const Camera &camera, const glm::vec2 &cursor, PickHit &hit) {
+	return pick(get_mouse_ray(camera, cursor), hit);
+}
+
+bool pick(const Ray &ray, PickHit &hit, float max_distance) {
+	ENGINE_PROFILE_ZONE("render::pick");
+	enable_spatial_index();
+	s_spatial_index->update(s_registry);
+	build_triangle_bvhs();
+	return pick(*s_spatial_index, s_registry, ray, hit, max_distance);
+}
+
+SpatialIndexStats get_spatial_index_stats() {
+	return s_spatial_index != nullptr ? s_spatial_index->get_stats() : SpatialIndexStats{};
+}
+
+TransformStats get_transform_stats() {
+	return s_transforms.get_stats();
+}
+
+void register_font(const std::string &name, std::shared_ptr<Font> font) {
+	if (off_context()) {
+		s_render_thread->invoke([&] { register_font(name, font); });
+		return;
+	}
+	if (s_text_renderer == nullptr)
+		s_text_renderer = std::make_shared<TextRenderer>();
+	s_text_renderer->add_font(name, std::move(font));
+}
+
+void set_program_cache_directory(const std::string &directory) {
+	if (off_context()) {
+		s_render_thread->invoke([&] { set_program_cache_directory(directory); });
+		return;
+	}
+	if (directory.empty())
+		s_program_cache = nullptr;
+	else
+		s_program_cache = std::make_shared<ProgramCache>(directory);
+}
+
+ProgramCacheStats get_program_cache_stats() {
+	if (s_program_cache == nullptr)
+		return {};
+	return s_program_cache->get_stats();
+}
+
+GLuint load_texture_async(const std::string &path) {
+	if (off_context()) {
+		GLuint texture{0};
+		s_render_thread->invoke([&] { texture = load_texture_async(path); });
+		return texture;
+	}
+	if (s_texture_streamer == nullptr)
+		s_texture_streamer = std::make_shared<TextureStreamer>();
+	return s_texture_streamer->request(path);
+}
+
+GLuint load_texture_async(std::vector<unsigned char> encoded, const std::string &name) {
+	if (off_context()) {
+		GLuint texture{0};
+		s_render_thread->invoke([&] { texture = load_texture_async(std::move(encoded), name); });
+		return texture;
+	}
+	if (s_texture_streamer == nullptr)
+		s_texture_streamer = std::make_shared<TextureStreamer>();
+	return s_texture_streamer->request(std::move(encoded), name);
+}
+
+void set_texture_upload_budget(std::size_t bytes) {
+	if (off_context()) {
+		s_render_thread->invoke([&] { set_texture_upload_budget(bytes); });
+		return;
+	}
+	if (s_texture_streamer == nullptr)
+		s_texture_streamer = std::make_shared<TextureStreamer>(bytes);
+	else
+		s_texture_streamer->set_bytes_per_frame(bytes);
+}
+
+TextureStreamStats get_texture_stream_stats() {
+	// the streamer guards its own stats
+	if (s_texture_streamer == nullptr)
+		return {};
+	return s_texture_streamer->get_stats();
+}
+
+QueueStats get_queue_stats() {
+	std::lock_guard<std::mutex> lock(s_stats_mutex);
+	return s_queue_stats;
+}
+
+GLStateStats get_gl_state_stats() {
+	std::lock_guard<std::mutex> lock(s_stats_mutex);
+	return s_gl_stats;
+}
+
+void start_render_thread() {
+	if (s_render_thread != nullptr)
+		return;
+	// attributes re-pointed at culled copies are re-pointed at packet data from now on
+	s_registry.clear<VisibleInstances>();
+	s_registry.clear<PackedInstances>();
+	s_packet_instances = std::make_shared<StreamBuffer>(GL_ARRAY_BUFFER);
+	s_render_thread = std::make_shared<RenderThread>(s_registry.get<GLFWwindow*>(s_window_entity), execute_packet,
+	                                                 !s_headless);
+}
+
+void stop_render_thread() {
+	if (s_render_thread == nullptr)
+		return;
+	// joins after the last packet, the context is current here again afterwards
+	s_render_thread = nullptr;
+	s_packet_instances = nullptr;
+	// instance buffers weren't kept up to date while packets carried the transforms
+	auto view = s_registry.view<Mat4Instances>();
+	for (auto entity: view) {
+		if (s_registry.all_of<GeometryRange>(entity))
+			continue;
+		auto &instances = view.get<Mat4Instances>(entity);
+		get_vertex_array(entity).bind();
+		instances.bind();
+		instances.buffer();
+		instances.restore_attributes();
+	}
+	gl_state().bind_vertex_array(0);
+}
+
+bool has_render_thread() {
+	return s_render_thread != nullptr;
+}
+
+void run_on_render_context(const std::function<void()> &task) {
+	on_context(task);
+}
+
+std::size_t get_bytes_uploaded() {
+	return uploaded_bytes().load(std::memory_order_relaxed);
+}
+
+bool is_headless() {
+	return s_headless;
+}
+
 glm::mat4 get_projection() {
-	const auto& context = get_context();
+	return get_projection(get_context());
+}
+
+glm::mat4 get_projection(const RenderContext &context) {
     return glm::perspective(glm::radians(context.fovy),(float)context.screen_width / (float)context.screen_height,context.z_near,context.z_far);
 }
 
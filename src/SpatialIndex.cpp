@@ -0,0 +1,611 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/SpatialIndex.h>
+
+#include <algorithm>
+#include <engine/parallel.h>
+#include <engine/profiler.h>
+#include <engine/render/instance_containers.h>
+#include <limits>
+
+
+namespace engine::render {
+
+namespace {
+
+// a box is a handful of multiply adds, smaller chunks cost more in scheduling than they save
+constexpr std::size_t BOUNDS_GRAIN{4096};
+
+enum class Overlap { outside, intersects, inside };
+
+Aabb merge(const Aabb &a, const Aabb &b) {
+	return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+float surface_area(const Aabb &box) {
+	auto size = box.max - box.min;
+	return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool contains(const Aabb &outer, const Aabb &inner) {
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+	       && inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+bool overlaps(const Aabb &a, const Aabb &b) {
+	return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y
+	       && a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+bool overlaps(const Aabb &box, const glm::vec3 &center, float radius) {
+	auto closest = glm::clamp(center, box.min, box.max);
+	auto d = closest - center;
+	return glm::dot(d, d) <= radius * radius;
+}
+
+// test the box corner furthest along each plane normal, then the nearest one to see if it's wholly inside
+Overlap classify(const Frustum &frustum, const Aabb &box) {
+	auto result = Overlap::inside;
+	for (const auto &plane: frustum.planes) {
+		glm::vec3 far{plane.x >= 0.f ? box.max.x : box.min.x,
+		              plane.y >= 0.f ? box.max.y : box.min.y,
+		              plane.z >= 0.f ? box.max.z : box.min.z};
+		if (glm::dot(glm::vec3(plane), far) + plane.w < 0.f)
+			return Overlap::outside;
+		glm::vec3 near{plane.x >= 0.f ? box.min.x : box.max.x,
+		               plane.y >= 0.f ? box.min.y : box.max.y,
+		               plane.z >= 0.f ? box.min.z : box.max.z};
+		if (glm::dot(glm::vec3(plane), near) + plane.w < 0.f)
+			result = Overlap::intersects;
+	}
+	return result;
+}
+
+// spread the low 10 bits of value out to every third bit
+std::uint32_t spread_bits(std::uint32_t value) {
+	value &= 0x3ff;
+	value = (value | (value << 16)) & 0x030000ff;
+	value = (value | (value << 8)) & 0x0300f00f;
+	value = (value | (value << 4)) & 0x030c30c3;
+	value = (value | (value << 2)) & 0x09249249;
+	return value;
+}
+
+// candidates from the tree before the exact test, per thread so queries can run concurrently
+std::vector<std::uint32_t> &candidates() {
+	thread_local std::vector<std::uint32_t> items;
+	items.clear();
+	return items;
+}
+
+} // anonymous
+
+Aabb transform_aabb(const MeshBounds &bounds, const glm::mat4 &transform) {
+	auto center = glm::vec3(transform * glm::vec4(0.5f * (bounds.min + bounds.max), 1.f));
+	auto half = 0.5f * (bounds.max - bounds.min);
+	auto extent = glm::abs(glm::vec3(transform[0])) * half.x + glm::abs(glm::vec3(transform[1])) * half.y
+	              + glm::abs(glm::vec3(transform[2])) * half.z;
+	return {center - extent, center + extent};
+}
+
+bool intersect(const Aabb &box, const Ray &ray, float max_distance, float &distance) {
+	// slabs, the infinities from axis aligned directions compare the right way
+	auto inverse = 1.f / ray.direction;
+	auto near = (box.min - ray.origin) * inverse;
+	auto far = (box.max - ray.origin) * inverse;
+	auto enter = glm::min(near, far);
+	auto exit = glm::max(near, far);
+	auto first = std::max({enter.x, enter.y, enter.z, 0.f});
+	auto last = std::min({exit.x, exit.y, exit.z, max_distance});
+	if (first > last)
+		return false;
+	distance = first;
+	return true;
+}
+
+std::uint32_t AabbTree::insert(const Aabb &box, std::uint32_t item, bool link) {
+	auto leaf = allocate();
+	auto grow = glm::vec3(m_margin * std::max({box.max.x - box.min.x, box.max.y - box.min.y, box.max.z - box.min.z}));
+	m_nodes[leaf].box = {box.min - grow, box.max + grow};
+	m_nodes[leaf].item = item;
+	++m_leaves;
+	if (link)
+		link_leaf(leaf);
+	return leaf;
+}
+
+void AabbTree::remove(std::uint32_t leaf) {
+	if (m_root == leaf || m_nodes[leaf].parent != NONE)
+		unlink_leaf(leaf);
+	release(leaf);
+	--m_leaves;
+}
+
+bool AabbTree::move(std::uint32_t leaf, const Aabb &box) {
+	if (contains(m_nodes[leaf].box, box))
+		return false;
+	if (m_root == leaf || m_nodes[leaf].parent != NONE)
+		unlink_leaf(leaf);
+	auto grow = glm::vec3(m_margin * std::max({box.max.x - box.min.x, box.max.y - box.min.y, box.max.z - box.min.z}));
+	m_nodes[leaf].box = {box.min - grow, box.max + grow};
+	link_leaf(leaf);
+	return true;
+}
+
+void AabbTree::rebuild() {
+	std::vector<BuildEntry> entries;
+	entries.reserve(m_leaves);
+	Aabb centers{glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+	for (std::uint32_t node = 0; node < m_nodes.size(); ++node) {
+		if (m_nodes[node].height == 0) {
+			auto center = m_nodes[node].box.min + m_nodes[node].box.max;
+			centers.min = glm::min(centers.min, center);
+			centers.max = glm::max(centers.max, center);
+			entries.push_back({0, node});
+		} else if (m_nodes[node].height > 0)
+			release(node);
+	}
+	m_root = NONE;
+	if (entries.empty())
+		return;
+	// 10 bits per axis over the bounds of the centers
+	auto scale = 1023.f / glm::max(centers.max - centers.min, glm::vec3(1e-6f));
+	for (auto &entry: entries) {
+		const auto &box = m_nodes[entry.leaf].box;
+		auto cell = (box.min + box.max - centers.min) * scale;
+		entry.code = spread_bits(static_cast<std::uint32_t>(cell.x)) << 2
+		             | spread_bits(static_cast<std::uint32_t>(cell.y)) << 1
+		             | spread_bits(static_cast<std::uint32_t>(cell.z));
+	}
+	std::sort(entries.begin(), entries.end(), [](const BuildEntry &a, const BuildEntry &b) { return a.code < b.code; });
+	m_nodes.reserve(2 * entries.size());
+	m_root = build(entries, 0, entries.size());
+	m_nodes[m_root].parent = NONE;
+}
+
+void AabbTree::clear() {
+	m_nodes.clear();
+	m_root = NONE;
+	m_free = NONE;
+	m_free_count = 0;
+	m_leaves = 0;
+}
+
+void AabbTree::query(const Aabb &box, std::vector<std::uint32_t> &items) const {
+	collect([&](const Aabb &node) { return overlaps(node, box); }, items);
+}
+
+void AabbTree::query(const glm::vec3 &center, float radius, std::vector<std::uint32_t> &items) const {
+	collect([&](const Aabb &node) { return overlaps(node, center, radius); }, items);
+}
+
+void AabbTree::query(const Frustum &frustum, std::vector<std::uint32_t> &items) const {
+	if (m_root == NONE)
+		return;
+	std::vector<std::uint32_t> stack{m_root};
+	while (!stack.empty()) {
+		auto node = stack.back();
+		stack.pop_back();
+		auto overlap = classify(frustum, m_nodes[node].box);
+		if (overlap == Overlap::outside)
+			continue;
+		if (overlap == Overlap::inside)
+			collect_all(node, items);
+		else if (is_leaf(node))
+			items.push_back(m_nodes[node].item);
+		else {
+			stack.push_back(m_nodes[node].left);
+			stack.push_back(m_nodes[node].right);
+		}
+	}
+}
+
+void AabbTree::query(const Ray &ray, float max_distance, std::vector<std::uint32_t> &items) const {
+	float distance;
+	collect([&](const Aabb &node) { return intersect(node, ray, max_distance, distance); }, items);
+}
+
+std::uint32_t AabbTree::allocate() {
+	if (m_free == NONE) {
+		m_nodes.emplace_back();
+		return static_cast<std::uint32_t>(m_nodes.size() - 1);
+	}
+	auto node = m_free;
+	m_free = m_nodes[node].parent;
+	--m_free_count;
+	m_nodes[node] = Node{};
+	return node;
+}
+
+void AabbTree::release(std::uint32_t node) {
+	m_nodes[node].height = -1;
+	m_nodes[node].parent = m_free;
+	m_free = node;
+	++m_free_count;
+}
+
+void AabbTree::link_leaf(std::uint32_t leaf) {
+	if (m_root == NONE) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NONE;
+		return;
+	}
+	// walk down while pushing the leaf further costs less than pairing it with the current node
+	auto box = m_nodes[leaf].box;
+	auto sibling = m_root;
+	while (!is_leaf(sibling)) {
+		const auto &node = m_nodes[sibling];
+		auto area = surface_area(node.box);
+		auto combined = surface_area(merge(node.box, box));
+		auto cost = 2.f * combined;
+		auto inherited = 2.f * (combined - area);
+		auto descend = [&](std::uint32_t child) {
+			auto grown = surface_area(merge(box, m_nodes[child].box));
+			return (is_leaf(child) ? grown : grown - surface_area(m_nodes[child].box)) + inherited;
+		};
+		auto left_cost = descend(node.left);
+		auto right_cost = descend(node.right);
+		if (cost < left_cost && cost < right_cost)
+			break;
+		sibling = left_cost < right_cost ? node.left : node.right;
+	}
+
+	auto old_parent = m_nodes[sibling].parent;
+	auto parent = allocate();
+	m_nodes[parent].parent = old_parent;
+	m_nodes[parent].box = merge(box, m_nodes[sibling].box);
+	m_nodes[parent].height = m_nodes[sibling].height + 1;
+	m_nodes[parent].left = sibling;
+	m_nodes[parent].right = leaf;
+	if (old_parent == NONE)
+		m_root = parent;
+	else if (m_nodes[old_parent].left == sibling)
+		m_nodes[old_parent].left = parent;
+	else
+		m_nodes[old_parent].right = parent;
+	m_nodes[sibling].parent = parent;
+	m_nodes[leaf].parent = parent;
+	refit(parent);
+}
+
+void AabbTree::unlink_leaf(std::uint32_t leaf) {
+	if (leaf == m_root) {
+		m_root = NONE;
+		return;
+	}
+	auto parent = m_nodes[leaf].parent;
+	auto grandparent = m_nodes[parent].parent;
+	auto sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+	m_nodes[leaf].parent = NONE;
+	release(parent);
+	m_nodes[sibling].parent = grandparent;
+	if (grandparent == NONE) {
+		m_root = sibling;
+		return;
+	}
+	if (m_nodes[grandparent].left == parent)
+		m_nodes[grandparent].left = sibling;
+	else
+		m_nodes[grandparent].right = sibling;
+	refit(grandparent);
+}
+
+void AabbTree::refit(std::uint32_t node) {
+	while (node != NONE) {
+		node = balance(node);
+		auto &current = m_nodes[node];
+		const auto &left = m_nodes[current.left];
+		const auto &right = m_nodes[current.right];
+		current.height = 1 + std::max(left.height, right.height);
+		current.box = merge(left.box, right.box);
+		node = current.parent;
+	}
+}
+
+std::uint32_t AabbTree::balance(std::uint32_t a) {
+	if (is_leaf(a) || m_nodes[a].height < 2)
+		return a;
+	auto b = m_nodes[a].left;
+	auto c = m_nodes[a].right;
+	auto skew = m_nodes[c].height - m_nodes[b].height;
+	if (skew >= -1 && skew <= 1)
+		return a;
+	// the taller child takes a's place, a keeps the shorter child and the shorter of the taller one's children
+	auto up = skew > 1 ? c : b;
+	auto stays = skew > 1 ? b : c;
+	auto f = m_nodes[up].left;
+	auto g = m_nodes[up].right;
+	auto parent = m_nodes[a].parent;
+	m_nodes[up].parent = parent;
+	m_nodes[a].parent = up;
+	if (parent == NONE)
+		m_root = up;
+	else if (m_nodes[parent].left == a)
+		m_nodes[parent].left = up;
+	else
+		m_nodes[parent].right = up;
+	auto taller = m_nodes[f].height > m_nodes[g].height ? f : g;
+	auto shorter = taller == f ? g : f;
+	m_nodes[up].left = a;
+	m_nodes[up].right = taller;
+	if (skew > 1)
+		m_nodes[a].right = shorter;
+	else
+		m_nodes[a].left = shorter;
+	m_nodes[shorter].parent = a;
+	m_nodes[a].box = merge(m_nodes[stays].box, m_nodes[shorter].box);
+	m_nodes[a].height = 1 + std::max(m_nodes[stays].height, m_nodes[shorter].height);
+	m_nodes[up].box = merge(m_nodes[a].box, m_nodes[taller].box);
+	m_nodes[up].height = 1 + std::max(m_nodes[a].height, m_nodes[taller].height);
+	return up;
+}
+
+std::uint32_t AabbTree::build(std::vector<BuildEntry> &entries, std::size_t first, std::size_t last) {
+	if (last - first == 1)
+		return entries[first].leaf;
+	// split where the highest bit differing across the range flips, or in half when the codes are all equal
+	auto middle = first + (last - first) / 2;
+	auto low = entries[first].code, high = entries[last - 1].code;
+	if (low != high) {
+		auto bit = 31 - __builtin_clz(low ^ high);
+		auto mask = ~0u << bit;
+		auto split = (low & mask) | (1u << bit);
+		middle = std::lower_bound(entries.begin() + first, entries.begin() + last, split,
+		                          [](const BuildEntry &entry, std::uint32_t code) { return entry.code < code; })
+		         - entries.begin();
+	}
+	auto left = build(entries, first, middle);
+	auto right = build(entries, middle, last);
+	auto node = allocate();
+	auto &parent = m_nodes[node];
+	parent.left = left;
+	parent.right = right;
+	parent.box = merge(m_nodes[left].box, m_nodes[right].box);
+	parent.height = 1 + std::max(m_nodes[left].height, m_nodes[right].height);
+	m_nodes[left].parent = node;
+	m_nodes[right].parent = node;
+	return node;
+}
+
+template <typename Overlaps>
+void AabbTree::collect(Overlaps overlaps, std::vector<std::uint32_t> &items) const {
+	if (m_root == NONE)
+		return;
+	std::vector<std::uint32_t> stack{m_root};
+	while (!stack.empty()) {
+		auto node = stack.back();
+		stack.pop_back();
+		if (!overlaps(m_nodes[node].box))
+			continue;
+		if (is_leaf(node))
+			items.push_back(m_nodes[node].item);
+		else {
+			stack.push_back(m_nodes[node].left);
+			stack.push_back(m_nodes[node].right);
+		}
+	}
+}
+
+void AabbTree::collect_all(std::uint32_t node, std::vector<std::uint32_t> &items) const {
+	std::vector<std::uint32_t> stack{node};
+	while (!stack.empty()) {
+		node = stack.back();
+		stack.pop_back();
+		if (is_leaf(node))
+			items.push_back(m_nodes[node].item);
+		else {
+			stack.push_back(m_nodes[node].left);
+			stack.push_back(m_nodes[node].right);
+		}
+	}
+}
+
+void SpatialIndex::connect(entt::registry &registry) {
+	registry.on_construct<Mat4Instances>().connect<&SpatialIndex::on_change>(*this);
+	registry.on_update<Mat4Instances>().connect<&SpatialIndex::on_change>(*this);
+	registry.on_destroy<Mat4Instances>().connect<&SpatialIndex::on_destroy>(*this);
+	registry.on_construct<MeshBounds>().connect<&SpatialIndex::on_change>(*this);
+	registry.on_update<MeshBounds>().connect<&SpatialIndex::on_change>(*this);
+	registry.on_destroy<MeshBounds>().connect<&SpatialIndex::on_destroy>(*this);
+	for (auto entity: registry.view<Mat4Instances>())
+		on_change(registry, entity);
+}
+
+void SpatialIndex::disconnect(entt::registry &registry) {
+	registry.on_construct<Mat4Instances>().disconnect<&SpatialIndex::on_change>(*this);
+	registry.on_update<Mat4Instances>().disconnect<&SpatialIndex::on_change>(*this);
+	registry.on_destroy<Mat4Instances>().disconnect<&SpatialIndex::on_destroy>(*this);
+	registry.on_construct<MeshBounds>().disconnect<&SpatialIndex::on_change>(*this);
+	registry.on_update<MeshBounds>().disconnect<&SpatialIndex::on_change>(*this);
+	registry.on_destroy<MeshBounds>().disconnect<&SpatialIndex::on_destroy>(*this);
+}
+
+void SpatialIndex::update(entt::registry &registry) {
+	ENGINE_PROFILE_ZONE("render::update_spatial_index");
+	auto start = std::chrono::steady_clock::now();
+	m_stats.checked = 0;
+	m_stats.moved = 0;
+	// inserting one by one only pays off while most of the tree is already there
+	std::size_t incoming{0};
+	for (auto entity: m_changed) {
+		auto owner = find(entity);
+		if (owner != nullptr && registry.valid(entity) && registry.all_of<Mat4Instances>(entity)) {
+			auto count = registry.get<Mat4Instances>(entity).num_instances();
+			if (count > owner->items.size())
+				incoming += count - owner->items.size();
+		}
+	}
+	m_stats.rebuilt = incoming > m_tree.size();
+	for (auto entity: m_changed) {
+		if (auto owner = find(entity)) {
+			owner->changed = false;
+			sync(registry, *owner, !m_stats.rebuilt);
+		}
+	}
+	m_changed.clear();
+	if (m_stats.rebuilt)
+		m_tree.rebuild();
+	m_stats.instances = m_tree.size();
+	m_stats.nodes = m_tree.get_node_count();
+	m_stats.height = m_tree.get_height();
+	m_stats.time = std::chrono::steady_clock::now() - start;
+}
+
+std::size_t SpatialIndex::query(const Frustum &frustum, std::vector<InstanceKey> &keys) const {
+	auto &items = candidates();
+	m_tree.query(frustum, items);
+	keys.clear();
+	for (auto item: items)
+		if (classify(frustum, m_items[item].box) != Overlap::outside)
+			keys.push_back(m_items[item].key);
+	return keys.size();
+}
+
+std::size_t SpatialIndex::query(const glm::vec3 &center, float radius, std::vector<InstanceKey> &keys) const {
+	auto &items = candidates();
+	m_tree.query(center, radius, items);
+	keys.clear();
+	for (auto item: items)
+		if (overlaps(m_items[item].box, center, radius))
+			keys.push_back(m_items[item].key);
+	return keys.size();
+}
+
+std::size_t SpatialIndex::query(const Aabb &box, std::vector<InstanceKey> &keys) const {
+	auto &items = candidates();
+	m_tree.query(box, items);
+	keys.clear();
+	for (auto item: items)
+		if (overlaps(m_items[item].box, box))
+			keys.push_back(m_items[item].key);
+	return keys.size();
+}
+
+std::size_t SpatialIndex::query(const Ray &ray, float max_distance, std::vector<InstanceKey> &keys) const {
+	auto &items = candidates();
+	m_tree.query(ray, max_distance, items);
+	thread_local std::vector<std::pair<float, std::uint32_t>> hits;
+	hits.clear();
+	float distance;
+	for (auto item: items)
+		if (intersect(m_items[item].box, ray, max_distance, distance))
+			hits.emplace_back(distance, item);
+	std::sort(hits.begin(), hits.end());
+	keys.clear();
+	for (const auto &hit: hits)
+		keys.push_back(m_items[hit.second].key);
+	return keys.size();
+}
+
+const Aabb *SpatialIndex::get_bounds(const InstanceKey &key) const {
+	auto owner = find(key.mesh);
+	if (owner == nullptr || key.instance >= owner->items.size())
+		return nullptr;
+	return &m_items[owner->items[key.instance]].box;
+}
+
+void SpatialIndex::on_change(entt::registry &, entt::entity entity) {
+	auto id = static_cast<std::size_t>(entt::to_entity(entity));
+	if (id >= m_owners.size())
+		m_owners.resize(id + 1);
+	auto &owner = m_owners[id];
+	if (owner.entity != entity) {
+		// the id was recycled without us seeing the old entity go
+		remove_all(owner);
+		owner.entity = entity;
+	}
+	if (!owner.changed) {
+		owner.changed = true;
+		m_changed.push_back(entity);
+	}
+}
+
+void SpatialIndex::on_destroy(entt::registry &, entt::entity entity) {
+	if (auto owner = find(entity)) {
+		remove_all(*owner);
+		owner->entity = entt::null;
+		owner->changed = false;
+	}
+}
+
+SpatialIndex::Owner *SpatialIndex::find(entt::entity entity) {
+	auto id = static_cast<std::size_t>(entt::to_entity(entity));
+	return id < m_owners.size() && m_owners[id].entity == entity ? &m_owners[id] : nullptr;
+}
+
+const SpatialIndex::Owner *SpatialIndex::find(entt::entity entity) const {
+	auto id = static_cast<std::size_t>(entt::to_entity(entity));
+	return id < m_owners.size() && m_owners[id].entity == entity ? &m_owners[id] : nullptr;
+}
+
+void SpatialIndex::remove_all(Owner &owner) {
+	for (auto item: owner.items) {
+		m_tree.remove(m_items[item].leaf);
+		m_items[item].leaf = AabbTree::NONE;
+		m_free_items.push_back(item);
+	}
+	owner.items.clear();
+}
+
+void SpatialIndex::sync(entt::registry &registry, Owner &owner, bool link) {
+	auto entity = owner.entity;
+	if (!registry.valid(entity) || !registry.all_of<Mat4Instances, MeshBounds>(entity)) {
+		remove_all(owner);
+		return;
+	}
+	const auto &transforms = registry.get<Mat4Instances>(entity).get_data_vector();
+	const auto &bounds = registry.get<MeshBounds>(entity);
+	while (owner.items.size() > transforms.size()) {
+		auto item = owner.items.back();
+		m_tree.remove(m_items[item].leaf);
+		m_items[item].leaf = AabbTree::NONE;
+		m_free_items.push_back(item);
+		owner.items.pop_back();
+	}
+	m_boxes.resize(transforms.size());
+	parallel_for(transforms.size(), [&](std::size_t first, std::size_t last) {
+		for (auto i = first; i < last; ++i)
+			m_boxes[i] = transform_aabb(bounds, transforms[i]);
+	}, BOUNDS_GRAIN);
+	m_stats.checked += transforms.size();
+
+	for (std::size_t i = 0; i < owner.items.size(); ++i) {
+		auto &item = m_items[owner.items[i]];
+		item.box = m_boxes[i];
+		if (m_tree.move(item.leaf, item.box))
+			++m_stats.moved;
+	}
+	for (auto i = owner.items.size(); i < transforms.size(); ++i) {
+		std::uint32_t item;
+		if (m_free_items.empty()) {
+			item = static_cast<std::uint32_t>(m_items.size());
+			m_items.emplace_back();
+		} else {
+			item = m_free_items.back();
+			m_free_items.pop_back();
+		}
+		m_items[item] = {{entity, static_cast<std::uint32_t>(i)}, m_boxes[i], AabbTree::NONE};
+		m_items[item].leaf = m_tree.insert(m_boxes[i], item, link);
+		owner.items.push_back(item);
+	}
+}
+
+} // namespace engine::render
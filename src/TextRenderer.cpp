@@ -0,0 +1,167 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/TextRenderer.h>
+
+#include <algorithm>
+#include <engine/render/glm_attributes.h>
+#include <engine/render/GLState.h>
+#include <engine/render/renderer.h>
+#include <engine/render/sprite/TextSprite.h>
+
+
+namespace engine::render {
+
+namespace {
+
+const char *TEXT_VERTEX_SOURCE = R"(#version 410 core
+layout(location = 0) in vec2 corner;
+layout(location = 1) in vec4 rect;
+layout(location = 2) in vec4 uv_rect;
+layout(location = 3) in vec4 color;
+uniform mat4 projection;
+out vec2 uv;
+out vec4 tint;
+void main() {
+	gl_Position = projection * vec4(rect.xy + corner * rect.zw, 0.0, 1.0);
+	uv = mix(uv_rect.xy, uv_rect.zw, corner);
+	tint = color;
+}
+)";
+
+const char *TEXT_FRAGMENT_SOURCE = R"(#version 410 core
+in vec2 uv;
+in vec4 tint;
+uniform sampler2D atlas;
+out vec4 frag_color;
+void main() {
+	frag_color = vec4(tint.rgb, tint.a * texture(atlas, uv).r);
+}
+)";
+
+} // anonymous
+
+TextRenderer::TextRenderer()
+		: m_shader(load_shader(TEXT_VERTEX_SOURCE, TEXT_FRAGMENT_SOURCE)),
+		  m_projection_uniform(m_shader.get_uniform<glm::mat4>("projection")),
+		  m_atlas_uniform(m_shader.get_uniform<int>("atlas")) {
+	// triangle strip over the unit square, y down to match screen space
+	const glm::vec2 corners[] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+	glGenVertexArrays(1, &m_vao);
+	gl_state().bind_vertex_array(m_vao);
+	glGenBuffers(1, &m_quad);
+	gl_state().bind_buffer(GL_ARRAY_BUFFER, m_quad);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	Vec2Attribute().bind(0);
+	gl_state().bind_vertex_array(0);
+}
+
+TextRenderer::~TextRenderer() {
+	m_shader.destroy();
+	gl_state().delete_buffers(1, &m_quad);
+	gl_state().delete_vertex_arrays(1, &m_vao);
+}
+
+void TextRenderer::add_font(const std::string &name, Font::Ptr font) {
+	m_fonts[name] = std::move(font);
+}
+
+void TextRenderer::render(entt::registry &registry, const glm::mat4 &projection) {
+	collect(registry, m_batches);
+	draw(m_batches, projection);
+}
+
+void TextRenderer::collect(entt::registry &registry, std::vector<GlyphBatch> &batches) const {
+	// reuse the glyph storage of batches from earlier frames
+	for (auto &batch: batches)
+		batch.glyphs.clear();
+
+	auto sprites = registry.view<TextSprite>();
+	for (auto entity: sprites) {
+		const auto &sprite = sprites.get<TextSprite>(entity);
+		if (!sprite.visible || sprite.text.empty())
+			continue;
+		auto font = m_fonts.find(sprite.font);
+		if (font == m_fonts.end())
+			continue;
+		const auto &glyphs = font->second->get_glyphs();
+		auto atlas = font->second->get_atlas();
+		auto batch = std::find_if(batches.begin(), batches.end(),
+		                          [atlas](const GlyphBatch &batch) { return batch.atlas == atlas; });
+		if (batch == batches.end())
+			batch = batches.insert(batches.end(), GlyphBatch{atlas, {}});
+		auto x = sprite.x;
+		glm::vec4 color(sprite.color, 1.f);
+		for (unsigned char c: sprite.text) {
+			auto it = glyphs.find(c);
+			if (it == glyphs.end())
+				continue;
+			const auto &glyph = it->second;
+			if (glyph.size.x > 0 && glyph.size.y > 0)
+				batch->glyphs.push_back({glm::vec4(x + glyph.bearing.x * sprite.scale,
+				                                   sprite.y - glyph.bearing.y * sprite.scale,
+				                                   glyph.size.x * sprite.scale,
+				                                   glyph.size.y * sprite.scale),
+				                         glyph.uv,
+				                         color});
+			// advance is in 1/64 pixels
+			x += (glyph.advance >> 6) * sprite.scale;
+		}
+	}
+}
+
+void TextRenderer::draw(const std::vector<GlyphBatch> &batches, const glm::mat4 &projection) {
+	m_draw_calls = 0;
+	m_glyph_count = 0;
+
+	// text goes over the scene without depth testing
+	auto &state = gl_state();
+	auto depth_test = state.is_enabled(GL_DEPTH_TEST);
+	auto blend = state.is_enabled(GL_BLEND);
+	state.disable(GL_DEPTH_TEST);
+	state.enable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	m_shader.use();
+	m_shader.set(m_projection_uniform, projection);
+	m_shader.set(m_atlas_uniform, 0);
+	state.active_texture(GL_TEXTURE0);
+	state.bind_vertex_array(m_vao);
+	for (const auto &batch: batches) {
+		if (batch.glyphs.empty())
+			continue;
+		auto offset = m_instances.write(batch.glyphs.data(), batch.glyphs.size() * sizeof(GlyphInstance));
+		bind_instance_attributes(offset);
+		state.bind_texture(GL_TEXTURE_2D, batch.atlas);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, batch.glyphs.size());
+		++m_draw_calls;
+		m_glyph_count += batch.glyphs.size();
+	}
+	state.set_enabled(GL_DEPTH_TEST, depth_test);
+	state.set_enabled(GL_BLEND, blend);
+}
+
+void TextRenderer::bind_instance_attributes(GLintptr offset) {
+	auto stride = sizeof(GlyphInstance);
+	Vec4Attribute(GL_FLOAT, false, stride, (void*) offsetof(GlyphInstance, rect)).bind(1, 1, offset);
+	Vec4Attribute(GL_FLOAT, false, stride, (void*) offsetof(GlyphInstance, uv)).bind(2, 1, offset);
+	Vec4Attribute(GL_FLOAT, false, stride, (void*) offsetof(GlyphInstance, color)).bind(3, 1, offset);
+}
+
+} // namespace engine::render
@@ -0,0 +1,248 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#define CUTE_PNG_IMPLEMENTATION
+#include <engine/render/TextureStreamer.h>
+
+#include <cstring>
+#include <cute_png.h>
+#include <engine/profiler.h>
+#include <engine/render/GLState.h>
+#include <iostream>
+
+
+namespace engine::render {
+
+namespace {
+
+// placeholders are downsampled until both sides are at most this many pixels
+constexpr int PLACEHOLDER_SIZE{32};
+
+bool decode_png(const std::string &path, DecodedImage &image) {
+	auto png = cp_load_png(path.c_str());
+	if (png.pix == nullptr)
+		return false;
+	image.width = png.w;
+	image.height = png.h;
+	image.pixels.resize(static_cast<std::size_t>(png.w) * png.h * 4);
+	std::memcpy(image.pixels.data(), png.pix, image.pixels.size());
+	cp_free_png(&png);
+	return true;
+}
+
+bool decode_png_memory(const std::vector<unsigned char> &encoded, DecodedImage &image) {
+	auto png = cp_load_png_mem(encoded.data(), static_cast<int>(encoded.size()));
+	if (png.pix == nullptr)
+		return false;
+	image.width = png.w;
+	image.height = png.h;
+	image.pixels.resize(static_cast<std::size_t>(png.w) * png.h * 4);
+	std::memcpy(image.pixels.data(), png.pix, image.pixels.size());
+	cp_free_png(&png);
+	return true;
+}
+
+// 2x2 box filter matching how GL sizes mip levels (floor, minimum of 1)
+DecodedImage downsample(const DecodedImage &image) {
+	DecodedImage half;
+	half.width = std::max(1, image.width / 2);
+	half.height = std::max(1, image.height / 2);
+	half.pixels.resize(static_cast<std::size_t>(half.width) * half.height * 4);
+	for (int y = 0; y < half.height; ++y) {
+		auto y0 = std::min(2 * y, image.height - 1), y1 = std::min(2 * y + 1, image.height - 1);
+		for (int x = 0; x < half.width; ++x) {
+			auto x0 = std::min(2 * x, image.width - 1), x1 = std::min(2 * x + 1, image.width - 1);
+			for (int c = 0; c < 4; ++c) {
+				auto sum = image.pixels[(y0 * image.width + x0) * 4 + c]
+				           + image.pixels[(y0 * image.width + x1) * 4 + c]
+				           + image.pixels[(y1 * image.width + x0) * 4 + c]
+				           + image.pixels[(y1 * image.width + x1) * 4 + c];
+				half.pixels[(y * half.width + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+			}
+		}
+	}
+	return half;
+}
+
+} // anonymous
+
+TextureStreamer::TextureStreamer(std::size_t bytes_per_frame, unsigned int workers, ImageDecoder decoder)
+		: m_bytes_per_frame(bytes_per_frame), m_decoder(decoder ? std::move(decoder) : decode_png) {
+	for (unsigned int i = 0; i < std::max(workers, 1u); ++i)
+		m_workers.emplace_back(&TextureStreamer::work, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+	for (auto &worker: m_workers)
+		worker.join();
+}
+
+GLuint TextureStreamer::request(const std::string &path) {
+	return queue({0, path, {}});
+}
+
+GLuint TextureStreamer::request(std::vector<unsigned char> encoded, const std::string &name) {
+	return queue({0, name, std::move(encoded)});
+}
+
+GLuint TextureStreamer::queue(DecodeJob job) {
+	// a single mid gray texel until the placeholder arrives
+	const unsigned char gray[4] = {128, 128, 128, 255};
+	GLuint texture;
+	glGenTextures(1, &texture);
+	gl_state().bind_texture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	job.texture = texture;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_condition.notify_one();
+	return texture;
+}
+
+void TextureStreamer::update() {
+	ENGINE_PROFILE_ZONE("TextureStreamer::update");
+	ENGINE_PROFILE_GPU_ZONE("texture upload");
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while (!m_decoded.empty()) {
+			m_uploads.push_back(std::move(m_decoded.front()));
+			m_decoded.pop_front();
+			begin(m_uploads.back());
+		}
+	}
+
+	// every row uploaded this frame is packed into one unpack buffer region behind the previous texture's rows,
+	// which is fenced once when the next frame starts
+	if (!m_uploads.empty())
+		m_unpack_buffer.reserve_frame(static_cast<GLsizeiptr>(m_bytes_per_frame));
+	std::size_t uploaded{0};
+	while (!m_uploads.empty() && uploaded < m_bytes_per_frame) {
+		auto &upload = m_uploads.front();
+		uploaded += upload_rows(upload, m_bytes_per_frame - uploaded);
+		if (upload.next_row == upload.image.height) {
+			finish(upload);
+			m_uploads.pop_front();
+		}
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.bytes_uploaded_last_frame = uploaded;
+	m_stats.bytes_uploaded_total += uploaded;
+}
+
+TextureStreamStats TextureStreamer::get_stats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.decode_queue = m_jobs.size() + m_decoding;
+	m_stats.upload_queue = m_decoded.size() + m_uploads.size();
+	return m_stats;
+}
+
+void TextureStreamer::work() {
+	ENGINE_PROFILE_THREAD("texture decode");
+	while (true) {
+		DecodeJob job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+			if (m_stopping)
+				return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			++m_decoding;
+		}
+
+		ENGINE_PROFILE_ZONE("TextureStreamer::decode");
+		Upload upload{job.texture};
+		bool decoded = (job.encoded.empty() ? m_decoder(job.path, upload.image)
+		                                    : decode_png_memory(job.encoded, upload.image))
+		               && upload.image.width > 0 && upload.image.height > 0;
+		if (decoded) {
+			// walk down the mip chain until the placeholder is small enough to upload in one go
+			const DecodedImage *level = &upload.image;
+			while (level->width > PLACEHOLDER_SIZE || level->height > PLACEHOLDER_SIZE) {
+				upload.placeholder = downsample(*level);
+				level = &upload.placeholder;
+				++upload.placeholder_level;
+			}
+		} else
+			std::cerr << "Could not decode texture at '" << job.path << "'" << std::endl;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		--m_decoding;
+		// failed textures keep the gray texel
+		if (decoded)
+			m_decoded.push_back(std::move(upload));
+	}
+}
+
+void TextureStreamer::begin(Upload &upload) {
+	const auto &image = upload.image;
+	gl_state().bind_texture(GL_TEXTURE_2D, upload.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	if (upload.placeholder_level > 0) {
+		const auto &placeholder = upload.placeholder;
+		glTexImage2D(GL_TEXTURE_2D, upload.placeholder_level, GL_RGBA8, placeholder.width, placeholder.height, 0,
+		             GL_RGBA, GL_UNSIGNED_BYTE, placeholder.pixels.data());
+		// only sample the placeholder level until level 0 is complete
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, upload.placeholder_level);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, upload.placeholder_level);
+		upload.placeholder = {};
+	}
+}
+
+std::size_t TextureStreamer::upload_rows(Upload &upload, std::size_t budget) {
+	const auto &image = upload.image;
+	auto row_bytes = static_cast<std::size_t>(image.width) * 4;
+	auto rows = std::max<std::size_t>(1, budget / row_bytes);
+	rows = std::min<std::size_t>(rows, image.height - upload.next_row);
+	auto bytes = rows * row_bytes;
+
+	auto offset = m_unpack_buffer.write(&image.pixels[upload.next_row * row_bytes], bytes);
+	gl_state().bind_texture(GL_TEXTURE_2D, upload.texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.next_row, image.width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+	                (void*) offset);
+	// anything else passing client pointers to glTex* must not see the unpack buffer
+	gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	upload.next_row += rows;
+	return bytes;
+}
+
+void TextureStreamer::finish(Upload &upload) {
+	gl_state().bind_texture(GL_TEXTURE_2D, upload.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	upload.image = {};
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_stats.textures_completed;
+}
+
+} // namespace engine::render
@@ -0,0 +1,251 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/TransformHierarchy.h>
+
+#include <algorithm>
+#include <atomic>
+#include <engine/parallel.h>
+#include <engine/profiler.h>
+#include <engine/render/instance_containers.h>
+#include <iostream>
+
+
+namespace engine::render {
+
+namespace {
+
+// a node is a couple of matrix products, smaller chunks cost more in scheduling than they save
+constexpr std::size_t PROPAGATE_GRAIN{2048};
+
+} // anonymous
+
+glm::mat4 Transform::to_mat4() const {
+	auto matrix = glm::mat4_cast(rotation);
+	matrix[0] *= scale.x;
+	matrix[1] *= scale.y;
+	matrix[2] *= scale.z;
+	matrix[3] = glm::vec4(translation, 1.f);
+	return matrix;
+}
+
+void TransformHierarchy::connect(entt::registry &registry) {
+	registry.on_construct<Transform>().connect<&TransformHierarchy::on_construct>(*this);
+	registry.on_update<Transform>().connect<&TransformHierarchy::on_update>(*this);
+	registry.on_destroy<Transform>().connect<&TransformHierarchy::on_destroy>(*this);
+	m_rebuild = true;
+}
+
+void TransformHierarchy::disconnect(entt::registry &registry) {
+	registry.on_construct<Transform>().disconnect<&TransformHierarchy::on_construct>(*this);
+	registry.on_update<Transform>().disconnect<&TransformHierarchy::on_update>(*this);
+	registry.on_destroy<Transform>().disconnect<&TransformHierarchy::on_destroy>(*this);
+}
+
+void TransformHierarchy::update(entt::registry &registry) {
+	ENGINE_PROFILE_ZONE("render::update_transforms");
+	auto start = std::chrono::steady_clock::now();
+	m_stats.rebuilt = m_rebuild || !apply_changes(registry);
+	if (m_stats.rebuilt)
+		rebuild(registry);
+	m_changed.clear();
+	propagate();
+	write_instances(registry);
+	std::fill(m_dirty.begin(), m_dirty.end(), 0);
+	m_stats.nodes = m_entities.size();
+	m_stats.levels = m_levels.empty() ? 0 : m_levels.size() - 1;
+	m_stats.time = std::chrono::steady_clock::now() - start;
+}
+
+const glm::mat4 *TransformHierarchy::get_world(entt::entity entity) const {
+	auto node = find(entity);
+	return node == NONE ? nullptr : &m_world[node];
+}
+
+void TransformHierarchy::on_construct(entt::registry &registry, entt::entity entity) {
+	m_rebuild = true;
+}
+
+void TransformHierarchy::on_update(entt::registry &registry, entt::entity entity) {
+	if (!m_rebuild)
+		m_changed.push_back(entity);
+}
+
+void TransformHierarchy::on_destroy(entt::registry &registry, entt::entity entity) {
+	// children of the node turn into roots, which needs a re-sort anyway
+	m_rebuild = true;
+}
+
+std::uint32_t TransformHierarchy::find(entt::entity entity) const {
+	if (entity == entt::null)
+		return NONE;
+	auto id = static_cast<std::size_t>(entt::to_entity(entity));
+	if (id >= m_lookup.size() || m_lookup[id] == NONE || m_entities[m_lookup[id]] != entity)
+		return NONE;
+	return m_lookup[id];
+}
+
+void TransformHierarchy::rebuild(entt::registry &registry) {
+	ENGINE_PROFILE_ZONE("render::rebuild_transforms");
+	// registry order first, then permuted into breadth first order once every depth is known
+	auto view = registry.view<Transform>();
+	m_entities.assign(view.begin(), view.end());
+	auto count = m_entities.size();
+	std::fill(m_lookup.begin(), m_lookup.end(), NONE);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		auto id = static_cast<std::size_t>(entt::to_entity(m_entities[i]));
+		if (id >= m_lookup.size())
+			m_lookup.resize(id + 1, NONE);
+		m_lookup[id] = i;
+	}
+	std::vector<std::uint32_t> parents(count);
+	for (std::uint32_t i = 0; i < count; ++i)
+		parents[i] = find(registry.get<Transform>(m_entities[i]).parent);
+
+	// -1 unknown, -2 on the chain being walked
+	std::vector<int> depths(count, -1);
+	std::vector<std::uint32_t> chain;
+	int max_depth{-1};
+	for (std::uint32_t i = 0; i < count; ++i) {
+		chain.clear();
+		auto node = i;
+		while (depths[node] == -1) {
+			depths[node] = -2;
+			chain.push_back(node);
+			if (parents[node] == NONE)
+				break;
+			node = parents[node];
+		}
+		if (depths[node] == -2 && parents[node] != NONE) {
+			std::cerr << "Transform hierarchy contains a cycle, cutting it at entity "
+			          << static_cast<std::size_t>(entt::to_entity(m_entities[node])) << std::endl;
+			parents[node] = NONE;
+			depths[node] = 0;
+		}
+		for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+			depths[*it] = parents[*it] == NONE ? 0 : depths[parents[*it]] + 1;
+			max_depth = std::max(max_depth, depths[*it]);
+		}
+	}
+
+	// counting sort by depth keeps registry order within a depth
+	m_levels.assign(max_depth + 2, 0);
+	for (auto depth: depths)
+		++m_levels[depth + 1];
+	for (std::size_t level = 1; level < m_levels.size(); ++level)
+		m_levels[level] += m_levels[level - 1];
+	auto next = m_levels;
+	std::vector<std::uint32_t> order(count);
+	for (std::uint32_t i = 0; i < count; ++i)
+		order[i] = next[depths[i]]++;
+
+	std::vector<entt::entity> entities(count);
+	m_parents.assign(count, NONE);
+	m_links.resize(count);
+	m_local.resize(count);
+	m_world.resize(count);
+	m_dirty.assign(count, 1);
+	m_targets.clear();
+	for (std::uint32_t i = 0; i < count; ++i) {
+		auto node = order[i];
+		const auto &transform = registry.get<Transform>(m_entities[i]);
+		entities[node] = m_entities[i];
+		m_parents[node] = parents[i] == NONE ? NONE : order[parents[i]];
+		m_links[node] = {transform.parent, transform.instances, transform.instance};
+		m_local[node] = transform.to_mat4();
+		m_lookup[entt::to_entity(m_entities[i])] = node;
+		if (transform.instances != entt::null)
+			m_targets.push_back(node);
+	}
+	m_entities = std::move(entities);
+	std::sort(m_targets.begin(), m_targets.end(), [this](std::uint32_t a, std::uint32_t b) {
+		const auto &first = m_links[a], &second = m_links[b];
+		return first.instances < second.instances
+		       || (first.instances == second.instances && first.instance < second.instance);
+	});
+	m_rebuild = false;
+}
+
+bool TransformHierarchy::apply_changes(entt::registry &registry) {
+	for (auto entity: m_changed) {
+		auto node = find(entity);
+		if (node == NONE)
+			continue;
+		const auto &transform = registry.get<Transform>(entity);
+		const auto &link = m_links[node];
+		if (link.parent != transform.parent || link.instances != transform.instances
+		    || link.instance != transform.instance)
+			return false;
+		m_local[node] = transform.to_mat4();
+		m_dirty[node] = 1;
+	}
+	return true;
+}
+
+void TransformHierarchy::propagate() {
+	ENGINE_PROFILE_ZONE("render::propagate_transforms");
+	std::atomic<std::size_t> updated{0};
+	// a depth only reads the one before it, so its nodes are independent of each other
+	for (std::size_t level = 0; level + 1 < m_levels.size(); ++level) {
+		auto first = m_levels[level];
+		parallel_for(m_levels[level + 1] - first, [&](std::size_t begin, std::size_t end) {
+			std::size_t count{0};
+			for (auto node = first + begin; node < first + end; ++node) {
+				auto parent = m_parents[node];
+				if (parent != NONE && m_dirty[parent])
+					m_dirty[node] = 1;
+				if (!m_dirty[node])
+					continue;
+				m_world[node] = parent == NONE ? m_local[node] : m_world[parent] * m_local[node];
+				++count;
+			}
+			updated.fetch_add(count, std::memory_order_relaxed);
+		}, PROPAGATE_GRAIN);
+	}
+	m_stats.updated = updated.load();
+}
+
+void TransformHierarchy::write_instances(entt::registry &registry) {
+	ENGINE_PROFILE_ZONE("render::write_transforms");
+	m_stats.written = 0;
+	std::size_t first{0};
+	while (first < m_targets.size()) {
+		auto owner = m_links[m_targets[first]].instances;
+		auto last = first;
+		bool changed{false};
+		for (; last < m_targets.size() && m_links[m_targets[last]].instances == owner; ++last)
+			changed = changed || m_dirty[m_targets[last]];
+		// one patch per owner so its upload callback runs once however many slots changed
+		if (changed && registry.valid(owner) && registry.all_of<Mat4Instances>(owner))
+			registry.patch<Mat4Instances>(owner, [&](Mat4Instances &instances) {
+				for (auto target = first; target < last; ++target) {
+					auto node = m_targets[target];
+					auto slot = m_links[node].instance;
+					if (!m_dirty[node] || slot >= instances.num_instances())
+						continue;
+					instances.set_instance(slot, m_world[node]);
+					++m_stats.written;
+				}
+			});
+		first = last;
+	}
+}
+
+} // namespace engine::render
@@ -0,0 +1,245 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/culling.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(ENGINE_CULLING_X86)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+namespace engine::render {
+
+namespace {
+
+// test spheres [first, count) one at a time, shared by the scalar kernel and the SIMD tails
+std::size_t cull_range(const Frustum &frustum, const SphereSet &spheres, std::size_t first,
+                       std::uint32_t *out) {
+	std::size_t visible{0};
+	for (auto i = first; i < spheres.size(); ++i) {
+		if (frustum.intersects(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]))
+			out[visible++] = static_cast<std::uint32_t>(i);
+	}
+	return visible;
+}
+
+// append the indices of set bits in mask
+inline std::size_t compact(unsigned int mask, std::size_t base, std::uint32_t *out) {
+	std::size_t written{0};
+	while (mask) {
+		out[written++] = static_cast<std::uint32_t>(base + __builtin_ctz(mask));
+		mask &= mask - 1;
+	}
+	return written;
+}
+
+#if defined(ENGINE_CULLING_X86)
+// The x86 kernels are compiled for their instruction set through target attributes, so a default x86-64 build still
+// carries them and cull_spheres picks the widest one the CPU supports at run time. Distances are summed in the order
+// glm::dot uses and compared with "not less than", so they agree with Frustum::intersects bit for bit, NaN included
+__attribute__((target("avx2")))
+std::size_t cull_avx2(const Frustum &frustum, const SphereSet &spheres, std::size_t n, std::uint32_t *out) {
+	std::size_t count{0};
+	for (std::size_t i = 0; i + 8 <= n; i += 8) {
+		auto x = _mm256_loadu_ps(&spheres.x[i]);
+		auto y = _mm256_loadu_ps(&spheres.y[i]);
+		auto z = _mm256_loadu_ps(&spheres.z[i]);
+		auto neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+		auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const auto &plane: frustum.planes) {
+			auto d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), x),
+			                       _mm256_mul_ps(_mm256_set1_ps(plane.y), y));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(plane.z), z));
+			d = _mm256_add_ps(d, _mm256_set1_ps(plane.w));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_NLT_UQ));
+		}
+		count += compact(_mm256_movemask_ps(inside), i, out + count);
+	}
+	return count;
+}
+
+__attribute__((target("sse4.1")))
+std::size_t cull_sse41(const Frustum &frustum, const SphereSet &spheres, std::size_t n, std::uint32_t *out) {
+	std::size_t count{0};
+	for (std::size_t i = 0; i + 4 <= n; i += 4) {
+		auto x = _mm_loadu_ps(&spheres.x[i]);
+		auto y = _mm_loadu_ps(&spheres.y[i]);
+		auto z = _mm_loadu_ps(&spheres.z[i]);
+		auto neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+		auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const auto &plane: frustum.planes) {
+			auto d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.z), z));
+			d = _mm_add_ps(d, _mm_set1_ps(plane.w));
+			inside = _mm_and_ps(inside, _mm_cmpnlt_ps(d, neg_r));
+		}
+		count += compact(_mm_movemask_ps(inside), i, out + count);
+	}
+	return count;
+}
+
+// spheres per step of the kernel the CPU runs, 1 when it has neither
+unsigned int simd_width() {
+	static const auto width = [] {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return 8u;
+		if (__builtin_cpu_supports("sse4.1"))
+			return 4u;
+		return 1u;
+	}();
+	return width;
+}
+
+// kernel over the full steps of width spheres, then the tail one at a time
+template <typename Kernel>
+std::size_t cull_in_steps(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible,
+                          std::size_t width, Kernel kernel) {
+	auto n = spheres.size();
+	visible.resize(n);
+	auto count = kernel(frustum, spheres, n, visible.data());
+	count += cull_range(frustum, spheres, n / width * width, visible.data() + count);
+	visible.resize(count);
+	return count;
+}
+#endif
+
+} // anonymous
+
+MeshBounds compute_bounds(const std::vector<glm::vec3> &vertices) {
+	MeshBounds bounds;
+	if (vertices.empty())
+		return bounds;
+	bounds.min = vertices[0];
+	bounds.max = vertices[0];
+	for (const auto &v: vertices) {
+		bounds.min = glm::min(bounds.min, v);
+		bounds.max = glm::max(bounds.max, v);
+	}
+	// sphere around the box center, tighter than the box corner distance for most meshes
+	bounds.center = 0.5f * (bounds.min + bounds.max);
+	float radius_squared{0};
+	for (const auto &v: vertices) {
+		auto d = v - bounds.center;
+		radius_squared = std::max(radius_squared, glm::dot(d, d));
+	}
+	bounds.radius = std::sqrt(radius_squared);
+	return bounds;
+}
+
+Frustum::Frustum(const glm::mat4 &view_projection) {
+	// Gribb/Hartmann plane extraction, glm is column major so row i is m[0][i]..m[3][i]
+	auto row = [&](int i) {
+		return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+	};
+	auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+	planes = {r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2};
+	for (auto &plane: planes)
+		plane = plane / glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersects(const glm::vec3 &center, float radius) const {
+	for (const auto &plane: planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+void transform_bounds(const MeshBounds &bounds, const glm::mat4 *transforms, std::size_t count, SphereSet &out) {
+	out.resize(count);
+	auto c = glm::vec4(bounds.center, 1.f);
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto &m = transforms[i];
+		auto p = m * c;
+		auto scale_squared = std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+		                               glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+		                               glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))});
+		out.x[i] = p.x;
+		out.y[i] = p.y;
+		out.z[i] = p.z;
+		out.radius[i] = bounds.radius * std::sqrt(scale_squared);
+	}
+}
+
+std::size_t cull_spheres_scalar(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible) {
+	visible.resize(spheres.size());
+	auto count = cull_range(frustum, spheres, 0, visible.data());
+	visible.resize(count);
+	return count;
+}
+
+#if defined(ENGINE_CULLING_X86)
+std::size_t cull_spheres_sse41(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible) {
+	return cull_in_steps(frustum, spheres, visible, 4, cull_sse41);
+}
+
+std::size_t cull_spheres_avx2(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible) {
+	return cull_in_steps(frustum, spheres, visible, 8, cull_avx2);
+}
+#endif
+
+std::size_t cull_spheres(const Frustum &frustum, const SphereSet &spheres, std::vector<std::uint32_t> &visible) {
+#if defined(ENGINE_CULLING_X86)
+	switch (simd_width()) {
+		case 8:
+			return cull_spheres_avx2(frustum, spheres, visible);
+		case 4:
+			return cull_spheres_sse41(frustum, spheres, visible);
+		default:
+			return cull_spheres_scalar(frustum, spheres, visible);
+	}
+#else
+	auto n = spheres.size();
+	visible.resize(n);
+	auto out = visible.data();
+	std::size_t count{0};
+	std::size_t i{0};
+#if defined(__ARM_NEON)
+	const uint32_t lane_bits[4] = {1, 2, 4, 8};
+	auto bits = vld1q_u32(lane_bits);
+	for (; i + 4 <= n; i += 4) {
+		auto x = vld1q_f32(&spheres.x[i]);
+		auto y = vld1q_f32(&spheres.y[i]);
+		auto z = vld1q_f32(&spheres.z[i]);
+		auto neg_r = vnegq_f32(vld1q_f32(&spheres.radius[i]));
+		auto inside = vdupq_n_u32(0xffffffff);
+		for (const auto &plane: frustum.planes) {
+			// same summation order and NaN handling as the x86 kernels
+			auto d = vmlaq_n_f32(vmulq_n_f32(x, plane.x), y, plane.y);
+			d = vmlaq_n_f32(d, z, plane.z);
+			d = vaddq_f32(d, vdupq_n_f32(plane.w));
+			inside = vandq_u32(inside, vmvnq_u32(vcltq_f32(d, neg_r)));
+		}
+		count += compact(vaddvq_u32(vandq_u32(inside, bits)), i, out + count);
+	}
+#endif
+	count += cull_range(frustum, spheres, i, out + count);
+	visible.resize(count);
+	return count;
+#endif
+}
+
+} // namespace engine::render
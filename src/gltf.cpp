@@ -0,0 +1,659 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/gltf.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <engine/parallel.h>
+#include <engine/profiler.h>
+#include <engine/render/buffer_objects.h>
+#include <engine/render/instance_containers.h>
+#include <engine/render/Mesh.h>
+#include <engine/render/renderer.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <iostream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <utility>
+
+
+namespace engine::render {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using nlohmann::json;
+
+constexpr std::uint32_t GLB_MAGIC{0x46546C67}; // "glTF"
+constexpr std::uint32_t GLB_JSON_CHUNK{0x4E4F534A};
+constexpr std::uint32_t GLB_BIN_CHUNK{0x004E4942};
+constexpr int TRIANGLES{4};
+
+// the json pieces decoding needs, pulled out up front so the workers never touch the json tree
+struct BufferView {
+	std::size_t buffer;
+	std::size_t offset;
+	std::size_t length;
+	// 0 when tightly packed
+	std::size_t stride;
+};
+
+struct Accessor {
+	// -1 reads as all zeros
+	int view;
+	std::size_t offset;
+	int component_type;
+	bool normalized;
+	std::size_t count;
+	int components;
+	// substitutions aren't applied, primitives reading a sparse accessor are skipped
+	bool sparse;
+};
+
+struct PrimitiveJob {
+	std::size_t mesh;
+	std::size_t primitive;
+	int positions;
+	int colors;
+	int uvs;
+	int indices;
+	int material;
+};
+
+std::vector<unsigned char> read_file(const std::filesystem::path &path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		throw std::runtime_error("could not open '" + path.string() + "'");
+	std::vector<unsigned char> contents(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+	if (!file)
+		throw std::runtime_error("could not read '" + path.string() + "'");
+	return contents;
+}
+
+std::vector<unsigned char> decode_base64(const std::string &text, std::size_t first) {
+	static const auto table = [] {
+		std::array<int, 256> values{};
+		values.fill(-1);
+		const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (int i = 0; i < 64; ++i)
+			values[static_cast<unsigned char>(alphabet[i])] = i;
+		return values;
+	}();
+	std::vector<unsigned char> bytes;
+	bytes.reserve((text.size() - first) * 3 / 4);
+	std::uint32_t bits{0};
+	int count{0};
+	for (auto i = first; i < text.size(); ++i) {
+		auto value = table[static_cast<unsigned char>(text[i])];
+		if (value < 0)
+			continue; // padding and whitespace
+		bits = (bits << 6) | static_cast<std::uint32_t>(value);
+		count += 6;
+		if (count >= 8) {
+			count -= 8;
+			bytes.push_back(static_cast<unsigned char>((bits >> count) & 0xff));
+		}
+	}
+	return bytes;
+}
+
+bool is_data_uri(const std::string &uri) {
+	return uri.rfind("data:", 0) == 0;
+}
+
+std::vector<unsigned char> decode_data_uri(const std::string &uri) {
+	auto comma = uri.find(',');
+	if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+		throw std::runtime_error("only base64 data uris are supported");
+	return decode_base64(uri, comma + 1);
+}
+
+// relative uris are percent encoded
+std::filesystem::path resolve_uri(const std::filesystem::path &directory, const std::string &uri) {
+	std::string decoded;
+	for (std::size_t i = 0; i < uri.size(); ++i) {
+		if (uri[i] == '%' && i + 2 < uri.size()) {
+			decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+			i += 2;
+		} else
+			decoded.push_back(uri[i]);
+	}
+	return directory / decoded;
+}
+
+std::uint32_t read_u32(const std::vector<unsigned char> &data, std::size_t offset) {
+	std::uint32_t value;
+	std::memcpy(&value, data.data() + offset, sizeof(value));
+	return value;
+}
+
+// split a .glb into its JSON text and binary chunk
+void split_glb(const std::vector<unsigned char> &file, std::string &text, std::vector<unsigned char> &binary) {
+	if (file.size() < 20 || read_u32(file, 4) != 2)
+		throw std::runtime_error("unsupported glb version");
+	std::size_t offset{12};
+	auto end = std::min<std::size_t>(read_u32(file, 8), file.size());
+	while (offset + 8 <= end) {
+		auto length = read_u32(file, offset);
+		auto type = read_u32(file, offset + 4);
+		offset += 8;
+		if (length > end - offset)
+			throw std::runtime_error("truncated glb chunk");
+		if (type == GLB_JSON_CHUNK)
+			text.assign(reinterpret_cast<const char*>(file.data() + offset), length);
+		else if (type == GLB_BIN_CHUNK && binary.empty())
+			binary.assign(file.begin() + static_cast<std::ptrdiff_t>(offset),
+			              file.begin() + static_cast<std::ptrdiff_t>(offset + length));
+		offset += length;
+	}
+	if (text.empty())
+		throw std::runtime_error("glb without a JSON chunk");
+}
+
+int component_count(const std::string &type) {
+	if (type == "SCALAR")
+		return 1;
+	if (type == "VEC2")
+		return 2;
+	if (type == "VEC3")
+		return 3;
+	if (type == "VEC4" || type == "MAT2")
+		return 4;
+	if (type == "MAT3")
+		return 9;
+	if (type == "MAT4")
+		return 16;
+	throw std::runtime_error("unknown accessor type " + type);
+}
+
+std::size_t component_size(int component_type) {
+	switch (component_type) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			throw std::runtime_error("unknown accessor component type");
+	}
+}
+
+// normalized integers map to [0, 1] or [-1, 1] as the spec defines
+float read_component(const unsigned char *data, int component_type, bool normalized) {
+	switch (component_type) {
+		case GL_FLOAT: {
+			float value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		case GL_UNSIGNED_BYTE:
+			return normalized ? *data / 255.f : *data;
+		case GL_BYTE: {
+			auto value = static_cast<float>(static_cast<std::int8_t>(*data));
+			return normalized ? std::max(value / 127.f, -1.f) : value;
+		}
+		case GL_UNSIGNED_SHORT: {
+			std::uint16_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return normalized ? value / 65535.f : value;
+		}
+		case GL_SHORT: {
+			std::int16_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return normalized ? std::max(value / 32767.f, -1.f) : value;
+		}
+		default: {
+			std::uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return static_cast<float>(value);
+		}
+	}
+}
+
+class Decoder {
+public:
+	Decoder(const std::vector<BufferView> &views, const std::vector<std::vector<unsigned char>> &buffers)
+			: m_views(views), m_buffers(buffers) {}
+
+	// first N components of every element of accessor, missing ones are zero
+	template <int N>
+	std::vector<glm::vec<N, float>> read_vectors(const Accessor &accessor) const {
+		std::vector<glm::vec<N, float>> values(accessor.count, glm::vec<N, float>(0.f));
+		if (accessor.view < 0)
+			return values;
+		auto [data, stride] = locate(accessor);
+		auto size = component_size(accessor.component_type);
+		auto components = std::min(N, accessor.components);
+		for (std::size_t i = 0; i < accessor.count; ++i)
+			for (int c = 0; c < components; ++c)
+				values[i][c] = read_component(data + i * stride + c * size, accessor.component_type,
+				                              accessor.normalized);
+		return values;
+	}
+
+	std::vector<unsigned int> read_indices(const Accessor &accessor, std::size_t vertex_count) const {
+		std::vector<unsigned int> indices(accessor.count, 0);
+		if (accessor.view < 0)
+			return indices;
+		auto [data, stride] = locate(accessor);
+		for (std::size_t i = 0; i < accessor.count; ++i) {
+			auto element = data + i * stride;
+			switch (accessor.component_type) {
+				case GL_UNSIGNED_BYTE:
+					indices[i] = *element;
+					break;
+				case GL_UNSIGNED_SHORT: {
+					std::uint16_t value;
+					std::memcpy(&value, element, sizeof(value));
+					indices[i] = value;
+					break;
+				}
+				case GL_UNSIGNED_INT:
+					std::memcpy(&indices[i], element, sizeof(unsigned int));
+					break;
+				default:
+					throw std::runtime_error("invalid index component type");
+			}
+			if (indices[i] >= vertex_count)
+				throw std::runtime_error("index out of range");
+		}
+		return indices;
+	}
+
+private:
+	const std::vector<BufferView> &m_views;
+	const std::vector<std::vector<unsigned char>> &m_buffers;
+
+	// start of the accessor's first element and the distance between elements, bounds checked
+	std::pair<const unsigned char*, std::size_t> locate(const Accessor &accessor) const {
+		if (static_cast<std::size_t>(accessor.view) >= m_views.size())
+			throw std::runtime_error("accessor references a missing buffer view");
+		const auto &view = m_views[accessor.view];
+		if (view.buffer >= m_buffers.size())
+			throw std::runtime_error("buffer view references a missing buffer");
+		const auto &buffer = m_buffers[view.buffer];
+		auto element = component_size(accessor.component_type) * accessor.components;
+		auto stride = view.stride ? view.stride : element;
+		auto needed = accessor.count ? accessor.offset + (accessor.count - 1) * stride + element : 0;
+		if (needed > view.length || view.offset + view.length > buffer.size())
+			throw std::runtime_error("accessor reads past the end of its buffer");
+		return {buffer.data() + view.offset + accessor.offset, stride};
+	}
+};
+
+glm::mat4 node_transform(const json &node) {
+	if (node.contains("matrix")) {
+		const auto &values = node.at("matrix");
+		glm::mat4 matrix(1.f);
+		for (int column = 0; column < 4; ++column)
+			for (int row = 0; row < 4; ++row)
+				matrix[column][row] = values.at(column * 4 + row).get<float>();
+		return matrix;
+	}
+	glm::mat4 transform(1.f);
+	if (node.contains("translation")) {
+		const auto &t = node.at("translation");
+		transform = glm::translate(transform, glm::vec3(t.at(0).get<float>(), t.at(1).get<float>(),
+		                                                t.at(2).get<float>()));
+	}
+	if (node.contains("rotation")) {
+		const auto &r = node.at("rotation");
+		// stored x, y, z, w
+		transform = transform * glm::mat4_cast(glm::quat(r.at(3).get<float>(), r.at(0).get<float>(),
+		                                                 r.at(1).get<float>(), r.at(2).get<float>()));
+	}
+	if (node.contains("scale")) {
+		const auto &s = node.at("scale");
+		transform = glm::scale(transform, glm::vec3(s.at(0).get<float>(), s.at(1).get<float>(),
+		                                            s.at(2).get<float>()));
+	}
+	return transform;
+}
+
+std::vector<std::vector<unsigned char>> load_buffers(const json &gltf, const std::filesystem::path &directory,
+                                                     std::vector<unsigned char> &binary) {
+	if (!gltf.contains("buffers"))
+		return {};
+	const auto &descriptions = gltf.at("buffers");
+	std::vector<std::vector<unsigned char>> buffers(descriptions.size());
+	// files and base64 both take long enough to be worth spreading out
+	parallel_for(buffers.size(), [&](std::size_t first, std::size_t last) {
+		for (auto i = first; i < last; ++i) {
+			const auto &description = descriptions.at(i);
+			if (!description.contains("uri")) {
+				// only the first buffer of a glb may omit it, and then refers to the binary chunk
+				if (i != 0)
+					throw std::runtime_error("buffer without uri");
+				buffers[i] = std::move(binary);
+				continue;
+			}
+			auto uri = description.at("uri").get<std::string>();
+			buffers[i] = is_data_uri(uri) ? decode_data_uri(uri) : read_file(resolve_uri(directory, uri));
+		}
+	});
+	return buffers;
+}
+
+// meshes referenced from the nodes under the scene's roots get those nodes' world transforms
+void instantiate(const json &gltf, int scene, GltfScene &result) {
+	if (!gltf.contains("nodes"))
+		return;
+	const auto &nodes = gltf.at("nodes");
+	std::vector<std::size_t> roots;
+	if (scene < 0 && gltf.contains("scene"))
+		scene = gltf.at("scene").get<int>();
+	if (gltf.contains("scenes") && !gltf.at("scenes").empty()) {
+		const auto &scenes = gltf.at("scenes");
+		const auto &chosen = scenes.at(static_cast<std::size_t>(std::max(scene, 0)));
+		if (chosen.contains("nodes"))
+			for (const auto &node: chosen.at("nodes"))
+				roots.push_back(node.get<std::size_t>());
+	} else {
+		// no scenes: every node that isn't somebody's child is a root
+		std::vector<bool> child(nodes.size(), false);
+		for (const auto &node: nodes)
+			if (node.contains("children"))
+				for (const auto &index: node.at("children"))
+					child.at(index.get<std::size_t>()) = true;
+		for (std::size_t i = 0; i < nodes.size(); ++i)
+			if (!child[i])
+				roots.push_back(i);
+	}
+
+	std::vector<std::pair<std::size_t, glm::mat4>> stack;
+	for (auto root: roots)
+		stack.emplace_back(root, glm::mat4(1.f));
+	// a valid file is a forest, this only stops a malformed one from looping forever
+	std::size_t visits{0};
+	while (!stack.empty()) {
+		auto [index, parent] = stack.back();
+		stack.pop_back();
+		if (++visits > nodes.size() * 4 + 16)
+			throw std::runtime_error("node hierarchy contains a cycle");
+		const auto &node = nodes.at(index);
+		auto world = parent * node_transform(node);
+		if (node.contains("mesh")) {
+			auto mesh = node.at("mesh").get<std::size_t>();
+			result.meshes.at(mesh).instances.push_back(world);
+			++result.stats.instances;
+		}
+		if (node.contains("children"))
+			for (const auto &child: node.at("children"))
+				stack.emplace_back(child.get<std::size_t>(), world);
+	}
+}
+
+void load(const std::filesystem::path &path, GltfScene &scene, const GltfImportOptions &options) {
+	ENGINE_PROFILE_ZONE("gltf::load");
+	auto start = Clock::now();
+	auto file = read_file(path);
+	std::string text;
+	std::vector<unsigned char> binary;
+	if (file.size() >= 12 && read_u32(file, 0) == GLB_MAGIC)
+		split_glb(file, text, binary);
+	else
+		text.assign(file.begin(), file.end());
+	file = {};
+	auto read_time = Clock::now() - start;
+
+	start = Clock::now();
+	auto gltf = json::parse(text);
+	text = {};
+	std::vector<BufferView> views;
+	if (gltf.contains("bufferViews"))
+		for (const auto &view: gltf.at("bufferViews"))
+			views.push_back({view.at("buffer").get<std::size_t>(),
+			                 view.value("byteOffset", std::size_t{0}),
+			                 view.at("byteLength").get<std::size_t>(),
+			                 view.value("byteStride", std::size_t{0})});
+	std::vector<Accessor> accessors;
+	if (gltf.contains("accessors"))
+		for (const auto &accessor: gltf.at("accessors"))
+			accessors.push_back({accessor.value("bufferView", -1),
+			                     accessor.value("byteOffset", std::size_t{0}),
+			                     accessor.at("componentType").get<int>(),
+			                     accessor.value("normalized", false),
+			                     accessor.at("count").get<std::size_t>(),
+			                     component_count(accessor.at("type").get<std::string>()),
+			                     accessor.contains("sparse")});
+	// images embedded through a buffer view (as in a .glb) are copied out once the buffers are loaded
+	std::vector<std::pair<std::size_t, std::size_t>> embedded_images;
+	if (gltf.contains("images"))
+		for (const auto &image: gltf.at("images")) {
+			GltfImage decoded;
+			decoded.mime_type = image.value("mimeType", std::string());
+			if (image.contains("uri")) {
+				auto uri = image.at("uri").get<std::string>();
+				if (is_data_uri(uri))
+					decoded.encoded = decode_data_uri(uri);
+				else
+					decoded.path = resolve_uri(path.parent_path(), uri);
+			} else if (image.contains("bufferView"))
+				embedded_images.emplace_back(scene.images.size(), image.at("bufferView").get<std::size_t>());
+			scene.images.push_back(std::move(decoded));
+		}
+	if (gltf.contains("materials"))
+		for (const auto &material: gltf.at("materials")) {
+			GltfMaterial decoded;
+			if (material.contains("pbrMetallicRoughness")) {
+				const auto &pbr = material.at("pbrMetallicRoughness");
+				if (pbr.contains("baseColorFactor")) {
+					const auto &factor = pbr.at("baseColorFactor");
+					decoded.base_color = glm::vec4(factor.at(0).get<float>(), factor.at(1).get<float>(),
+					                               factor.at(2).get<float>(), factor.at(3).get<float>());
+				}
+				if (pbr.contains("baseColorTexture")) {
+					auto texture = pbr.at("baseColorTexture").at("index").get<std::size_t>();
+					const auto &description = gltf.at("textures").at(texture);
+					if (description.contains("source"))
+						decoded.image = description.at("source").get<int>();
+				}
+			}
+			scene.materials.push_back(decoded);
+		}
+	auto is_sparse = [&](int index) {
+		return index >= 0 && static_cast<std::size_t>(index) < accessors.size() && accessors[index].sparse;
+	};
+	std::vector<PrimitiveJob> jobs;
+	bool skipped{false}, skipped_sparse{false};
+	if (gltf.contains("meshes")) {
+		const auto &meshes = gltf.at("meshes");
+		scene.meshes.resize(meshes.size());
+		for (std::size_t m = 0; m < meshes.size(); ++m) {
+			const auto &mesh = meshes.at(m);
+			scene.meshes[m].name = mesh.value("name", std::string());
+			for (const auto &primitive: mesh.at("primitives")) {
+				const auto &attributes = primitive.at("attributes");
+				if (primitive.value("mode", TRIANGLES) != TRIANGLES || !attributes.contains("POSITION")) {
+					skipped = true;
+					continue;
+				}
+				PrimitiveJob job{m,
+				                 scene.meshes[m].primitives.size(),
+				                 attributes.at("POSITION").get<int>(),
+				                 attributes.value("COLOR_0", -1),
+				                 attributes.value("TEXCOORD_0", -1),
+				                 primitive.value("indices", -1),
+				                 primitive.value("material", -1)};
+				// decoding only the dense base values would give the wrong geometry
+				if (is_sparse(job.positions) || is_sparse(job.colors) || is_sparse(job.uvs) || is_sparse(job.indices)) {
+					skipped_sparse = true;
+					continue;
+				}
+				jobs.push_back(job);
+				scene.meshes[m].primitives.emplace_back();
+			}
+		}
+	}
+	if (skipped)
+		std::cerr << "glTF '" << path.string() << "': skipped primitives that aren't triangle lists" << std::endl;
+	if (skipped_sparse)
+		std::cerr << "glTF '" << path.string() << "': skipped primitives with sparse accessors" << std::endl;
+	auto parse_time = Clock::now() - start;
+
+	start = Clock::now();
+	auto buffers = load_buffers(gltf, path.parent_path(), binary);
+	for (const auto &[image, index]: embedded_images) {
+		if (index >= views.size())
+			throw std::runtime_error("image references a missing buffer view");
+		const auto &view = views[index];
+		if (view.buffer >= buffers.size() || view.offset + view.length > buffers[view.buffer].size())
+			throw std::runtime_error("image reads past the end of its buffer");
+		auto data = buffers[view.buffer].begin() + static_cast<std::ptrdiff_t>(view.offset);
+		scene.images[image].encoded.assign(data, data + static_cast<std::ptrdiff_t>(view.length));
+	}
+	read_time += Clock::now() - start;
+
+	start = Clock::now();
+	Decoder decoder(views, buffers);
+	auto accessor = [&](int index) -> const Accessor& {
+		if (index < 0 || static_cast<std::size_t>(index) >= accessors.size())
+			throw std::runtime_error("missing accessor");
+		return accessors[index];
+	};
+	parallel_for(jobs.size(), [&](std::size_t first, std::size_t last) {
+		ENGINE_PROFILE_ZONE("gltf::decode");
+		for (auto j = first; j < last; ++j) {
+			const auto &job = jobs[j];
+			auto &primitive = scene.meshes[job.mesh].primitives[job.primitive];
+			primitive.material = job.material;
+			primitive.positions = decoder.read_vectors<3>(accessor(job.positions));
+			auto count = primitive.positions.size();
+			// the base color factor multiplies COLOR_0 when there is one, as glTF defines it
+			auto material = job.material >= 0 ? scene.materials.at(job.material) : GltfMaterial{};
+			auto base_color = glm::vec3(material.base_color);
+			if (job.colors >= 0) {
+				primitive.colors = decoder.read_vectors<3>(accessor(job.colors));
+				for (auto &color: primitive.colors)
+					color *= base_color;
+			} else
+				primitive.colors.assign(count, base_color);
+			if (job.uvs >= 0)
+				primitive.uvs = decoder.read_vectors<2>(accessor(job.uvs));
+			else
+				primitive.uvs.assign(count, glm::vec2(0.f));
+			if (primitive.colors.size() != count || primitive.uvs.size() != count)
+				throw std::runtime_error("vertex attributes of a primitive differ in length");
+			if (job.indices >= 0)
+				primitive.indices = decoder.read_indices(accessor(job.indices), count);
+			else {
+				primitive.indices.resize(count);
+				for (std::size_t i = 0; i < count; ++i)
+					primitive.indices[i] = static_cast<unsigned int>(i);
+			}
+		}
+	});
+	auto decode_time = Clock::now() - start;
+
+	start = Clock::now();
+	instantiate(gltf, options.scene, scene);
+	scene.stats.read = read_time;
+	scene.stats.parse = parse_time;
+	scene.stats.decode = decode_time;
+	scene.stats.scene = Clock::now() - start;
+	scene.stats.primitives = jobs.size();
+	scene.stats.images = scene.images.size();
+}
+
+} // anonymous
+
+bool load_gltf(const std::filesystem::path &path, GltfScene &scene, const GltfImportOptions &options) {
+	auto start = Clock::now();
+	scene = {};
+	try {
+		load(path, scene, options);
+	} catch (const std::exception &error) {
+		std::cerr << "Could not load glTF '" << path.string() << "': " << error.what() << std::endl;
+		scene = {};
+		return false;
+	}
+	scene.stats.total = Clock::now() - start;
+	return true;
+}
+
+bool import_gltf(const std::filesystem::path &path, GltfImport &result, const GltfImportOptions &options) {
+	ENGINE_PROFILE_ZONE("gltf::import");
+	auto start = Clock::now();
+	GltfScene scene;
+	if (!load_gltf(path, scene, options))
+		return false;
+
+	auto upload_start = Clock::now();
+	auto &registry = get_registry();
+	// one texture per image however many materials share it
+	std::vector<GLuint> textures(scene.images.size(), 0);
+	auto texture_for = [&](int material) -> GLuint {
+		if (!options.load_images || material < 0)
+			return 0;
+		auto image = scene.materials.at(material).image;
+		if (image < 0 || static_cast<std::size_t>(image) >= scene.images.size())
+			return 0;
+		auto &source = scene.images[image];
+		if (textures[image] == 0) {
+			if (!source.encoded.empty())
+				textures[image] = load_texture_async(std::move(source.encoded),
+				                                     fmt::format("{} image {}", path.string(), image));
+			else if (!source.path.empty())
+				textures[image] = load_texture_async(source.path.string());
+		}
+		return textures[image];
+	};
+	result.entities.clear();
+	for (auto &mesh: scene.meshes) {
+		if (mesh.instances.empty())
+			continue;
+		for (auto &primitive: mesh.primitives) {
+			if (primitive.indices.empty())
+				continue;
+			auto entity = registry.create();
+			auto texture = texture_for(primitive.material);
+			registry.emplace<Mesh<>>(entity,
+			                         std::make_shared<ArrayBuffer<glm::vec3>>(std::move(primitive.positions)),
+			                         std::make_shared<ArrayBuffer<glm::vec3>>(std::move(primitive.colors)),
+			                         std::make_shared<ArrayBuffer<glm::vec2>>(std::move(primitive.uvs)),
+			                         std::make_shared<ElementBuffer>(std::move(primitive.indices)));
+			*registry.get<Mesh<>>(entity).get_texture() = texture;
+			registry.patch<Mat4Instances>(entity, [&](Mat4Instances &instances) {
+				instances.set_data(mesh.instances);
+			});
+			result.entities.push_back(entity);
+		}
+	}
+	result.stats = scene.stats;
+	result.stats.upload = Clock::now() - upload_start;
+	result.stats.total = Clock::now() - start;
+	return true;
+}
+
+} // namespace engine::render
@@ -0,0 +1,180 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/instance_formats.h>
+
+#include <cstring>
+#include <engine/render/glm_attributes.h>
+
+
+namespace engine::render {
+
+namespace {
+
+// same expansion as rigid_model in INSTANCE_FORMAT_GLSL
+glm::mat4 rigid_matrix(const glm::vec4 &position_scale, const glm::vec4 &q) {
+	auto s = position_scale.w;
+	glm::mat4 result(1.f);
+	result[0] = glm::vec4(1.f - 2.f * (q.y * q.y + q.z * q.z),
+	                      2.f * (q.x * q.y + q.w * q.z),
+	                      2.f * (q.x * q.z - q.w * q.y),
+	                      0.f) * s;
+	result[1] = glm::vec4(2.f * (q.x * q.y - q.w * q.z),
+	                      1.f - 2.f * (q.x * q.x + q.z * q.z),
+	                      2.f * (q.y * q.z + q.w * q.x),
+	                      0.f) * s;
+	result[2] = glm::vec4(2.f * (q.x * q.z + q.w * q.y),
+	                      2.f * (q.y * q.z - q.w * q.x),
+	                      1.f - 2.f * (q.x * q.x + q.y * q.y),
+	                      0.f) * s;
+	result[3] = glm::vec4(position_scale.x, position_scale.y, position_scale.z, 1.f);
+	return result;
+}
+
+glm::mat4 affine_matrix(const glm::vec4 &row0, const glm::vec4 &row1, const glm::vec4 &row2) {
+	glm::mat4 result(1.f);
+	for (int column = 0; column < 4; ++column)
+		result[column] = glm::vec4(row0[column], row1[column], row2[column], column == 3 ? 1.f : 0.f);
+	return result;
+}
+
+template <typename Instance>
+void pack(const glm::mat4 *transforms, std::size_t count, std::vector<std::uint8_t> &out) {
+	out.resize(count * sizeof(Instance));
+	for (std::size_t i = 0; i < count; ++i) {
+		Instance instance(transforms[i]);
+		std::memcpy(out.data() + i * sizeof(Instance), &instance, sizeof(Instance));
+	}
+}
+
+} // anonymous
+
+AffineInstance::AffineInstance(const glm::mat4 &transform)
+		: row0(transform[0][0], transform[1][0], transform[2][0], transform[3][0]),
+		  row1(transform[0][1], transform[1][1], transform[2][1], transform[3][1]),
+		  row2(transform[0][2], transform[1][2], transform[2][2], transform[3][2]) {}
+
+glm::mat4 AffineInstance::to_mat4() const {
+	return affine_matrix(row0, row1, row2);
+}
+
+RigidInstance::RigidInstance(const glm::vec3 &position, const glm::quat &rotation, float scale)
+		: position_scale(position, scale), rotation(rotation.x, rotation.y, rotation.z, rotation.w) {}
+
+RigidInstance::RigidInstance(const glm::mat4 &transform) {
+	glm::vec3 x(transform[0]), y(transform[1]), z(transform[2]);
+	auto scale = glm::length(x);
+	if (glm::dot(glm::cross(x, y), z) < 0.f)
+		scale = -scale;
+	position_scale = glm::vec4(glm::vec3(transform[3]), scale);
+	if (scale == 0.f)
+		return;
+	auto q = glm::normalize(glm::quat_cast(glm::mat3(x / scale, y / scale, z / scale)));
+	rotation = glm::vec4(q.x, q.y, q.z, q.w);
+}
+
+glm::mat4 RigidInstance::to_mat4() const {
+	return rigid_matrix(position_scale, rotation);
+}
+
+HalfRigidInstance::HalfRigidInstance(const RigidInstance &rigid)
+		: position_scale(rigid.position_scale), rotation(rigid.rotation) {}
+
+glm::mat4 HalfRigidInstance::to_mat4() const {
+	return rigid_matrix(position_scale, rotation.unpack());
+}
+
+HalfAffineInstance::HalfAffineInstance(const glm::mat4 &transform) {
+	AffineInstance affine(transform);
+	row0 = Half4(affine.row0);
+	row1 = Half4(affine.row1);
+	row2 = Half4(affine.row2);
+}
+
+glm::mat4 HalfAffineInstance::to_mat4() const {
+	return affine_matrix(row0.unpack(), row1.unpack(), row2.unpack());
+}
+
+std::size_t instance_size(InstanceFormat format) {
+	switch (format) {
+		case InstanceFormat::affine:
+			return sizeof(AffineInstance);
+		case InstanceFormat::rigid:
+			return sizeof(RigidInstance);
+		case InstanceFormat::half_rigid:
+			return sizeof(HalfRigidInstance);
+		case InstanceFormat::half_affine:
+			return sizeof(HalfAffineInstance);
+		default:
+			return sizeof(glm::mat4);
+	}
+}
+
+void pack_instances(InstanceFormat format, const glm::mat4 *transforms, std::size_t count,
+                    std::vector<std::uint8_t> &out) {
+	switch (format) {
+		case InstanceFormat::affine:
+			pack<AffineInstance>(transforms, count, out);
+			break;
+		case InstanceFormat::rigid:
+			pack<RigidInstance>(transforms, count, out);
+			break;
+		case InstanceFormat::half_rigid:
+			pack<HalfRigidInstance>(transforms, count, out);
+			break;
+		case InstanceFormat::half_affine:
+			pack<HalfAffineInstance>(transforms, count, out);
+			break;
+		default:
+			out.resize(count * sizeof(glm::mat4));
+			if (count > 0)
+				std::memcpy(out.data(), transforms, out.size());
+	}
+}
+
+GLuint bind_instance_format(InstanceFormat format, GLuint first_location, GLintptr offset) {
+	GLuint next;
+	switch (format) {
+		case InstanceFormat::affine:
+			next = bind_vertex_layout<AffineInstance>(first_location, 1, offset);
+			break;
+		case InstanceFormat::rigid:
+			next = bind_vertex_layout<RigidInstance>(first_location, 1, offset);
+			break;
+		case InstanceFormat::half_rigid:
+			next = bind_vertex_layout<HalfRigidInstance>(first_location, 1, offset);
+			break;
+		case InstanceFormat::half_affine:
+			next = bind_vertex_layout<HalfAffineInstance>(first_location, 1, offset);
+			break;
+		default:
+			// same layout as Mat4Instances, one vec4 per matrix column
+			for (GLuint column = 0; column < 4; ++column)
+				Vec4Attribute(GL_FLOAT, false, sizeof(glm::mat4), (void*) (column * sizeof(glm::vec4)))
+						.bind(first_location + column, 1, offset);
+			next = first_location + 4;
+	}
+	// a VAO switched over from a wider format would otherwise keep fetching its last columns
+	for (auto location = next; location < first_location + 4; ++location)
+		glDisableVertexAttribArray(location);
+	return next;
+}
+
+} // namespace engine::render
@@ -21,6 +21,7 @@ SOFTWARE.
 #include <engine/event_handling.h>
 #include <engine/interface/interface.h>
 #include <engine/interface/EntityMap.h>
+#include <engine/profiler.h>
 #include <engine/state.h>
 #include <entt/entt.hpp>
 #include <map>
@@ -135,6 +136,7 @@ void focus(entt::entity entity) {
 }
 
 void tick(std::chrono::nanoseconds dt) {
+	ENGINE_PROFILE_ZONE("interface::tick");
 	auto view = s_registry.view<TickCallback>();
 	for(auto entity: view)
 		view.get<TickCallback>(entity)(dt);
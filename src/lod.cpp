@@ -0,0 +1,328 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/lod.h>
+
+#include <algorithm>
+#include <cmath>
+#include <engine/profiler.h>
+#include <numeric>
+
+
+namespace engine::render {
+
+namespace {
+
+// sum of squared distances to a set of planes as a symmetric 4x4 matrix (upper triangle), plus the total weight
+// so costs can be normalized back to a distance
+struct Quadric {
+	double a00{0}, a01{0}, a02{0}, a03{0};
+	double a11{0}, a12{0}, a13{0};
+	double a22{0}, a23{0};
+	double a33{0};
+	double weight{0};
+
+	void add_plane(const glm::dvec3 &n, double d, double w) {
+		a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+		a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+		a22 += w * n.z * n.z; a23 += w * n.z * d;
+		a33 += w * d * d;
+		weight += w;
+	}
+
+	Quadric &operator+=(const Quadric &other) {
+		a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+		a11 += other.a11; a12 += other.a12; a13 += other.a13;
+		a22 += other.a22; a23 += other.a23;
+		a33 += other.a33;
+		weight += other.weight;
+		return *this;
+	}
+
+	// mean squared distance of p to the planes
+	double evaluate(const glm::vec3 &p) const {
+		double x = p.x, y = p.y, z = p.z;
+		auto sum = a00 * x * x + a11 * y * y + a22 * z * z + a33
+		           + 2 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z);
+		return weight > 0 ? std::max(sum, 0.0) / weight : 0.0;
+	}
+};
+
+struct Collapse {
+	unsigned int from;
+	unsigned int to;
+	double cost;
+};
+
+// first vertex of each group sharing an exact position, and whether the group has more than one member
+void find_wedges(const std::vector<glm::vec3> &positions, std::vector<unsigned int> &wedge, std::vector<char> &seam) {
+	std::vector<unsigned int> order(positions.size());
+	std::iota(order.begin(), order.end(), 0u);
+	auto less = [&](unsigned int a, unsigned int b) {
+		const auto &p = positions[a];
+		const auto &q = positions[b];
+		return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+	};
+	std::sort(order.begin(), order.end(), less);
+	wedge.resize(positions.size());
+	seam.assign(positions.size(), 0);
+	std::size_t first{0};
+	while (first < order.size()) {
+		auto last = first + 1;
+		while (last < order.size() && positions[order[last]] == positions[order[first]])
+			++last;
+		for (auto i = first; i < last; ++i) {
+			wedge[order[i]] = order[first];
+			seam[order[i]] = last - first > 1;
+		}
+		first = last;
+	}
+}
+
+// vertices on an edge used by a single triangle, compared by position so seams don't count as borders
+void find_borders(const std::vector<unsigned int> &indices, const std::vector<unsigned int> &wedge,
+                  std::vector<char> &locked) {
+	std::vector<std::pair<unsigned int, unsigned int>> edges;
+	edges.reserve(indices.size());
+	for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+		for (int corner = 0; corner < 3; ++corner) {
+			auto a = wedge[indices[t + corner]];
+			auto b = wedge[indices[t + (corner + 1) % 3]];
+			edges.emplace_back(std::min(a, b), std::max(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::size_t first{0};
+	while (first < edges.size()) {
+		auto last = first + 1;
+		while (last < edges.size() && edges[last] == edges[first])
+			++last;
+		if (last - first == 1) {
+			locked[edges[first].first] = 1;
+			locked[edges[first].second] = 1;
+		}
+		first = last;
+	}
+}
+
+glm::vec3 face_normal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+	return glm::cross(b - a, c - a);
+}
+
+// would moving from onto to turn any of the triangles around from (that survive the collapse) over
+bool flips(const Collapse &collapse,
+           const std::vector<glm::vec3> &positions,
+           const std::vector<unsigned int> &indices,
+           const std::vector<unsigned int> &wedge,
+           const unsigned int *triangles,
+           std::size_t triangle_count) {
+	const auto &target = positions[collapse.to];
+	for (std::size_t i = 0; i < triangle_count; ++i) {
+		auto t = triangles[i] * 3;
+		glm::vec3 corners[3];
+		bool degenerate{false};
+		for (int corner = 0; corner < 3; ++corner) {
+			auto v = indices[t + corner];
+			degenerate = degenerate || wedge[v] == wedge[collapse.to];
+			corners[corner] = positions[v];
+		}
+		if (degenerate)
+			continue;
+		auto before = face_normal(corners[0], corners[1], corners[2]);
+		for (auto &corner: corners)
+			if (corner == positions[collapse.from])
+				corner = target;
+		auto after = face_normal(corners[0], corners[1], corners[2]);
+		if (glm::dot(before, after) <= 0.f)
+			return true;
+	}
+	return false;
+}
+
+} // anonymous
+
+std::vector<unsigned int> simplify(const std::vector<glm::vec3> &positions,
+                                   const std::vector<unsigned int> &indices,
+                                   std::size_t target_index_count,
+                                   float max_error,
+                                   float *result_error) {
+	ENGINE_PROFILE_ZONE("render::simplify");
+	auto vertex_count = positions.size();
+	std::vector<unsigned int> wedge;
+	std::vector<char> locked;
+	find_wedges(positions, wedge, locked);
+	find_borders(indices, wedge, locked);
+
+	std::vector<Quadric> quadrics(vertex_count);
+	for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+		glm::dvec3 a(positions[indices[t]]), b(positions[indices[t + 1]]), c(positions[indices[t + 2]]);
+		auto normal = glm::cross(b - a, c - a);
+		auto length = glm::length(normal);
+		if (length == 0)
+			continue;
+		normal /= length;
+		// weighted by area so large flat faces pin their vertices harder than slivers
+		auto area = 0.5 * length;
+		for (auto v: {indices[t], indices[t + 1], indices[t + 2]})
+			quadrics[wedge[v]].add_plane(normal, -glm::dot(normal, a), area);
+	}
+
+	auto current = indices;
+	current.resize(current.size() - current.size() % 3);
+	double max_cost = static_cast<double>(max_error) * max_error;
+	double error{0};
+	std::vector<Collapse> candidates;
+	std::vector<unsigned int> remap(vertex_count);
+	std::vector<char> touched(vertex_count);
+	std::vector<unsigned int> offsets(vertex_count + 1), adjacency;
+	while (current.size() > target_index_count) {
+		candidates.clear();
+		for (std::size_t t = 0; t < current.size(); t += 3) {
+			for (int corner = 0; corner < 3; ++corner) {
+				auto a = current[t + corner];
+				auto b = current[t + (corner + 1) % 3];
+				for (auto [from, to]: {std::pair{a, b}, std::pair{b, a}}) {
+					if (locked[from])
+						continue;
+					auto quadric = quadrics[wedge[from]];
+					quadric += quadrics[wedge[to]];
+					candidates.push_back({from, to, quadric.evaluate(positions[to])});
+				}
+			}
+		}
+		if (candidates.empty())
+			break;
+		std::sort(candidates.begin(), candidates.end(),
+		          [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+		// triangles around each vertex for the flip test
+		std::fill(offsets.begin(), offsets.end(), 0u);
+		for (auto v: current)
+			++offsets[v + 1];
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+		adjacency.resize(current.size());
+		{
+			auto fill = offsets;
+			for (std::size_t i = 0; i < current.size(); ++i)
+				adjacency[fill[current[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+
+		std::iota(remap.begin(), remap.end(), 0u);
+		std::fill(touched.begin(), touched.end(), 0);
+		auto triangles_to_remove = std::max<std::size_t>((current.size() - target_index_count) / 3, 1);
+		std::size_t removed{0}, collapses{0};
+		for (const auto &collapse: candidates) {
+			if (collapse.cost > max_cost)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+			auto around = &adjacency[offsets[collapse.from]];
+			auto around_count = offsets[collapse.from + 1] - offsets[collapse.from];
+			if (flips(collapse, positions, current, wedge, around, around_count))
+				continue;
+			// neighbours are frozen for the rest of the pass so the flip tests above stay valid
+			for (std::size_t i = 0; i < around_count; ++i) {
+				auto t = around[i] * 3;
+				bool shared{false};
+				for (int corner = 0; corner < 3; ++corner) {
+					touched[current[t + corner]] = 1;
+					shared = shared || current[t + corner] == collapse.to;
+				}
+				removed += shared;
+			}
+			remap[collapse.from] = collapse.to;
+			quadrics[wedge[collapse.to]] += quadrics[wedge[collapse.from]];
+			error = std::max(error, collapse.cost);
+			++collapses;
+			if (removed >= triangles_to_remove)
+				break;
+		}
+		if (collapses == 0)
+			break;
+
+		std::size_t write{0};
+		for (std::size_t t = 0; t < current.size(); t += 3) {
+			auto a = remap[current[t]], b = remap[current[t + 1]], c = remap[current[t + 2]];
+			if (wedge[a] == wedge[b] || wedge[b] == wedge[c] || wedge[a] == wedge[c])
+				continue;
+			current[write++] = a;
+			current[write++] = b;
+			current[write++] = c;
+		}
+		current.resize(write);
+	}
+	if (result_error != nullptr)
+		*result_error = static_cast<float>(std::sqrt(error));
+	return current;
+}
+
+LodChain build_lod_chain(const std::vector<glm::vec3> &positions,
+                         const std::vector<unsigned int> &indices,
+                         const LodSettings &settings) {
+	LodChain chain;
+	chain.indices = indices;
+	chain.levels.push_back({0, static_cast<GLuint>(indices.size()), 0.f, 0.f});
+	auto target = static_cast<double>(indices.size());
+	while (chain.levels.size() < settings.max_levels) {
+		target *= settings.reduction;
+		// always from the original so each level's error is measured against the full mesh
+		float error{0};
+		auto level = simplify(positions, indices, static_cast<std::size_t>(target), settings.max_error, &error);
+		const auto &previous = chain.levels.back();
+		// no point in a level that is barely smaller than the one before it
+		if (level.empty() || level.size() > previous.index_count * 0.95)
+			break;
+		chain.levels.push_back({static_cast<GLuint>(chain.indices.size()), static_cast<GLuint>(level.size()),
+		                        error, 0.f});
+		chain.indices.insert(chain.indices.end(), level.begin(), level.end());
+	}
+	// every level but the last needs a threshold, the last one is drawn at any size below the one before it
+	auto full = static_cast<float>(chain.levels.front().index_count);
+	for (std::size_t i = 0; i + 1 < chain.levels.size(); ++i)
+		chain.levels[i].min_screen_size = settings.full_detail_size * std::sqrt(chain.levels[i].index_count / full);
+	return chain;
+}
+
+std::size_t select_lod(const std::vector<LodLevel> &levels, float size) {
+	for (std::size_t i = 0; i < levels.size(); ++i)
+		if (size >= levels[i].min_screen_size)
+			return i;
+	return levels.empty() ? 0 : levels.size() - 1;
+}
+
+void bucket_instances(const std::vector<LodLevel> &levels,
+                      const SphereSet &spheres,
+                      const std::uint32_t *indices,
+                      std::size_t count,
+                      const glm::vec3 &eye,
+                      float tan_half_fovy,
+                      std::vector<std::vector<std::uint32_t>> &buckets) {
+	buckets.resize(std::max<std::size_t>(levels.size(), 1));
+	for (auto &bucket: buckets)
+		bucket.clear();
+	for (std::size_t i = 0; i < count; ++i) {
+		auto index = indices[i];
+		auto distance = glm::length(glm::vec3(spheres.x[index], spheres.y[index], spheres.z[index]) - eye);
+		auto size = screen_size(spheres.radius[index], distance, tan_half_fovy);
+		buckets[select_lod(levels, size)].push_back(index);
+	}
+}
+
+} // namespace engine::render
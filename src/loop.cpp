@@ -0,0 +1,123 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/loop.h>
+
+#include <algorithm>
+#include <array>
+#include <engine/interface/interface.h>
+#include <engine/profiler.h>
+#include <engine/render/renderer.h>
+#include <engine/state.h>
+#include <iostream>
+#include <vector>
+
+
+namespace engine {
+
+namespace { // pseudo-member namespace
+
+using steady_clock = std::chrono::steady_clock;
+
+std::array<std::chrono::nanoseconds, FrameStats::FRAME_HISTORY> s_frame_times{};
+FrameStats s_totals;
+
+void record_frame(std::chrono::nanoseconds frame_time, bool paused) {
+	s_frame_times[s_totals.frames % FrameStats::FRAME_HISTORY] = frame_time;
+	++s_totals.frames;
+	s_totals.elapsed += frame_time;
+	if (paused)
+		s_totals.paused += frame_time;
+}
+
+} // anonymous
+
+FrameStats run(const SimulationCallback &simulate, const RenderCallback &draw, const LoopConfig &config) {
+	// the step loop below would never finish
+	if (config.step.count() <= 0) {
+		std::cerr << "Loop step must be positive, got " << config.step.count() << "ns" << std::endl;
+		return {};
+	}
+	if (!state::has_started())
+		state::start();
+	s_totals = {};
+	std::chrono::nanoseconds accumulator{0};
+	auto previous = steady_clock::now();
+	bool first_frame{true};
+	while (!state::is_stopped()) {
+		auto now = steady_clock::now();
+		std::chrono::nanoseconds frame_time = now - previous;
+		previous = now;
+		state::poll();
+		auto paused = state::is_paused();
+		// the first frame is only timed from just above, its near zero would drag the stats down
+		if (!first_frame)
+			record_frame(frame_time, paused);
+		first_frame = false;
+		if (frame_time > config.max_frame_time) {
+			s_totals.dropped += frame_time - config.max_frame_time;
+			frame_time = config.max_frame_time;
+		}
+
+		if (paused)
+			++s_totals.paused_frames;
+		else {
+			ENGINE_PROFILE_ZONE("engine::simulate");
+			accumulator += frame_time;
+			while (accumulator >= config.step) {
+				interface::tick(config.step);
+				if (simulate)
+					simulate(config.step);
+				accumulator -= config.step;
+				++s_totals.steps;
+			}
+		}
+
+		auto alpha = static_cast<float>(static_cast<double>(accumulator.count()) / config.step.count());
+		render::clear_screen();
+		render::render(frame_time, alpha);
+		if (draw)
+			draw(alpha);
+		render::swap_buffers();
+	}
+	return get_frame_stats();
+}
+
+FrameStats get_frame_stats() {
+	auto stats = s_totals;
+	auto count = std::min(stats.frames, FrameStats::FRAME_HISTORY);
+	if (count == 0)
+		return stats;
+	std::vector<std::chrono::nanoseconds> times(s_frame_times.begin(), s_frame_times.begin() + count);
+	std::sort(times.begin(), times.end());
+	std::chrono::nanoseconds sum{0};
+	for (auto time: times)
+		sum += time;
+	stats.mean = sum / count;
+	stats.min = times.front();
+	stats.max = times.back();
+	auto percentile = [&](double p) { return times[static_cast<std::size_t>(p * (count - 1) + 0.5)]; };
+	stats.p50 = percentile(0.50);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	return stats;
+}
+
+} // namespace engine
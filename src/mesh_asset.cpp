@@ -0,0 +1,222 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/mesh_asset.h>
+
+#include <cerrno>
+#include <cstring>
+#include <engine/render/mesh_optimizer.h>
+#include <engine/render/RenderQueue.h>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace engine::render {
+
+namespace {
+
+static_assert(std::is_trivially_copyable_v<MeshAssetHeader> && sizeof(MeshAssetHeader) == 160,
+              "changing the header layout needs a MESH_ASSET_VERSION bump");
+static_assert(std::is_trivially_copyable_v<LodLevel> && sizeof(LodLevel) == 16);
+
+std::uint64_t align(std::uint64_t offset) {
+	return (offset + MESH_ASSET_ALIGNMENT - 1) / MESH_ASSET_ALIGNMENT * MESH_ASSET_ALIGNMENT;
+}
+
+bool section_fits(const MeshAssetSection &section, std::size_t file_size) {
+	if (section.size == 0)
+		return true;
+	return section.offset % MESH_ASSET_ALIGNMENT == 0 && section.offset <= file_size
+	       && section.size <= file_size - section.offset;
+}
+
+// why header doesn't describe a usable asset of file_size bytes, nullptr when it does
+const char *validate(const MeshAssetHeader &header, std::size_t file_size) {
+	if (std::memcmp(header.magic, MESH_ASSET_MAGIC, sizeof(MESH_ASSET_MAGIC)) != 0)
+		return "not a mesh asset";
+	if (header.version != MESH_ASSET_VERSION)
+		return "unsupported version";
+	if (header.index_type != GL_UNSIGNED_SHORT && header.index_type != GL_UNSIGNED_INT)
+		return "invalid index type";
+	for (const auto &section: {header.positions, header.colors, header.uvs, header.indices, header.lod_levels,
+	                           header.lod_indices})
+		if (!section_fits(section, file_size))
+			return "section out of bounds";
+	std::uint64_t vertices = header.vertex_count;
+	auto index_bytes = index_size(header.index_type);
+	if (header.positions.size != vertices * sizeof(glm::vec3) || header.colors.size != vertices * sizeof(glm::vec3)
+	    || header.uvs.size != vertices * sizeof(glm::vec2)
+	    || header.indices.size != std::uint64_t{header.index_count} * index_bytes
+	    || header.lod_levels.size != std::uint64_t{header.lod_count} * sizeof(LodLevel)
+	    || header.lod_indices.size % index_bytes != 0)
+		return "section sizes don't match the counts";
+	return nullptr;
+}
+
+template <typename T>
+void write_section(std::ofstream &file, MeshAssetSection &section, std::uint64_t &offset, const T *data,
+                   std::size_t count) {
+	static const char padding[MESH_ASSET_ALIGNMENT]{};
+	auto aligned = align(offset);
+	file.write(padding, static_cast<std::streamsize>(aligned - offset));
+	section.offset = aligned;
+	section.size = count * sizeof(T);
+	file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(section.size));
+	offset = aligned + section.size;
+}
+
+void write_indices(std::ofstream &file, MeshAssetSection &section, std::uint64_t &offset,
+                   const std::vector<unsigned int> &indices, GLenum index_type) {
+	if (index_type == GL_UNSIGNED_INT) {
+		write_section(file, section, offset, indices.data(), indices.size());
+		return;
+	}
+	std::vector<GLushort> narrowed(indices.begin(), indices.end());
+	write_section(file, section, offset, narrowed.data(), narrowed.size());
+}
+
+} // anonymous
+
+MeshAsset::Ptr MeshAsset::open(const std::filesystem::path &path) {
+	auto fail = [&](const std::string &reason) -> Ptr {
+		std::cerr << "Could not load mesh asset '" << path.string() << "': " << reason << std::endl;
+		return nullptr;
+	};
+	Ptr asset(new MeshAsset());
+#ifdef _WIN32
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return fail("could not open file");
+	asset->m_contents.resize(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(asset->m_contents.data()), asset->m_contents.size());
+	if (!file)
+		return fail("read failed");
+	asset->m_data = asset->m_contents.data();
+	asset->m_size = asset->m_contents.size();
+#else
+	auto descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return fail(std::strerror(errno));
+	struct stat status{};
+	if (fstat(descriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(MeshAssetHeader))) {
+		::close(descriptor);
+		return fail("file too small");
+	}
+	auto size = static_cast<std::size_t>(status.st_size);
+	auto address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	// the mapping keeps the file referenced on its own
+	::close(descriptor);
+	if (address == MAP_FAILED)
+		return fail(std::strerror(errno));
+	// everything is about to be read front to back by the upload
+	posix_madvise(address, size, POSIX_MADV_WILLNEED);
+	asset->m_data = static_cast<const std::uint8_t*>(address);
+	asset->m_size = size;
+#endif
+	if (asset->m_size < sizeof(MeshAssetHeader))
+		return fail("file too small");
+	if (auto error = validate(asset->get_header(), asset->m_size))
+		return fail(error);
+	// index values themselves aren't checked, that would touch every page up front
+	auto lod_index_count = asset->get_header().lod_indices.size / index_size(asset->get_header().index_type);
+	for (const auto &level: asset->get_lod_levels())
+		if (std::uint64_t{level.first_index} + level.index_count > lod_index_count)
+			return fail("LOD level out of bounds");
+	return asset;
+}
+
+MeshAsset::~MeshAsset() {
+#ifndef _WIN32
+	if (m_data != nullptr && m_contents.empty())
+		munmap(const_cast<std::uint8_t*>(m_data), m_size);
+#endif
+}
+
+bool write_mesh_asset(const std::filesystem::path &path,
+                      const std::vector<glm::vec3> &positions,
+                      const std::vector<glm::vec3> &colors,
+                      const std::vector<glm::vec2> &uvs,
+                      const std::vector<unsigned int> &indices,
+                      const LodChain *lods) {
+	MeshAssetHeader header{};
+	std::memcpy(header.magic, MESH_ASSET_MAGIC, sizeof(MESH_ASSET_MAGIC));
+	header.version = MESH_ASSET_VERSION;
+	header.vertex_count = static_cast<std::uint32_t>(positions.size());
+	header.index_count = static_cast<std::uint32_t>(indices.size());
+	header.index_type = smallest_index_type(positions.size());
+	header.lod_count = lods ? static_cast<std::uint32_t>(lods->levels.size()) : 0;
+	header.bounds = compute_bounds(positions);
+
+	// write next to the final name and rename so readers never map a half written file
+	auto temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			std::cerr << "Could not write mesh asset '" << temporary.string() << "'" << std::endl;
+			return false;
+		}
+		// header is rewritten once the section offsets are known
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		std::uint64_t offset{sizeof(header)};
+		write_section(file, header.positions, offset, positions.data(), positions.size());
+		if (colors.size() == positions.size())
+			write_section(file, header.colors, offset, colors.data(), colors.size());
+		else {
+			std::vector<glm::vec3> white(positions.size(), glm::vec3(1.f));
+			write_section(file, header.colors, offset, white.data(), white.size());
+		}
+		if (uvs.size() == positions.size())
+			write_section(file, header.uvs, offset, uvs.data(), uvs.size());
+		else {
+			std::vector<glm::vec2> zero(positions.size(), glm::vec2(0.f));
+			write_section(file, header.uvs, offset, zero.data(), zero.size());
+		}
+		write_indices(file, header.indices, offset, indices, header.index_type);
+		if (lods != nullptr) {
+			write_section(file, header.lod_levels, offset, lods->levels.data(), lods->levels.size());
+			write_indices(file, header.lod_indices, offset, lods->indices, header.index_type);
+		}
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!file) {
+			std::cerr << "Could not write mesh asset '" << temporary.string() << "'" << std::endl;
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::cerr << "Could not write mesh asset '" << path.string() << "': " << error.message() << std::endl;
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
+
+} // namespace engine::render
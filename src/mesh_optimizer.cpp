@@ -0,0 +1,275 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <engine/profiler.h>
+#include <numeric>
+
+
+namespace engine::render {
+
+namespace {
+
+// modelled LRU cache for scoring, larger than the FIFO ones analyzed so the order holds up across hardware
+constexpr std::size_t CACHE_SIZE{32};
+constexpr float CACHE_DECAY_POWER{1.5f};
+constexpr float LAST_TRIANGLE_SCORE{0.75f};
+constexpr float VALENCE_BOOST_SCALE{2.f};
+constexpr float VALENCE_BOOST_POWER{0.5f};
+
+float vertex_score(int cache_position, unsigned int remaining) {
+	if (remaining == 0)
+		return -1.f;
+	float score{0};
+	if (cache_position >= 0) {
+		// the three vertices of the last triangle get a fixed score so the next one isn't always a neighbour of it
+		if (cache_position < 3)
+			score = LAST_TRIANGLE_SCORE;
+		else {
+			auto scale = 1.f / (CACHE_SIZE - 3);
+			score = std::pow(1.f - (cache_position - 3) * scale, CACHE_DECAY_POWER);
+		}
+	}
+	// vertices with few triangles left get finished off before they fall out of the cache
+	return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+}
+
+} // anonymous
+
+VertexCacheStats analyze_vertex_cache(const std::vector<unsigned int> &indices, std::size_t vertex_count,
+                                      std::size_t cache_size) {
+	VertexCacheStats stats;
+	if (indices.empty())
+		return stats;
+	// FIFO, timestamps stand in for queue positions
+	std::vector<std::size_t> inserted(vertex_count, 0);
+	std::vector<char> referenced(vertex_count, 0);
+	std::size_t time{0}, misses{0}, unique{0};
+	for (auto v: indices) {
+		if (!referenced[v]) {
+			referenced[v] = 1;
+			++unique;
+		}
+		if (inserted[v] == 0 || time - inserted[v] >= cache_size) {
+			inserted[v] = ++time;
+			++misses;
+		}
+	}
+	stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / unique;
+	return stats;
+}
+
+void optimize_vertex_cache(std::vector<unsigned int> &indices, std::size_t vertex_count) {
+	optimize_vertex_cache(indices.data(), indices.size(), vertex_count);
+}
+
+void optimize_vertex_cache(unsigned int *indices, std::size_t count, std::size_t vertex_count) {
+	ENGINE_PROFILE_ZONE("render::optimize_vertex_cache");
+	auto triangle_count = count / 3;
+	if (triangle_count < 2)
+		return;
+
+	// triangles using each vertex
+	std::vector<unsigned int> offsets(vertex_count + 1, 0), remaining(vertex_count, 0);
+	for (std::size_t i = 0; i < triangle_count * 3; ++i)
+		++remaining[indices[i]];
+	for (std::size_t v = 0; v < vertex_count; ++v)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	std::vector<unsigned int> adjacency(triangle_count * 3);
+	{
+		auto fill = offsets;
+		for (std::size_t i = 0; i < triangle_count * 3; ++i)
+			adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> score(vertex_count);
+	for (std::size_t v = 0; v < vertex_count; ++v)
+		score[v] = vertex_score(-1, remaining[v]);
+	std::vector<float> triangle_score(triangle_count);
+	for (std::size_t t = 0; t < triangle_count; ++t)
+		triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+	std::vector<char> emitted(triangle_count, 0);
+
+	std::vector<unsigned int> output;
+	output.reserve(triangle_count * 3);
+	std::vector<unsigned int> cache, next_cache;
+	cache.reserve(CACHE_SIZE + 3);
+	next_cache.reserve(CACHE_SIZE + 3);
+	std::size_t cursor{0};
+	long best{-1};
+	while (output.size() < triangle_count * 3) {
+		if (best < 0) {
+			// nothing in the cache has triangles left, take the best remaining one overall
+			float best_score{-1};
+			for (auto t = cursor; t < triangle_count; ++t) {
+				if (!emitted[t] && triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best = static_cast<long>(t);
+				}
+			}
+			while (cursor < triangle_count && emitted[cursor])
+				++cursor;
+		}
+		auto triangle = static_cast<std::size_t>(best);
+		emitted[triangle] = 1;
+		const auto *corners = &indices[triangle * 3];
+		output.insert(output.end(), corners, corners + 3);
+
+		// emitted triangle's vertices go to the front, the rest shift back
+		next_cache.assign(corners, corners + 3);
+		for (auto v: cache)
+			if (v != corners[0] && v != corners[1] && v != corners[2])
+				next_cache.push_back(v);
+		for (int corner = 0; corner < 3; ++corner) {
+			auto v = corners[corner];
+			// drop the triangle from its vertices' remaining lists
+			auto first = adjacency.begin() + offsets[v];
+			auto last = first + remaining[v];
+			auto it = std::find(first, last, static_cast<unsigned int>(triangle));
+			std::iter_swap(it, last - 1);
+			--remaining[v];
+		}
+		for (std::size_t i = CACHE_SIZE; i < next_cache.size(); ++i)
+			cache_position[next_cache[i]] = -1;
+		if (next_cache.size() > CACHE_SIZE)
+			next_cache.resize(CACHE_SIZE);
+		std::swap(cache, next_cache);
+
+		// rescore what's in the cache and pick the best triangle touching it
+		for (std::size_t i = 0; i < cache.size(); ++i) {
+			cache_position[cache[i]] = static_cast<int>(i);
+			score[cache[i]] = vertex_score(static_cast<int>(i), remaining[cache[i]]);
+		}
+		// vertices that just fell out of the cache lose their position bonus
+		for (auto v: next_cache)
+			if (cache_position[v] < 0)
+				score[v] = vertex_score(-1, remaining[v]);
+		best = -1;
+		float best_score{-1};
+		for (auto v: cache) {
+			for (auto i = offsets[v]; i < offsets[v] + remaining[v]; ++i) {
+				auto t = adjacency[i];
+				auto updated = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+				triangle_score[t] = updated;
+				if (updated > best_score) {
+					best_score = updated;
+					best = t;
+				}
+			}
+		}
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+bool optimize_overdraw(std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions, float threshold) {
+	ENGINE_PROFILE_ZONE("render::optimize_overdraw");
+	auto triangle_count = indices.size() / 3;
+	if (triangle_count < 2)
+		return false;
+	auto vertex_count = positions.size();
+	auto acmr = analyze_vertex_cache(indices, vertex_count).acmr;
+
+	// split the cache optimized order where the simulated FIFO (nearly) restarts, i.e. a triangle misses on two or
+	// more vertices, keeping clusters big enough that reordering them doesn't undo the cache optimization
+	std::vector<std::size_t> clusters{0};
+	{
+		constexpr std::size_t fifo_size{16};
+		constexpr std::size_t min_cluster{32};
+		std::vector<std::size_t> inserted(vertex_count, 0);
+		std::size_t time{0};
+		for (std::size_t t = 0; t < triangle_count; ++t) {
+			int misses{0};
+			for (int corner = 0; corner < 3; ++corner) {
+				auto v = indices[t * 3 + corner];
+				if (inserted[v] == 0 || time - inserted[v] >= fifo_size) {
+					inserted[v] = ++time;
+					++misses;
+				}
+			}
+			if (misses >= 2 && t >= clusters.back() + min_cluster)
+				clusters.push_back(t);
+		}
+	}
+	if (clusters.size() < 2)
+		return false;
+
+	glm::vec3 center{0};
+	for (const auto &p: positions)
+		center += p;
+	center /= static_cast<float>(std::max<std::size_t>(vertex_count, 1));
+
+	// clusters facing away from the center are likely in front of the ones behind them from any direction
+	std::vector<float> sort_key(clusters.size());
+	for (std::size_t c = 0; c < clusters.size(); ++c) {
+		auto last = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+		glm::vec3 centroid{0}, normal{0};
+		float area{0};
+		for (auto t = clusters[c]; t < last; ++t) {
+			const auto &a = positions[indices[t * 3]];
+			const auto &b = positions[indices[t * 3 + 1]];
+			const auto &d = positions[indices[t * 3 + 2]];
+			auto cross = glm::cross(b - a, d - a);
+			auto triangle_area = glm::length(cross);
+			centroid += (a + b + d) * (triangle_area / 3.f);
+			normal += cross;
+			area += triangle_area;
+		}
+		if (area > 0)
+			centroid /= area;
+		auto length = glm::length(normal);
+		sort_key[c] = length > 0 ? glm::dot(centroid - center, normal / length) : 0.f;
+	}
+	std::vector<std::size_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), std::size_t{0});
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return sort_key[a] > sort_key[b]; });
+
+	std::vector<unsigned int> sorted;
+	sorted.reserve(indices.size());
+	for (auto c: order) {
+		auto last = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+		sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3, indices.begin() + last * 3);
+	}
+	if (analyze_vertex_cache(sorted, vertex_count).acmr > acmr * threshold)
+		return false;
+	indices.swap(sorted);
+	return true;
+}
+
+std::vector<unsigned int> optimize_vertex_fetch(std::vector<unsigned int> &indices, std::size_t vertex_count) {
+	constexpr auto unassigned = std::numeric_limits<unsigned int>::max();
+	std::vector<unsigned int> remap(vertex_count, unassigned);
+	unsigned int next{0};
+	for (auto &index: indices) {
+		if (remap[index] == unassigned)
+			remap[index] = next++;
+		index = remap[index];
+	}
+	for (auto &target: remap)
+		if (target == unassigned)
+			target = next++;
+	return remap;
+}
+
+} // namespace engine::render
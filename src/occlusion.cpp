@@ -0,0 +1,344 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/occlusion.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cute_png.h>
+#include <engine/parallel.h>
+#include <iostream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+namespace engine::render {
+
+namespace {
+
+constexpr int TILE_SIZE{8};
+
+// four floats per instruction where the target has them
+#if defined(__SSE2__)
+struct Float4 {
+	__m128 v;
+
+	static Float4 splat(float value) {
+		return {_mm_set1_ps(value)};
+	}
+
+	// value, value + 1, value + 2, value + 3
+	static Float4 ramp(float value) {
+		return {_mm_setr_ps(value, value + 1.f, value + 2.f, value + 3.f)};
+	}
+
+	Float4 operator+(const Float4 &other) const {
+		return {_mm_add_ps(v, other.v)};
+	}
+
+	Float4 operator*(const Float4 &other) const {
+		return {_mm_mul_ps(v, other.v)};
+	}
+};
+
+// lower depth[0, 4) to z where all three edge functions are non-negative
+inline void write_nearest(float *depth, Float4 e0, Float4 e1, Float4 e2, Float4 z) {
+	auto covered = _mm_cmpge_ps(_mm_min_ps(_mm_min_ps(e0.v, e1.v), e2.v), _mm_setzero_ps());
+	auto old = _mm_loadu_ps(depth);
+	auto nearest = _mm_min_ps(old, z.v);
+	_mm_storeu_ps(depth, _mm_or_ps(_mm_and_ps(covered, nearest), _mm_andnot_ps(covered, old)));
+}
+#elif defined(__ARM_NEON)
+struct Float4 {
+	float32x4_t v;
+
+	static Float4 splat(float value) {
+		return {vdupq_n_f32(value)};
+	}
+
+	static Float4 ramp(float value) {
+		const float offsets[4] = {0.f, 1.f, 2.f, 3.f};
+		return {vaddq_f32(vdupq_n_f32(value), vld1q_f32(offsets))};
+	}
+
+	Float4 operator+(const Float4 &other) const {
+		return {vaddq_f32(v, other.v)};
+	}
+
+	Float4 operator*(const Float4 &other) const {
+		return {vmulq_f32(v, other.v)};
+	}
+};
+
+inline void write_nearest(float *depth, Float4 e0, Float4 e1, Float4 e2, Float4 z) {
+	auto covered = vcgeq_f32(vminq_f32(vminq_f32(e0.v, e1.v), e2.v), vdupq_n_f32(0.f));
+	auto old = vld1q_f32(depth);
+	vst1q_f32(depth, vbslq_f32(covered, vminq_f32(old, z.v), old));
+}
+#else
+struct Float4 {
+	float v[4];
+
+	static Float4 splat(float value) {
+		return {{value, value, value, value}};
+	}
+
+	static Float4 ramp(float value) {
+		return {{value, value + 1.f, value + 2.f, value + 3.f}};
+	}
+
+	Float4 operator+(const Float4 &other) const {
+		return {{v[0] + other.v[0], v[1] + other.v[1], v[2] + other.v[2], v[3] + other.v[3]}};
+	}
+
+	Float4 operator*(const Float4 &other) const {
+		return {{v[0] * other.v[0], v[1] * other.v[1], v[2] * other.v[2], v[3] * other.v[3]}};
+	}
+};
+
+inline void write_nearest(float *depth, Float4 e0, Float4 e1, Float4 e2, Float4 z) {
+	for (int i = 0; i < 4; ++i)
+		if (e0.v[i] >= 0.f && e1.v[i] >= 0.f && e2.v[i] >= 0.f)
+			depth[i] = std::min(depth[i], z.v[i]);
+}
+#endif
+
+// plane a * x + b * y + c through the two screen points, positive to the left of from -> to
+glm::vec3 edge_function(const glm::vec3 &from, const glm::vec3 &to) {
+	glm::vec3 edge{from.y - to.y, to.x - from.x, 0.f};
+	edge.z = -(edge.x * from.x + edge.y * from.y);
+	return edge;
+}
+
+} // anonymous
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+		: m_width((std::max(width, 1) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE),
+		  m_height((std::max(height, 1) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE),
+		  m_tiles_x(m_width / TILE_SIZE),
+		  m_tiles_y(m_height / TILE_SIZE),
+		  m_depth(m_width * m_height, 1.f),
+		  m_tiles(m_tiles_x * m_tiles_y, 1.f) {}
+
+void OcclusionBuffer::begin(const glm::mat4 &view_projection) {
+	m_view_projection = view_projection;
+	std::fill(m_depth.begin(), m_depth.end(), 1.f);
+	std::fill(m_tiles.begin(), m_tiles.end(), 1.f);
+	m_triangles.clear();
+	m_stats = {};
+}
+
+void OcclusionBuffer::add_occluder(const std::vector<glm::vec3> &positions,
+                                   const std::vector<unsigned int> &indices,
+                                   const glm::mat4 *transforms,
+                                   std::size_t count) {
+	auto start = std::chrono::steady_clock::now();
+	glm::vec2 scale{0.5f * m_width, 0.5f * m_height};
+	m_clip.resize(positions.size());
+	for (std::size_t instance = 0; instance < count; ++instance) {
+		auto mvp = m_view_projection * transforms[instance];
+		for (std::size_t i = 0; i < positions.size(); ++i)
+			m_clip[i] = mvp * glm::vec4(positions[i], 1.f);
+		for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+			if (indices[i] >= positions.size() || indices[i + 1] >= positions.size()
+			    || indices[i + 2] >= positions.size())
+				continue;
+			glm::vec3 screen[3];
+			bool clipped{false};
+			for (int corner = 0; corner < 3; ++corner) {
+				const auto &clip = m_clip[indices[i + corner]];
+				// crossing the near plane would need clipping, dropping the triangle only loses occlusion
+				if (clip.z < -clip.w || clip.w <= 0.f) {
+					clipped = true;
+					break;
+				}
+				auto ndc = glm::vec3(clip) / clip.w;
+				screen[corner] = {(ndc.x + 1.f) * scale.x, (ndc.y + 1.f) * scale.y, ndc.z * 0.5f + 0.5f};
+			}
+			if (clipped)
+				continue;
+			const auto &v0 = screen[0], &v1 = screen[1], &v2 = screen[2];
+			auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+			if (!(area > 0.f))
+				continue;
+			// pixels whose centers fall inside the bounding box
+			auto min_x = std::max(0, static_cast<int>(std::ceil(std::min({v0.x, v1.x, v2.x}) - 0.5f)));
+			auto max_x = std::min(m_width - 1, static_cast<int>(std::floor(std::max({v0.x, v1.x, v2.x}) - 0.5f)));
+			auto min_y = std::max(0, static_cast<int>(std::ceil(std::min({v0.y, v1.y, v2.y}) - 0.5f)));
+			auto max_y = std::min(m_height - 1, static_cast<int>(std::floor(std::max({v0.y, v1.y, v2.y}) - 0.5f)));
+			if (min_x > max_x || min_y > max_y)
+				continue;
+			Triangle triangle{{edge_function(v1, v2), edge_function(v2, v0), edge_function(v0, v1)},
+			                  {},
+			                  min_x, max_x, min_y, max_y};
+			auto dz1 = v1.z - v0.z, dz2 = v2.z - v0.z;
+			triangle.depth.x = (dz1 * (v2.y - v0.y) - dz2 * (v1.y - v0.y)) / area;
+			triangle.depth.y = (dz2 * (v1.x - v0.x) - dz1 * (v2.x - v0.x)) / area;
+			triangle.depth.z = v0.z - triangle.depth.x * v0.x - triangle.depth.y * v0.y;
+			// inner conservative: a center passes only when the whole pixel is inside, and takes the pixel's
+			// farthest depth. Half a pixel each way moves a plane by at most 0.5 * (|a| + |b|)
+			for (auto &edge: triangle.edges)
+				edge.z -= 0.5f * (std::abs(edge.x) + std::abs(edge.y));
+			triangle.depth.z += 0.5f * (std::abs(triangle.depth.x) + std::abs(triangle.depth.y));
+			m_triangles.push_back(triangle);
+		}
+	}
+	m_stats.raster_time += std::chrono::steady_clock::now() - start;
+}
+
+void OcclusionBuffer::finish() {
+	auto start = std::chrono::steady_clock::now();
+	m_stats.triangles = m_triangles.size();
+	// one band per row of tiles so each worker owns its pixels and tile maxima outright
+	parallel_for(m_tiles_y, [&](std::size_t first, std::size_t last) {
+		for (auto band = first; band < last; ++band) {
+			auto row = static_cast<int>(band) * TILE_SIZE;
+			rasterize(row, row + TILE_SIZE);
+			for (int tile = 0; tile < m_tiles_x; ++tile) {
+				float farthest{0.f};
+				for (int y = row; y < row + TILE_SIZE; ++y) {
+					auto pixels = &m_depth[y * m_width + tile * TILE_SIZE];
+					farthest = std::max(farthest, *std::max_element(pixels, pixels + TILE_SIZE));
+				}
+				m_tiles[band * m_tiles_x + tile] = farthest;
+			}
+		}
+	});
+	m_stats.raster_time += std::chrono::steady_clock::now() - start;
+}
+
+void OcclusionBuffer::rasterize(int first_row, int last_row) {
+	for (const auto &triangle: m_triangles) {
+		auto top = std::min(last_row - 1, triangle.max_y);
+		auto first_x = triangle.min_x & ~3;
+		// stepping four pixels to the right
+		Float4 steps[3], depth_step = Float4::splat(4.f * triangle.depth.x);
+		for (int i = 0; i < 3; ++i)
+			steps[i] = Float4::splat(4.f * triangle.edges[i].x);
+		for (auto y = std::max(first_row, triangle.min_y); y <= top; ++y) {
+			auto center_y = y + 0.5f;
+			auto x = Float4::ramp(first_x + 0.5f);
+			Float4 e[3];
+			for (int i = 0; i < 3; ++i) {
+				const auto &edge = triangle.edges[i];
+				e[i] = x * Float4::splat(edge.x) + Float4::splat(edge.y * center_y + edge.z);
+			}
+			auto z = x * Float4::splat(triangle.depth.x) + Float4::splat(triangle.depth.y * center_y + triangle.depth.z);
+			auto row = &m_depth[y * m_width];
+			for (auto px = first_x; px <= triangle.max_x; px += 4) {
+				write_nearest(row + px, e[0], e[1], e[2], z);
+				for (int i = 0; i < 3; ++i)
+					e[i] = e[i] + steps[i];
+				z = z + depth_step;
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::is_visible(const MeshBounds &bounds, const glm::mat4 &transform) const {
+	auto mvp = m_view_projection * transform;
+	// corners are sums of one column term per axis
+	glm::vec4 xs[2] = {mvp[0] * bounds.min.x, mvp[0] * bounds.max.x};
+	glm::vec4 ys[2] = {mvp[1] * bounds.min.y, mvp[1] * bounds.max.y};
+	glm::vec4 zs[2] = {mvp[2] * bounds.min.z + mvp[3], mvp[2] * bounds.max.z + mvp[3]};
+	glm::vec2 low{static_cast<float>(m_width), static_cast<float>(m_height)}, high{0.f};
+	float nearest{1.f};
+	for (int corner = 0; corner < 8; ++corner) {
+		auto clip = xs[corner & 1] + ys[(corner >> 1) & 1] + zs[corner >> 2];
+		// reaching past the near plane, assume it's in view
+		if (clip.z < -clip.w || clip.w <= 0.f)
+			return true;
+		auto ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 screen{(ndc.x + 1.f) * 0.5f * m_width, (ndc.y + 1.f) * 0.5f * m_height};
+		low = glm::min(low, screen);
+		high = glm::max(high, screen);
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+	// every pixel the box touches, not just the covered centers
+	auto min_x = std::max(0, static_cast<int>(std::floor(low.x)));
+	auto max_x = std::min(m_width - 1, static_cast<int>(std::floor(high.x)));
+	auto min_y = std::max(0, static_cast<int>(std::floor(low.y)));
+	auto max_y = std::min(m_height - 1, static_cast<int>(std::floor(high.y)));
+	// off screen is for the frustum test to decide
+	if (min_x > max_x || min_y > max_y)
+		return true;
+	for (auto tile_y = min_y / TILE_SIZE; tile_y <= max_y / TILE_SIZE; ++tile_y) {
+		for (auto tile_x = min_x / TILE_SIZE; tile_x <= max_x / TILE_SIZE; ++tile_x) {
+			if (m_tiles[tile_y * m_tiles_x + tile_x] < nearest)
+				continue;
+			auto y_end = std::min(max_y, tile_y * TILE_SIZE + TILE_SIZE - 1);
+			auto x_end = std::min(max_x, tile_x * TILE_SIZE + TILE_SIZE - 1);
+			for (auto y = std::max(min_y, tile_y * TILE_SIZE); y <= y_end; ++y)
+				for (auto x = std::max(min_x, tile_x * TILE_SIZE); x <= x_end; ++x)
+					if (m_depth[y * m_width + x] >= nearest)
+						return true;
+		}
+	}
+	return false;
+}
+
+std::size_t OcclusionBuffer::cull(const MeshBounds &bounds, const glm::mat4 *transforms, std::uint32_t *indices,
+                                  std::size_t count) {
+	auto start = std::chrono::steady_clock::now();
+	m_keep.resize(count);
+	parallel_for(count, [&](std::size_t first, std::size_t last) {
+		for (auto i = first; i < last; ++i)
+			m_keep[i] = is_visible(bounds, transforms[indices[i]]);
+	}, 256);
+	std::size_t kept{0};
+	for (std::size_t i = 0; i < count; ++i)
+		if (m_keep[i])
+			indices[kept++] = indices[i];
+	m_stats.tested += count;
+	m_stats.occluded += count - kept;
+	m_stats.test_time += std::chrono::steady_clock::now() - start;
+	return kept;
+}
+
+bool OcclusionBuffer::write_png(const std::string &path) const {
+	float nearest{1.f};
+	for (auto depth: m_depth)
+		nearest = std::min(nearest, depth);
+	// stretch what was written over the grey range, depth is packed close to 1 for most of the view
+	auto range = std::max(1.f - nearest, 1e-6f);
+	std::vector<cp_pixel_t> pixels(m_depth.size());
+	for (int y = 0; y < m_height; ++y) {
+		for (int x = 0; x < m_width; ++x) {
+			auto depth = m_depth[y * m_width + x];
+			unsigned char grey{0};
+			if (depth < 1.f)
+				grey = static_cast<unsigned char>(32.f + 223.f * (1.f - (depth - nearest) / range));
+			// images are stored top row first
+			pixels[(m_height - 1 - y) * m_width + x] = {grey, grey, grey, 255};
+		}
+	}
+	cp_image_t image{m_width, m_height, pixels.data()};
+	if (cp_save_png(path.c_str(), &image) != 0) {
+		std::cerr << "Could not write occlusion buffer to '" << path << "'" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+} // namespace engine::render
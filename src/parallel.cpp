@@ -0,0 +1,174 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <engine/profiler.h>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace engine {
+
+namespace { // pseudo-member namespace
+
+struct Job {
+	const ParallelTask *task;
+	std::size_t count;
+	std::size_t chunk_size;
+	std::size_t chunks;
+	std::atomic<std::size_t> next{0};
+	std::atomic<std::size_t> done{0};
+	std::exception_ptr error;
+	std::mutex error_mutex;
+};
+
+// joins the workers at exit
+struct Workers {
+	std::vector<std::thread> threads;
+
+	~Workers();
+};
+
+unsigned int s_worker_count{std::max(1u, std::thread::hardware_concurrency()) - 1};
+bool s_started{false};
+bool s_stopping{false};
+std::mutex s_mutex;
+std::condition_variable s_wake;
+std::condition_variable s_finished;
+std::shared_ptr<Job> s_job;
+std::size_t s_generation{0};
+// one job at a time
+std::mutex s_submit_mutex;
+thread_local bool t_in_task{false};
+// declared last so it is destroyed, and the threads joined, before anything they use
+Workers s_workers;
+
+void run_chunks(Job &job) {
+	t_in_task = true;
+	std::size_t chunk;
+	while ((chunk = job.next.fetch_add(1, std::memory_order_relaxed)) < job.chunks) {
+		auto first = chunk * job.chunk_size;
+		auto last = std::min(first + job.chunk_size, job.count);
+		try {
+			(*job.task)(first, last);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(job.error_mutex);
+			if (!job.error)
+				job.error = std::current_exception();
+		}
+		if (job.done.fetch_add(1, std::memory_order_acq_rel) + 1 == job.chunks) {
+			std::lock_guard<std::mutex> lock(s_mutex);
+			s_finished.notify_all();
+		}
+	}
+	t_in_task = false;
+}
+
+void work() {
+	ENGINE_PROFILE_THREAD("worker");
+	std::size_t generation{0};
+	while (true) {
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(s_mutex);
+			s_wake.wait(lock, [&] { return s_stopping || s_generation != generation; });
+			if (s_stopping)
+				return;
+			generation = s_generation;
+			job = s_job;
+		}
+		// the caller may have finished every chunk alone before this worker woke up
+		if (job != nullptr)
+			run_chunks(*job);
+	}
+}
+
+// expects s_mutex to be held
+void start_workers() {
+	s_started = true;
+	for (unsigned int i = 0; i < s_worker_count; ++i)
+		s_workers.threads.emplace_back(work);
+}
+
+Workers::~Workers() {
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_stopping = true;
+	}
+	s_wake.notify_all();
+	for (auto &thread: threads)
+		thread.join();
+}
+
+} // anonymous
+
+void set_worker_count(unsigned int count) {
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_started)
+		s_worker_count = count;
+}
+
+unsigned int get_worker_count() {
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_worker_count;
+}
+
+void parallel_for(std::size_t count, const ParallelTask &task, std::size_t grain) {
+	if (count == 0)
+		return;
+	grain = std::max<std::size_t>(grain, 1);
+	if (t_in_task || count <= grain || get_worker_count() == 0) {
+		task(0, count);
+		return;
+	}
+	std::lock_guard<std::mutex> submit(s_submit_mutex);
+	auto job = std::make_shared<Job>();
+	job->task = &task;
+	job->count = count;
+	// a few chunks per thread so uneven items still balance
+	auto threads = s_worker_count + 1;
+	job->chunk_size = std::max(grain, (count + 4 * threads - 1) / (4 * threads));
+	job->chunks = (count + job->chunk_size - 1) / job->chunk_size;
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		if (!s_started)
+			start_workers();
+		s_job = job;
+		++s_generation;
+	}
+	s_wake.notify_all();
+	run_chunks(*job);
+	{
+		std::unique_lock<std::mutex> lock(s_mutex);
+		s_finished.wait(lock, [&] { return job->done.load(std::memory_order_acquire) == job->chunks; });
+		s_job = nullptr;
+	}
+	if (job->error)
+		std::rethrow_exception(job->error);
+}
+
+} // namespace engine
@@ -0,0 +1,389 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/render/picking.h>
+
+#include <algorithm>
+#include <engine/parallel.h>
+#include <engine/render/instance_containers.h>
+
+
+namespace engine::render {
+
+namespace {
+
+constexpr std::uint32_t LEAF_SIZE{4};
+// nodes this big are split even when the heuristic would rather keep them whole
+constexpr std::uint32_t MAX_LEAF_SIZE{16};
+constexpr int BIN_COUNT{16};
+// deeper nodes are split at the median instead, which bounds the depth by 32 + log2 of the leaf count
+constexpr int MAX_SAH_DEPTH{32};
+constexpr int STACK_SIZE{64};
+// nodes with at most this many triangles are built as independent subtrees over the parallel_for workers
+constexpr std::uint32_t SUBTREE_SIZE{1 << 14};
+
+struct BuildTriangle {
+	Aabb box;
+	glm::vec3 center;
+	std::uint32_t id;
+};
+
+// triangles [first, last) of a node being built
+struct BuildTask {
+	std::uint32_t node;
+	std::uint32_t first;
+	std::uint32_t last;
+	int depth;
+	Aabb box;
+	// bounds of the triangle centers
+	Aabb centers;
+};
+
+Aabb empty_box() {
+	return {glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+}
+
+Aabb merge(const Aabb &a, const Aabb &b) {
+	return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+void grow(Aabb &box, const glm::vec3 &point) {
+	box.min = glm::min(box.min, point);
+	box.max = glm::max(box.max, point);
+}
+
+struct Bin {
+	Aabb box{empty_box()};
+	Aabb centers{empty_box()};
+	std::uint32_t count{0};
+};
+
+// half the surface area, only ever compared
+float half_area(const Aabb &box) {
+	auto size = glm::max(box.max - box.min, glm::vec3(0.f));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// slab test with the reciprocal of the direction worked out once per ray
+bool enters(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &inverse, float max_distance, float &distance) {
+	auto near = (box.min - origin) * inverse;
+	auto far = (box.max - origin) * inverse;
+	auto enter = glm::min(near, far);
+	auto exit = glm::max(near, far);
+	distance = std::max({enter.x, enter.y, enter.z, 0.f});
+	return distance <= std::min({exit.x, exit.y, exit.z, max_distance});
+}
+
+// Moller-Trumbore, two sided. u and v weigh the ends of edge1 and edge2
+bool hits(const glm::vec3 &origin, const glm::vec3 &edge1, const glm::vec3 &edge2, const Ray &ray,
+          float max_distance, float &distance, float &u, float &v) {
+	auto p = glm::cross(ray.direction, edge2);
+	auto determinant = glm::dot(edge1, p);
+	if (determinant == 0.f)
+		return false;
+	auto inverse = 1.f / determinant;
+	auto s = ray.origin - origin;
+	u = glm::dot(s, p) * inverse;
+	if (u < 0.f || u > 1.f)
+		return false;
+	auto q = glm::cross(s, edge1);
+	v = glm::dot(ray.direction, q) * inverse;
+	if (v < 0.f || u + v > 1.f)
+		return false;
+	distance = glm::dot(edge2, q) * inverse;
+	return distance >= 0.f && distance < max_distance;
+}
+
+// Partition the triangles of task by binned surface area heuristic along the longest axis of their centers and
+// describe the two halves in left and right. False when they are cheaper to keep together as a leaf
+bool split(std::vector<BuildTriangle> &triangles, const BuildTask &task, BuildTask &left, BuildTask &right) {
+	auto count = task.last - task.first;
+	if (count <= LEAF_SIZE)
+		return false;
+	auto first = triangles.begin() + task.first;
+	auto last = triangles.begin() + task.last;
+	auto extent = task.centers.max - task.centers.min;
+	auto axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	auto minimum = task.centers.min[axis];
+	auto scale = extent[axis] > 0.f ? BIN_COUNT / extent[axis] : 0.f;
+	auto bin_of = [&](const BuildTriangle &triangle) {
+		return std::min(BIN_COUNT - 1, static_cast<int>((triangle.center[axis] - minimum) * scale));
+	};
+	left = {0, task.first, 0, task.depth + 1, empty_box(), empty_box()};
+	right = {0, 0, task.last, task.depth + 1, empty_box(), empty_box()};
+
+	Bin bins[BIN_COUNT];
+	auto best = BIN_COUNT;
+	if (task.depth < MAX_SAH_DEPTH && scale > 0.f) {
+		for (auto it = first; it != last; ++it) {
+			auto &bin = bins[bin_of(*it)];
+			bin.box = merge(bin.box, it->box);
+			grow(bin.centers, it->center);
+			++bin.count;
+		}
+		// sweep from both ends for the cheapest plane between bins
+		float right_cost[BIN_COUNT];
+		auto box = empty_box();
+		std::uint32_t total{0};
+		for (int bin = BIN_COUNT - 1; bin > 0; --bin) {
+			box = merge(box, bins[bin].box);
+			total += bins[bin].count;
+			right_cost[bin] = half_area(box) * total;
+		}
+		auto best_cost = std::numeric_limits<float>::max();
+		box = empty_box();
+		total = 0;
+		for (int bin = 1; bin < BIN_COUNT; ++bin) {
+			box = merge(box, bins[bin - 1].box);
+			total += bins[bin - 1].count;
+			if (total == 0 || total == count)
+				continue;
+			auto cost = half_area(box) * total + right_cost[bin];
+			if (cost < best_cost) {
+				best_cost = cost;
+				best = bin;
+			}
+		}
+		if (count <= MAX_LEAF_SIZE && best_cost >= half_area(task.box) * count)
+			return false;
+	}
+
+	if (best < BIN_COUNT) {
+		auto middle = std::partition(first, last, [&](const BuildTriangle &triangle) { return bin_of(triangle) < best; });
+		left.last = right.first = static_cast<std::uint32_t>(middle - triangles.begin());
+		for (int bin = 0; bin < BIN_COUNT; ++bin) {
+			auto &side = bin < best ? left : right;
+			side.box = merge(side.box, bins[bin].box);
+			side.centers = merge(side.centers, bins[bin].centers);
+		}
+		return true;
+	}
+	// too deep or every center in one spot, halve by count
+	auto middle = first + count / 2;
+	std::nth_element(first, middle, last, [&](const BuildTriangle &a, const BuildTriangle &b) {
+		return a.center[axis] < b.center[axis];
+	});
+	left.last = right.first = static_cast<std::uint32_t>(middle - triangles.begin());
+	for (auto it = first; it != last; ++it) {
+		auto &side = it < middle ? left : right;
+		side.box = merge(side.box, it->box);
+		grow(side.centers, it->center);
+	}
+	return true;
+}
+
+} // anonymous
+
+Ray make_ray(const glm::vec2 &cursor, const glm::vec2 &viewport, const glm::mat4 &view, const glm::mat4 &projection) {
+	glm::vec2 ndc{2.f * cursor.x / viewport.x - 1.f, 1.f - 2.f * cursor.y / viewport.y};
+	auto inverse = glm::inverse(projection * view);
+	auto near = inverse * glm::vec4(ndc, -1.f, 1.f);
+	auto far = inverse * glm::vec4(ndc, 1.f, 1.f);
+	auto origin = glm::vec3(near) / near.w;
+	return {origin, glm::normalize(glm::vec3(far) / far.w - origin)};
+}
+
+TriangleBvh::TriangleBvh(std::span<const glm::vec3> positions, std::span<const unsigned int> indices) {
+	// partitioned in place as the tree is built, so every node's triangles stay contiguous in memory
+	std::vector<BuildTriangle> triangles;
+	auto triangle_count = indices.size() / 3;
+	triangles.reserve(triangle_count);
+	BuildTask root{0, 0, 0, 0, empty_box(), empty_box()};
+	for (std::size_t triangle = 0; triangle < triangle_count; ++triangle) {
+		auto a = indices[3 * triangle], b = indices[3 * triangle + 1], c = indices[3 * triangle + 2];
+		if (a >= positions.size() || b >= positions.size() || c >= positions.size())
+			continue;
+		Aabb box{glm::min(positions[a], glm::min(positions[b], positions[c])),
+		         glm::max(positions[a], glm::max(positions[b], positions[c]))};
+		triangles.push_back({box, 0.5f * (box.min + box.max), static_cast<std::uint32_t>(triangle)});
+		root.box = merge(root.box, box);
+		grow(root.centers, triangles.back().center);
+	}
+	if (triangles.empty())
+		return;
+	root.last = static_cast<std::uint32_t>(triangles.size());
+
+	// grow nodes from task, setting aside tasks small enough to be built on their own when deferred is given
+	auto expand = [&](std::vector<Node> &nodes, const BuildTask &task, std::vector<BuildTask> *deferred) {
+		std::vector<BuildTask> tasks{task};
+		while (!tasks.empty()) {
+			auto current = tasks.back();
+			tasks.pop_back();
+			nodes[current.node].box = current.box;
+			if (deferred != nullptr && current.last - current.first <= SUBTREE_SIZE) {
+				deferred->push_back(current);
+				continue;
+			}
+			BuildTask left, right;
+			if (!split(triangles, current, left, right)) {
+				nodes[current.node].first = current.first;
+				nodes[current.node].count = current.last - current.first;
+				continue;
+			}
+			left.node = static_cast<std::uint32_t>(nodes.size());
+			right.node = left.node + 1;
+			nodes[current.node].first = left.node;
+			nodes.emplace_back();
+			nodes.emplace_back();
+			tasks.push_back(right);
+			tasks.push_back(left);
+		}
+	};
+
+	// the top of the tree on this thread, then the subtrees below it in parallel over disjoint triangle ranges
+	std::vector<BuildTask> subtrees;
+	m_nodes.emplace_back();
+	expand(m_nodes, root, &subtrees);
+	std::vector<std::vector<Node>> built(subtrees.size());
+	parallel_for(subtrees.size(), [&](std::size_t first, std::size_t last) {
+		for (auto i = first; i < last; ++i) {
+			auto task = subtrees[i];
+			task.node = 0;
+			built[i].emplace_back();
+			expand(built[i], task, nullptr);
+		}
+	});
+	// each subtree's root replaces its placeholder, the rest is appended with child indices moved along
+	auto total = m_nodes.size();
+	for (const auto &nodes: built)
+		total += nodes.size();
+	m_nodes.reserve(total);
+	for (std::size_t i = 0; i < subtrees.size(); ++i) {
+		auto base = static_cast<std::uint32_t>(m_nodes.size()) - 1;
+		for (auto &node: built[i])
+			if (node.count == 0)
+				node.first += base;
+		m_nodes[subtrees[i].node] = built[i][0];
+		m_nodes.insert(m_nodes.end(), built[i].begin() + 1, built[i].end());
+	}
+
+	m_triangles.resize(triangles.size());
+	m_ids.resize(triangles.size());
+	for (std::size_t i = 0; i < triangles.size(); ++i) {
+		auto id = triangles[i].id;
+		const auto &a = positions[indices[3 * id]];
+		m_triangles[i] = {a, positions[indices[3 * id + 1]] - a, positions[indices[3 * id + 2]] - a};
+		m_ids[i] = id;
+	}
+}
+
+bool TriangleBvh::intersect(const Ray &ray, TriangleHit &hit) const {
+	if (m_nodes.empty())
+		return false;
+	auto inverse = 1.f / ray.direction;
+	auto nearest = hit.distance;
+	std::uint32_t found{0};
+	float found_u{0.f}, found_v{0.f};
+	bool any{false};
+
+	// far children waiting with the distance their box is entered at
+	struct Pending {
+		std::uint32_t node;
+		float distance;
+	};
+	Pending stack[STACK_SIZE];
+	int size{0};
+	float distance;
+	if (!enters(m_nodes[0].box, ray.origin, inverse, nearest, distance))
+		return false;
+	std::uint32_t node{0};
+	while (true) {
+		const auto &current = m_nodes[node];
+		if (current.count > 0) {
+			for (auto i = current.first; i < current.first + current.count; ++i) {
+				const auto &triangle = m_triangles[i];
+				float u, v;
+				if (hits(triangle.origin, triangle.edge1, triangle.edge2, ray, nearest, distance, u, v)) {
+					nearest = distance;
+					found = i;
+					found_u = u;
+					found_v = v;
+					any = true;
+				}
+			}
+		} else {
+			// descend into the nearer child and come back for the other one unless something closer turns up
+			float left_distance, right_distance;
+			auto left = enters(m_nodes[current.first].box, ray.origin, inverse, nearest, left_distance);
+			auto right = enters(m_nodes[current.first + 1].box, ray.origin, inverse, nearest, right_distance);
+			if (left && right) {
+				if (left_distance <= right_distance) {
+					stack[size++] = {current.first + 1, right_distance};
+					node = current.first;
+				} else {
+					stack[size++] = {current.first, left_distance};
+					node = current.first + 1;
+				}
+				continue;
+			}
+			if (left || right) {
+				node = left ? current.first : current.first + 1;
+				continue;
+			}
+		}
+		while (size > 0 && stack[size - 1].distance > nearest)
+			--size;
+		if (size == 0)
+			break;
+		node = stack[--size].node;
+	}
+	if (!any)
+		return false;
+	hit.triangle = m_ids[found];
+	hit.barycentrics = {1.f - found_u - found_v, found_u, found_v};
+	hit.distance = nearest;
+	return true;
+}
+
+bool pick(const SpatialIndex &index, entt::registry &registry, const Ray &ray, PickHit &hit, float max_distance) {
+	thread_local std::vector<InstanceKey> keys;
+	index.query(ray, max_distance, keys);
+	TriangleHit nearest;
+	nearest.distance = max_distance;
+	InstanceKey found;
+	for (const auto &key: keys) {
+		// boxes come nearest first, once one starts past the best hit so does every one after it
+		float distance;
+		if (!intersect(*index.get_bounds(key), ray, nearest.distance, distance))
+			break;
+		auto bvh = registry.try_get<TriangleBvh>(key.mesh);
+		if (bvh == nullptr)
+			continue;
+		const auto &transforms = registry.get<Mat4Instances>(key.mesh).get_data_vector();
+		if (key.instance >= transforms.size())
+			continue;
+		// affine transforms keep distances along the ray the same in object space
+		auto inverse = glm::inverse(transforms[key.instance]);
+		Ray local{glm::vec3(inverse * glm::vec4(ray.origin, 1.f)), glm::vec3(inverse * glm::vec4(ray.direction, 0.f))};
+		if (bvh->intersect(local, nearest))
+			found = key;
+	}
+	if (found.mesh == entt::null)
+		return false;
+	hit.mesh = found.mesh;
+	hit.instance = found.instance;
+	hit.triangle = nearest.triangle;
+	hit.barycentrics = nearest.barycentrics;
+	hit.distance = nearest.distance;
+	hit.position = ray.origin + ray.direction * nearest.distance;
+	return true;
+}
+
+} // namespace engine::render
@@ -0,0 +1,313 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <engine/profiler.h>
+
+#ifdef ENGINE_PROFILING
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fmt/format.h>
+#include <fstream>
+#include <GL/glew.h>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace engine::profiler {
+
+namespace {
+
+constexpr std::size_t EVENTS_PER_THREAD{1 << 16};
+// GPU results are read this many frames after they were issued so the readback never stalls
+constexpr std::size_t GPU_FRAME_LATENCY{4};
+
+// bumped by new_frame, threads hand their pending events over the first time they record in a new frame
+std::atomic<std::uint64_t> s_frame{0};
+// events recorded before the last clear() are dropped instead of handed over
+std::atomic<std::uint64_t> s_cleared_frame{0};
+
+// Owned by one thread for writing. Events collect in pending without any locking and move to the ring, under the
+// mutex, once per frame. The mutex is only ever contended while a trace is being written
+struct ThreadBuffer {
+	std::uint32_t id;
+	std::string name;
+	std::mutex mutex;
+	std::vector<ZoneEvent> events = std::vector<ZoneEvent>(EVENTS_PER_THREAD);
+	// total events ever handed over, the ring holds the newest EVENTS_PER_THREAD of them
+	std::size_t count{0};
+	// touched by the owning thread only: open zones and the events of the frame pending_frame
+	std::vector<ZoneEvent> stack;
+	std::vector<ZoneEvent> pending;
+	std::uint64_t pending_frame{0};
+
+	void push(const ZoneEvent &event) {
+		auto frame = s_frame.load(std::memory_order_relaxed);
+		if (frame != pending_frame || pending.size() == EVENTS_PER_THREAD) {
+			flush();
+			pending_frame = frame;
+		}
+		pending.push_back(event);
+	}
+
+	// owning thread only
+	void flush() {
+		if (pending.empty())
+			return;
+		if (pending_frame >= s_cleared_frame.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto &event: pending)
+				events[count++ % EVENTS_PER_THREAD] = event;
+		}
+		pending.clear();
+	}
+};
+
+// hands over what its thread recorded last when the thread exits
+struct ThreadHandle {
+	ThreadBuffer *buffer{nullptr};
+
+	~ThreadHandle() {
+		if (buffer != nullptr)
+			buffer->flush();
+	}
+};
+
+struct GpuZone {
+	const char *name;
+	GLuint begin_query;
+	GLuint end_query;
+	std::uint32_t depth;
+};
+
+struct GpuFrame {
+	std::vector<GpuZone> zones;
+	std::vector<GLuint> queries;
+	std::size_t used_queries{0};
+	// steady clock minus GL timestamp when the frame started, maps GPU times onto the CPU timeline
+	std::int64_t clock_offset{0};
+};
+
+const auto s_epoch = std::chrono::steady_clock::now();
+std::mutex s_threads_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> s_threads;
+thread_local ThreadHandle t_thread;
+
+std::shared_ptr<ThreadBuffer> s_gpu_buffer;
+std::array<GpuFrame, GPU_FRAME_LATENCY> s_gpu_frames;
+std::size_t s_gpu_frame{0};
+std::vector<std::size_t> s_gpu_stack;
+std::size_t s_gpu_dropped{0};
+std::uint64_t s_frame_start{0};
+
+std::shared_ptr<ThreadBuffer> make_buffer(std::string name) {
+	// buffers are kept after their thread exits so its events still make it into the trace
+	auto buffer = std::make_shared<ThreadBuffer>();
+	std::lock_guard<std::mutex> lock(s_threads_mutex);
+	buffer->id = static_cast<std::uint32_t>(s_threads.size());
+	buffer->name = name.empty() ? fmt::format("thread {}", buffer->id) : std::move(name);
+	s_threads.push_back(buffer);
+	return buffer;
+}
+
+ThreadBuffer &thread_buffer() {
+	if (t_thread.buffer == nullptr)
+		t_thread.buffer = make_buffer("").get();
+	return *t_thread.buffer;
+}
+
+GLuint acquire_query(GpuFrame &frame) {
+	if (frame.used_queries == frame.queries.size()) {
+		frame.queries.resize(frame.queries.size() + 16);
+		glGenQueries(16, &frame.queries[frame.used_queries]);
+	}
+	return frame.queries[frame.used_queries++];
+}
+
+// read back the zones of a frame issued GPU_FRAME_LATENCY frames ago and recycle its queries
+void resolve_gpu_frame(GpuFrame &frame) {
+	if (!frame.zones.empty()) {
+		// results become available in issue order, so the last query stands for all of them
+		GLuint available{GL_FALSE};
+		glGetQueryObjectuiv(frame.queries[frame.used_queries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			if (s_gpu_buffer == nullptr)
+				s_gpu_buffer = make_buffer("GPU");
+			for (const auto &zone: frame.zones) {
+				GLuint64 begin, end;
+				glGetQueryObjectui64v(zone.begin_query, GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(zone.end_query, GL_QUERY_RESULT, &end);
+				s_gpu_buffer->push({zone.name,
+				                    static_cast<std::uint64_t>(static_cast<std::int64_t>(begin) + frame.clock_offset),
+				                    static_cast<std::uint64_t>(static_cast<std::int64_t>(end) + frame.clock_offset),
+				                    zone.depth});
+			}
+		} else
+			// the GPU is further behind than the latency allows, waiting here would stall the frame
+			++s_gpu_dropped;
+	}
+	frame.zones.clear();
+	frame.used_queries = 0;
+	GLint64 gpu_now{0};
+	glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+	frame.clock_offset = static_cast<std::int64_t>(now()) - gpu_now;
+}
+
+void escape(std::string &out, const std::string &text) {
+	for (auto c: text) {
+		if (c == '"' || c == '\\')
+			out += '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			out += c;
+	}
+}
+
+} // anonymous
+
+std::uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+void begin_zone(const char *name) {
+	auto &buffer = thread_buffer();
+	buffer.stack.push_back({name, now(), 0, static_cast<std::uint32_t>(buffer.stack.size())});
+}
+
+void end_zone() {
+	auto &buffer = thread_buffer();
+	if (buffer.stack.empty())
+		return;
+	auto event = buffer.stack.back();
+	buffer.stack.pop_back();
+	event.end = now();
+	buffer.push(event);
+}
+
+void begin_gpu_zone(const char *name) {
+	// GL_TIME_ELAPSED queries can't nest, a timestamp at each end can
+	auto &frame = s_gpu_frames[s_gpu_frame];
+	auto query = acquire_query(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	s_gpu_stack.push_back(frame.zones.size());
+	frame.zones.push_back({name, query, 0, static_cast<std::uint32_t>(s_gpu_stack.size() - 1)});
+}
+
+void end_gpu_zone() {
+	if (s_gpu_stack.empty())
+		return;
+	auto &frame = s_gpu_frames[s_gpu_frame];
+	auto query = acquire_query(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	frame.zones[s_gpu_stack.back()].end_query = query;
+	s_gpu_stack.pop_back();
+}
+
+void new_frame() {
+	auto end = now();
+	if (s_frame_start != 0)
+		thread_buffer().push({"frame", s_frame_start, end, 0});
+	s_frame_start = end;
+
+	// zones still open are cut off at the frame boundary so every zone resolved later has both queries, the end
+	// of their scope then finds nothing left to close
+	while (!s_gpu_stack.empty())
+		end_gpu_zone();
+	s_gpu_frame = (s_gpu_frame + 1) % GPU_FRAME_LATENCY;
+	resolve_gpu_frame(s_gpu_frames[s_gpu_frame]);
+	s_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+void set_thread_name(const std::string &name) {
+	if (t_thread.buffer == nullptr) {
+		t_thread.buffer = make_buffer(name).get();
+		return;
+	}
+	std::lock_guard<std::mutex> lock(t_thread.buffer->mutex);
+	t_thread.buffer->name = name;
+}
+
+bool write_chrome_trace(const std::string &path) {
+	// other threads' newest events show up once they record in a later frame or exit
+	if (t_thread.buffer != nullptr)
+		t_thread.buffer->flush();
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first{true};
+	auto separator = [&]() {
+		if (!first)
+			json += ",\n";
+		first = false;
+	};
+	std::lock_guard<std::mutex> threads_lock(s_threads_mutex);
+	for (const auto &buffer: s_threads) {
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		separator();
+		json += fmt::format(R"({{"ph":"M","pid":0,"tid":{},"name":"thread_name","args":{{"name":")", buffer->id);
+		escape(json, buffer->name);
+		json += "\"}}";
+		auto stored = std::min(buffer->count, EVENTS_PER_THREAD);
+		for (auto i = buffer->count - stored; i < buffer->count; ++i) {
+			const auto &event = buffer->events[i % EVENTS_PER_THREAD];
+			separator();
+			json += R"({"ph":"X","pid":0,"tid":)" + std::to_string(buffer->id) + R"(,"name":")";
+			escape(json, event.name);
+			// trace timestamps are microseconds
+			json += fmt::format(R"(","ts":{:.3f},"dur":{:.3f}}})",
+			                    event.start / 1000.0,
+			                    (event.end - event.start) / 1000.0);
+		}
+	}
+	json += "]}\n";
+
+	std::ofstream file(path, std::ios::trunc);
+	file << json;
+	if (!file) {
+		std::cerr << "Could not write trace to '" << path << "'" << std::endl;
+		return false;
+	}
+	if (s_gpu_dropped > 0)
+		std::cerr << s_gpu_dropped << " frames of GPU zones were dropped waiting on query results" << std::endl;
+	return true;
+}
+
+void clear() {
+	s_cleared_frame.store(s_frame.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> threads_lock(s_threads_mutex);
+	for (const auto &buffer: s_threads) {
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		buffer->count = 0;
+	}
+	s_gpu_dropped = 0;
+}
+
+void shutdown() {
+	for (auto &frame: s_gpu_frames) {
+		if (!frame.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		frame = {};
+	}
+	s_gpu_stack.clear();
+}
+
+} // namespace engine::profiler
+
+#endif //ENGINE_PROFILING
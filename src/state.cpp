@@ -22,6 +22,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <engine/profiler.h>
 #include <engine/render/renderer.h>
 #include <engine/state.h>
 #include <iostream>
@@ -137,6 +138,7 @@ bool init() {
 }
 
 void poll() {
+	ENGINE_PROFILE_ZONE("state::poll");
 	auto window = render::get_window();
 	glfwPollEvents();
 	reset_prev_mouse_coords();
@@ -0,0 +1,171 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Checks cull_spheres and every x86 kernel the CPU supports against cull_spheres_scalar on random frustums,
+// spheres touching or just missing a plane, infinities and NaN. Exits non zero when a check fails
+
+#include <cmath>
+#include <cstdlib>
+#include <engine/render/culling.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace engine::render;
+
+namespace {
+
+int s_failures{0};
+
+void check(bool condition, const std::string &what) {
+	if (condition)
+		return;
+	std::cerr << "FAILED: " << what << std::endl;
+	++s_failures;
+}
+
+void push(SphereSet &spheres, float x, float y, float z, float radius) {
+	spheres.x.push_back(x);
+	spheres.y.push_back(y);
+	spheres.z.push_back(z);
+	spheres.radius.push_back(radius);
+}
+
+using Kernel = std::size_t (*)(const Frustum &, const SphereSet &, std::vector<std::uint32_t> &);
+
+struct NamedKernel {
+	const char *name;
+	Kernel cull;
+};
+
+// the dispatched path plus each x86 kernel on its own, so a machine with AVX2 still tests the SSE4.1 one
+std::vector<NamedKernel> supported_kernels() {
+	std::vector<NamedKernel> kernels{{"cull_spheres", cull_spheres}};
+#if defined(ENGINE_CULLING_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1"))
+		kernels.push_back({"cull_spheres_sse41", cull_spheres_sse41});
+	if (__builtin_cpu_supports("avx2"))
+		kernels.push_back({"cull_spheres_avx2", cull_spheres_avx2});
+#endif
+	return kernels;
+}
+
+const std::vector<NamedKernel> s_kernels{supported_kernels()};
+
+// every kernel keeps the same spheres in the same order as the scalar reference
+std::vector<std::uint32_t> compare(const Frustum &frustum, const SphereSet &spheres, const std::string &what) {
+	std::vector<std::uint32_t> scalar;
+	auto scalar_count = cull_spheres_scalar(frustum, spheres, scalar);
+	check(scalar_count == scalar.size(), what + ": cull_spheres_scalar count matches output size");
+	for (const auto &kernel: s_kernels) {
+		std::vector<std::uint32_t> visible;
+		auto count = kernel.cull(frustum, spheres, visible);
+		check(count == visible.size(), what + ": " + kernel.name + " count matches output size");
+		check(visible == scalar, what + ": " + kernel.name + " agrees with cull_spheres_scalar");
+	}
+	return scalar;
+}
+
+bool kept(const std::vector<std::uint32_t> &visible, std::size_t index) {
+	for (auto i: visible)
+		if (i == index)
+			return true;
+	return false;
+}
+
+void test_random() {
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> position(-60.f, 60.f), radius(0.f, 4.f), angle(0.f, 6.2831853f);
+	for (int f = 0; f < 16; ++f) {
+		auto eye = glm::vec3(position(rng), position(rng), position(rng)) * 0.2f;
+		auto target = eye + glm::vec3(std::cos(angle(rng)), 0.3f, std::sin(angle(rng)));
+		auto projection = glm::perspective(glm::radians(30.f + f * 5.f), 1.5f, 0.1f, 40.f + f * 5.f);
+		Frustum frustum(projection * glm::lookAt(eye, target, glm::vec3(0.f, 1.f, 0.f)));
+		// every tail length the 4 and 8 wide kernels can leave, then a large set
+		for (std::size_t n: {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 1000}) {
+			SphereSet spheres;
+			for (std::size_t i = 0; i < n; ++i)
+				push(spheres, position(rng), position(rng), position(rng), radius(rng));
+			compare(frustum, spheres, "random frustum " + std::to_string(f) + ", " + std::to_string(n) + " spheres");
+		}
+	}
+}
+
+// the identity view projection gives the planes of the [-1, 1] cube, exactly representable
+void test_edges() {
+	Frustum frustum(glm::mat4(1.f));
+	auto nan = std::numeric_limits<float>::quiet_NaN();
+	auto inf = std::numeric_limits<float>::infinity();
+	auto below = std::nextafter(-2.f, -3.f);
+	struct Case {
+		const char *name;
+		float x, y, z, radius;
+		bool visible;
+	};
+	const Case cases[] = {
+			{"inside", 0.f, 0.f, 0.f, 0.5f, true},
+			{"touching the left plane", -2.f, 0.f, 0.f, 1.f, true},
+			{"touching the far plane", 0.f, 0.f, 2.f, 1.f, true},
+			{"one ulp past the left plane", below, 0.f, 0.f, 1.f, false},
+			{"point on a plane", 1.f, 0.f, 0.f, 0.f, true},
+			{"point just outside", 0.f, std::nextafter(1.f, 2.f), 0.f, 0.f, false},
+			{"negative zero radius", 0.f, 0.f, -1.f, -0.f, true},
+			{"far outside", 0.f, -50.f, 0.f, 1.f, false},
+			{"infinite center", inf, 0.f, 0.f, 1.f, false},
+			{"infinite radius", 100.f, 0.f, 0.f, inf, true},
+			{"NaN x", nan, 0.f, 0.f, 1.f, true},
+			{"NaN z", 5.f, 5.f, nan, 1.f, true},
+			{"NaN radius", 0.f, 0.f, 0.f, nan, true},
+			{"NaN radius outside", 9.f, 0.f, 0.f, nan, true},
+	};
+	constexpr std::size_t count = sizeof(cases) / sizeof(cases[0]);
+	// shift the cases through every SIMD lane and into the scalar tail
+	for (std::size_t padding = 0; padding < 8; ++padding) {
+		SphereSet spheres;
+		for (std::size_t i = 0; i < padding; ++i)
+			push(spheres, 0.f, 0.f, 0.f, 1.f);
+		for (const auto &c: cases)
+			push(spheres, c.x, c.y, c.z, c.radius);
+		auto visible = compare(frustum, spheres, "edge cases after " + std::to_string(padding) + " spheres");
+		for (std::size_t i = 0; i < count; ++i)
+			check(kept(visible, padding + i) == cases[i].visible,
+			      std::string(cases[i].name) + (cases[i].visible ? " is kept" : " is culled"));
+	}
+}
+
+} // anonymous
+
+int main() {
+	test_random();
+	test_edges();
+	if (s_failures > 0) {
+		std::cerr << s_failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "culling tests passed for";
+	for (const auto &kernel: s_kernels)
+		std::cout << " " << kernel.name;
+	std::cout << std::endl;
+	return EXIT_SUCCESS;
+}
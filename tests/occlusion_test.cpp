@@ -0,0 +1,111 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Checks OcclusionBuffer against a single triangle occluder: boxes behind it are culled, boxes beside or in front of
+// it are kept, and so is a box reaching less than a pixel past its edge. Exits non zero when a check fails
+
+#include <cstdlib>
+#include <engine/render/occlusion.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace engine::render;
+
+namespace {
+
+constexpr int WIDTH{256};
+constexpr int HEIGHT{128};
+
+int s_failures{0};
+
+void check(bool condition, const std::string &what) {
+	if (condition)
+		return;
+	std::cerr << "FAILED: " << what << std::endl;
+	++s_failures;
+}
+
+// normalized device x of a point on the buffer's pixel grid
+float ndc_x(float pixels) {
+	return pixels / (0.5f * WIDTH) - 1.f;
+}
+
+MeshBounds box(const glm::vec3 &min, const glm::vec3 &max) {
+	MeshBounds bounds;
+	bounds.min = min;
+	bounds.max = max;
+	bounds.center = 0.5f * (min + max);
+	return bounds;
+}
+
+// with the identity view projection positions are already in normalized device coordinates. The occluder is one
+// triangle at depth 0.5 whose right edge runs through pixel column 192, past that column's center. A single
+// triangle since pixels along an edge shared by two are covered by neither
+void test_triangle() {
+	const auto edge = ndc_x(192.6f);
+	const std::vector<glm::vec3> positions{{-0.9f, -0.9f, 0.f}, {edge, -0.9f, 0.f}, {edge, 0.9f, 0.f}};
+	const std::vector<unsigned int> indices{0, 1, 2};
+	const glm::mat4 identity(1.f);
+	OcclusionBuffer buffer(WIDTH, HEIGHT);
+	buffer.begin(identity);
+	buffer.add_occluder(positions, indices, &identity, 1);
+	buffer.finish();
+	check(buffer.get_stats().triangles == 1, "the occluder is rasterized");
+
+	struct Case {
+		const char *name;
+		MeshBounds bounds;
+		bool visible;
+	};
+	const Case cases[] = {
+			{"box behind the occluder", box({0.2f, -0.6f, 0.2f}, {0.4f, -0.2f, 0.6f}), false},
+			{"box behind, a pixel inside the edge", box({0.3f, -0.6f, 0.2f}, {ndc_x(191.9f), -0.2f, 0.6f}), false},
+			{"box beside the occluder", box({0.7f, -0.6f, 0.2f}, {0.9f, -0.2f, 0.6f}), true},
+			{"box in front of the occluder", box({0.2f, -0.6f, -0.6f}, {0.4f, -0.2f, -0.2f}), true},
+			{"box behind, less than a pixel past the edge", box({0.3f, -0.6f, 0.2f}, {ndc_x(192.9f), -0.2f, 0.6f}),
+			 true},
+	};
+	for (const auto &c: cases)
+		check(buffer.is_visible(c.bounds, identity) == c.visible,
+		      std::string(c.name) + (c.visible ? " is visible" : " is occluded"));
+
+	// cull() agrees and keeps the order
+	const glm::mat4 transforms[] = {identity, identity};
+	std::uint32_t kept[] = {0, 1};
+	auto count = buffer.cull(cases[0].bounds, transforms, kept, 2);
+	check(count == 0, "cull drops every instance of the hidden box");
+	kept[0] = 1;
+	kept[1] = 0;
+	count = buffer.cull(cases[4].bounds, transforms, kept, 2);
+	check(count == 2 && kept[0] == 1 && kept[1] == 0, "cull keeps every instance of the straddling box in order");
+}
+
+} // anonymous
+
+int main() {
+	test_triangle();
+	if (s_failures > 0) {
+		std::cerr << s_failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "occlusion tests passed" << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// test geometry shared by the tools in this directory
+
+#ifndef ENGINE_TOOLS_GEOMETRY_H
+#define ENGINE_TOOLS_GEOMETRY_H
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace engine::tools {
+
+struct Geometry {
+	std::vector<glm::vec3> positions;
+	// empty when the source has none, one per position otherwise
+	std::vector<glm::vec3> colors;
+	std::vector<glm::vec2> uvs;
+	std::vector<unsigned int> indices;
+};
+
+// faces are fanned into triangles, negative (relative) indices are supported. Vertex colors ("v x y z r g b") are
+// read, and with texture coordinates every distinct position/uv pair becomes its own vertex
+inline bool load_obj(const std::string &path, Geometry &geometry) {
+	std::ifstream file(path);
+	if (!file) {
+		std::cerr << "Could not open '" << path << "'" << std::endl;
+		return false;
+	}
+	std::vector<glm::vec3> positions, colors;
+	std::vector<glm::vec2> uvs;
+	// position and uv index of every triangle corner, uv -1 when absent
+	std::vector<std::pair<long, long>> corners;
+	auto resolve = [](long index, std::size_t count) {
+		return index < 0 ? index + static_cast<long>(count) : index - 1;
+	};
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		std::string type;
+		stream >> type;
+		if (type == "v") {
+			glm::vec3 p, c;
+			stream >> p.x >> p.y >> p.z;
+			positions.push_back(p);
+			if (stream >> c.x >> c.y >> c.z)
+				colors.push_back(c);
+		} else if (type == "vt") {
+			glm::vec2 uv;
+			stream >> uv.x >> uv.y;
+			uvs.push_back(uv);
+		} else if (type == "f") {
+			std::vector<std::pair<long, long>> face;
+			std::string corner;
+			while (stream >> corner) {
+				auto slash = corner.find('/');
+				long uv{-1};
+				if (slash != std::string::npos && slash + 1 < corner.size() && corner[slash + 1] != '/')
+					uv = resolve(std::atol(corner.c_str() + slash + 1), uvs.size());
+				face.emplace_back(resolve(std::atol(corner.c_str()), positions.size()), uv);
+			}
+			for (std::size_t i = 2; i < face.size(); ++i)
+				corners.insert(corners.end(), {face[0], face[i - 1], face[i]});
+		}
+	}
+	if (colors.size() != positions.size())
+		colors.clear();
+	if (uvs.empty()) {
+		geometry.positions = std::move(positions);
+		geometry.colors = std::move(colors);
+		for (const auto &corner: corners)
+			geometry.indices.push_back(static_cast<unsigned int>(corner.first));
+		return !geometry.indices.empty();
+	}
+	std::map<std::pair<long, long>, unsigned int> vertices;
+	for (const auto &corner: corners) {
+		auto [it, added] = vertices.emplace(corner, static_cast<unsigned int>(geometry.positions.size()));
+		if (added) {
+			geometry.positions.push_back(positions[corner.first]);
+			if (!colors.empty())
+				geometry.colors.push_back(colors[corner.first]);
+			geometry.uvs.push_back(corner.second >= 0 ? uvs[corner.second] : glm::vec2(0.f));
+		}
+		geometry.indices.push_back(it->second);
+	}
+	return !geometry.indices.empty();
+}
+
+// latitude/longitude sphere with a duplicated seam column like a textured mesh would have
+inline Geometry make_sphere(unsigned int segments) {
+	Geometry geometry;
+	auto rings = segments / 2;
+	for (unsigned int ring = 0; ring <= rings; ++ring) {
+		auto theta = glm::pi<float>() * ring / rings;
+		for (unsigned int segment = 0; segment <= segments; ++segment) {
+			auto phi = 2.f * glm::pi<float>() * (segment % segments) / segments;
+			geometry.positions.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta),
+			                                std::sin(theta) * std::sin(phi));
+		}
+	}
+	auto row = segments + 1;
+	for (unsigned int ring = 0; ring < rings; ++ring) {
+		for (unsigned int segment = 0; segment < segments; ++segment) {
+			auto a = ring * row + segment;
+			auto b = a + row;
+			if (ring > 0)
+				geometry.indices.insert(geometry.indices.end(), {a, a + 1, b});
+			if (ring + 1 < rings)
+				geometry.indices.insert(geometry.indices.end(), {a + 1, b + 1, b});
+		}
+	}
+	return geometry;
+}
+
+// cube from -1 to 1 with shared corners and counter clockwise faces seen from outside
+inline Geometry make_box() {
+	Geometry geometry;
+	for (unsigned int corner = 0; corner < 8; ++corner)
+		geometry.positions.emplace_back(corner & 1 ? 1.f : -1.f, corner & 2 ? 1.f : -1.f, corner & 4 ? 1.f : -1.f);
+	const unsigned int faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+	for (const auto &face: faces)
+		geometry.indices.insert(geometry.indices.end(), {face[0], face[1], face[2], face[0], face[2], face[3]});
+	return geometry;
+}
+
+} // namespace engine::tools
+
+#endif //ENGINE_TOOLS_GEOMETRY_H
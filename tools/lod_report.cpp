@@ -0,0 +1,105 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Builds the LOD chain render::generate_lods would and prints the triangle count, reduction and error of every
+// level, e.g.
+//   lod_report model.obj --levels 5 --reduction 0.5
+// Without a file a UV sphere is used (--sphere <segments>)
+
+#include "geometry.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <engine/render/culling.h>
+#include <engine/render/lod.h>
+#include <fmt/format.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace engine;
+using namespace engine::tools;
+
+namespace {
+
+void print_usage() {
+	std::cout << "usage: lod_report [file.obj] [--sphere segments] [--levels n] [--reduction r] [--max-error e]"
+	          << std::endl;
+}
+
+} // anonymous
+
+int main(int argc, char **argv) {
+	std::string path;
+	unsigned int segments{128};
+	render::LodSettings settings;
+	settings.max_levels = 5;
+	for (int i = 1; i < argc; ++i) {
+		auto has_value = i + 1 < argc;
+		if (!std::strcmp(argv[i], "--sphere") && has_value)
+			segments = std::max(std::atoi(argv[++i]), 4);
+		else if (!std::strcmp(argv[i], "--levels") && has_value)
+			settings.max_levels = std::max(std::atoi(argv[++i]), 1);
+		else if (!std::strcmp(argv[i], "--reduction") && has_value)
+			settings.reduction = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--max-error") && has_value)
+			settings.max_error = std::atof(argv[++i]);
+		else if (argv[i][0] != '-')
+			path = argv[i];
+		else {
+			print_usage();
+			return argv[i] == std::string("--help") ? 0 : 1;
+		}
+	}
+
+	Geometry geometry;
+	if (path.empty())
+		geometry = make_sphere(segments);
+	else if (!load_obj(path, geometry))
+		return 1;
+
+	auto start = std::chrono::steady_clock::now();
+	auto chain = render::build_lod_chain(geometry.positions, geometry.indices, settings);
+	auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	auto radius = render::compute_bounds(geometry.positions).radius;
+
+	std::cout << (path.empty() ? fmt::format("uv sphere, {} segments", segments) : path) << ": "
+	          << geometry.positions.size() << " vertices, built in " << fmt::format("{:.1f}", elapsed) << " ms"
+	          << std::endl;
+	std::cout << fmt::format("{:>5} {:>10} {:>10} {:>10} {:>12} {:>12}", "level", "triangles", "of full",
+	                         "vs prev", "error/radius", "screen size") << std::endl;
+	auto full = chain.levels.front().index_count / 3;
+	auto previous = full;
+	for (std::size_t i = 0; i < chain.levels.size(); ++i) {
+		const auto &level = chain.levels[i];
+		auto triangles = level.index_count / 3;
+		std::cout << fmt::format("{:>5} {:>10} {:>9.1f}% {:>9.1f}% {:>12.5f} {:>12.3f}",
+		                         i,
+		                         triangles,
+		                         100.0 * triangles / full,
+		                         100.0 * triangles / previous,
+		                         radius > 0 ? level.error / radius : 0.f,
+		                         level.min_screen_size) << std::endl;
+		previous = triangles;
+	}
+	return 0;
+}
@@ -0,0 +1,200 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Converts an .obj, .gltf or .glb into the engine's mesh asset format (render/mesh_asset.h) ready to be mapped by
+// MappedMesh: vertex cache and fetch optimized, indices narrowed where possible and with a LOD chain, e.g.
+//   mesh_convert model.obj model.emesh --levels 4
+// then maps the result back and reports how long opening it and reading every stream takes
+
+#include "geometry.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <engine/render/gltf.h>
+#include <engine/render/lod.h>
+#include <engine/render/mesh_asset.h>
+#include <engine/render/mesh_optimizer.h>
+#include <fmt/format.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace engine;
+using namespace engine::tools;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double milliseconds_since(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void optimize(Geometry &geometry, bool overdraw) {
+	auto vertex_count = geometry.positions.size();
+	render::optimize_vertex_cache(geometry.indices, vertex_count);
+	if (overdraw)
+		render::optimize_overdraw(geometry.indices, geometry.positions, render::MeshOptimizeOptions{}.overdraw_threshold);
+	auto remap = render::optimize_vertex_fetch(geometry.indices, vertex_count);
+	geometry.positions = render::remap_vertices(geometry.positions, remap);
+	if (!geometry.colors.empty())
+		geometry.colors = render::remap_vertices(geometry.colors, remap);
+	if (!geometry.uvs.empty())
+		geometry.uvs = render::remap_vertices(geometry.uvs, remap);
+}
+
+// every instance of every primitive baked into one world space mesh
+bool load_gltf(const std::string &path, Geometry &geometry) {
+	render::GltfScene scene;
+	if (!render::load_gltf(path, scene))
+		return false;
+	for (const auto &mesh: scene.meshes)
+		for (const auto &transform: mesh.instances)
+			for (const auto &primitive: mesh.primitives) {
+				auto base = static_cast<unsigned int>(geometry.positions.size());
+				for (const auto &position: primitive.positions)
+					geometry.positions.emplace_back(transform * glm::vec4(position, 1.f));
+				geometry.colors.insert(geometry.colors.end(), primitive.colors.begin(), primitive.colors.end());
+				geometry.uvs.insert(geometry.uvs.end(), primitive.uvs.begin(), primitive.uvs.end());
+				// mirroring transforms flip the winding
+				bool mirrored = glm::determinant(glm::mat3(transform)) < 0.f;
+				for (std::size_t i = 0; i + 2 < primitive.indices.size(); i += 3) {
+					geometry.indices.push_back(base + primitive.indices[i]);
+					geometry.indices.push_back(base + primitive.indices[mirrored ? i + 2 : i + 1]);
+					geometry.indices.push_back(base + primitive.indices[mirrored ? i + 1 : i + 2]);
+				}
+			}
+	if (geometry.indices.empty()) {
+		std::cerr << "No instanced triangles in '" << path << "'" << std::endl;
+		return false;
+	}
+	const auto &stats = scene.stats;
+	std::cout << fmt::format("glTF: read {:.1f} ms, parse {:.1f} ms, decode {:.1f} ms, scene {:.1f} ms "
+	                         "({} primitives, {} instances)",
+	                         std::chrono::duration<double, std::milli>(stats.read).count(),
+	                         std::chrono::duration<double, std::milli>(stats.parse).count(),
+	                         std::chrono::duration<double, std::milli>(stats.decode).count(),
+	                         std::chrono::duration<double, std::milli>(stats.scene).count(),
+	                         stats.primitives, stats.instances) << std::endl;
+	return true;
+}
+
+bool has_extension(const std::string &path, const char *extension) {
+	auto length = std::strlen(extension);
+	return path.size() >= length && path.compare(path.size() - length, length, extension) == 0;
+}
+
+// stand in for the upload, sums one float per cache line of every section
+float touch(const render::MeshAsset &asset) {
+	const auto &header = asset.get_header();
+	float sum{0};
+	for (const auto &section: {header.positions, header.colors, header.uvs, header.indices, header.lod_indices}) {
+		auto data = static_cast<const std::uint8_t*>(asset.get_section(section));
+		for (std::uint64_t offset = 0; offset + sizeof(float) <= section.size; offset += 64) {
+			float value;
+			std::memcpy(&value, data + offset, sizeof(value));
+			sum += value;
+		}
+	}
+	return sum;
+}
+
+void print_usage() {
+	std::cout << "usage: mesh_convert input.(obj|gltf|glb) output.emesh [--levels n] [--no-optimize] [--overdraw]" << std::endl;
+}
+
+} // anonymous
+
+int main(int argc, char **argv) {
+	std::string input, output;
+	render::LodSettings settings;
+	bool optimized{true};
+	bool overdraw{false};
+	for (int i = 1; i < argc; ++i) {
+		auto has_value = i + 1 < argc;
+		if (!std::strcmp(argv[i], "--levels") && has_value)
+			settings.max_levels = std::max(std::atoi(argv[++i]), 1);
+		else if (!std::strcmp(argv[i], "--no-optimize"))
+			optimized = false;
+		else if (!std::strcmp(argv[i], "--overdraw"))
+			overdraw = true;
+		else if (argv[i][0] != '-' && input.empty())
+			input = argv[i];
+		else if (argv[i][0] != '-' && output.empty())
+			output = argv[i];
+		else {
+			print_usage();
+			return argv[i] == std::string("--help") ? 0 : 1;
+		}
+	}
+	if (input.empty() || output.empty()) {
+		print_usage();
+		return 1;
+	}
+
+	auto start = Clock::now();
+	Geometry geometry;
+	auto gltf = has_extension(input, ".gltf") || has_extension(input, ".glb");
+	if (!(gltf ? load_gltf(input, geometry) : load_obj(input, geometry)))
+		return 1;
+	auto parse_time = milliseconds_since(start);
+
+	start = Clock::now();
+	if (optimized)
+		optimize(geometry, overdraw);
+	render::LodChain chain;
+	if (settings.max_levels > 1) {
+		chain = render::build_lod_chain(geometry.positions, geometry.indices, settings);
+		// level 0 is already in cache order, as in the renderer
+		if (optimized)
+			for (std::size_t level = 1; level < chain.levels.size(); ++level)
+				render::optimize_vertex_cache(&chain.indices[chain.levels[level].first_index],
+				                              chain.levels[level].index_count, geometry.positions.size());
+	}
+	auto process_time = milliseconds_since(start);
+
+	start = Clock::now();
+	if (!render::write_mesh_asset(output, geometry.positions, geometry.colors, geometry.uvs, geometry.indices,
+	                              chain.levels.size() > 1 ? &chain : nullptr))
+		return 1;
+	auto write_time = milliseconds_since(start);
+
+	start = Clock::now();
+	auto asset = render::MeshAsset::open(output);
+	if (asset == nullptr)
+		return 1;
+	auto open_time = milliseconds_since(start);
+	start = Clock::now();
+	auto checksum = touch(*asset);
+	auto read_time = milliseconds_since(start);
+
+	const auto &header = asset->get_header();
+	std::cout << fmt::format("{}: {} vertices, {} triangles, {} bit indices, {} LOD levels, {:.1f} MiB",
+	                         output, header.vertex_count, header.index_count / 3,
+	                         header.index_type == GL_UNSIGNED_SHORT ? 16 : 32, header.lod_count,
+	                         asset->get_size() / (1024.0 * 1024.0)) << std::endl;
+	std::cout << fmt::format("parse {:.1f} ms, optimize/lod {:.1f} ms, write {:.1f} ms", parse_time, process_time,
+	                         write_time) << std::endl;
+	std::cout << fmt::format("map {:.2f} ms, read all streams {:.2f} ms (checksum {})", open_time, read_time, checksum)
+	          << std::endl;
+	return 0;
+}
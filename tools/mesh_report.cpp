@@ -0,0 +1,133 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Runs the passes of render::optimize_mesh one after another and prints ACMR/ATVR for a 16 and a 32 entry FIFO
+// cache after each, plus index memory, e.g.
+//   mesh_report model.obj --overdraw
+// Without a file a UV sphere is used (--sphere <segments>), --shuffle randomizes the triangle order first to stand
+// in for an exporter that doesn't care about it
+
+#include "geometry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <engine/render/mesh_optimizer.h>
+#include <fmt/format.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+using namespace engine;
+using namespace engine::tools;
+
+namespace {
+
+void shuffle_triangles(std::vector<unsigned int> &indices) {
+	std::mt19937 rng(42);
+	std::vector<std::size_t> triangles(indices.size() / 3);
+	for (std::size_t i = 0; i < triangles.size(); ++i)
+		triangles[i] = i;
+	std::shuffle(triangles.begin(), triangles.end(), rng);
+	std::vector<unsigned int> shuffled;
+	shuffled.reserve(indices.size());
+	for (auto t: triangles)
+		shuffled.insert(shuffled.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+	indices.swap(shuffled);
+}
+
+void print_row(const std::string &stage, const std::vector<unsigned int> &indices, std::size_t vertex_count,
+               double milliseconds) {
+	auto fifo16 = render::analyze_vertex_cache(indices, vertex_count, 16);
+	auto fifo32 = render::analyze_vertex_cache(indices, vertex_count, 32);
+	std::cout << fmt::format("{:<14} {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f} {:>10.1f}",
+	                         stage, fifo16.acmr, fifo16.atvr, fifo32.acmr, fifo32.atvr, milliseconds) << std::endl;
+}
+
+void print_usage() {
+	std::cout << "usage: mesh_report [file.obj] [--sphere segments] [--shuffle] [--overdraw] [--threshold t]"
+	          << std::endl;
+}
+
+} // anonymous
+
+int main(int argc, char **argv) {
+	std::string path;
+	unsigned int segments{128};
+	bool shuffle{false};
+	render::MeshOptimizeOptions options;
+	for (int i = 1; i < argc; ++i) {
+		auto has_value = i + 1 < argc;
+		if (!std::strcmp(argv[i], "--sphere") && has_value)
+			segments = std::max(std::atoi(argv[++i]), 4);
+		else if (!std::strcmp(argv[i], "--shuffle"))
+			shuffle = true;
+		else if (!std::strcmp(argv[i], "--overdraw"))
+			options.overdraw = true;
+		else if (!std::strcmp(argv[i], "--threshold") && has_value)
+			options.overdraw_threshold = std::atof(argv[++i]);
+		else if (argv[i][0] != '-')
+			path = argv[i];
+		else {
+			print_usage();
+			return argv[i] == std::string("--help") ? 0 : 1;
+		}
+	}
+
+	Geometry geometry;
+	if (path.empty())
+		geometry = make_sphere(segments);
+	else if (!load_obj(path, geometry))
+		return 1;
+	if (shuffle)
+		shuffle_triangles(geometry.indices);
+	auto vertex_count = geometry.positions.size();
+	auto &indices = geometry.indices;
+
+	std::cout << (path.empty() ? fmt::format("uv sphere, {} segments", segments) : path) << ": " << vertex_count
+	          << " vertices, " << indices.size() / 3 << " triangles" << std::endl;
+	std::cout << fmt::format("{:<14} {:>8} {:>8} {:>8} {:>8} {:>10}", "stage", "acmr16", "atvr16", "acmr32", "atvr32",
+	                         "ms") << std::endl;
+	print_row("input", indices, vertex_count, 0);
+
+	auto time = [](auto &&pass) {
+		auto start = std::chrono::steady_clock::now();
+		pass();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+	auto elapsed = time([&] { render::optimize_vertex_cache(indices, vertex_count); });
+	print_row("vertex cache", indices, vertex_count, elapsed);
+	if (options.overdraw) {
+		bool kept{false};
+		elapsed = time([&] { kept = render::optimize_overdraw(indices, geometry.positions, options.overdraw_threshold); });
+		print_row(kept ? "overdraw" : "overdraw (no)", indices, vertex_count, elapsed);
+	}
+	elapsed = time([&] { render::optimize_vertex_fetch(indices, vertex_count); });
+	print_row("vertex fetch", indices, vertex_count, elapsed);
+
+	auto index_type = render::smallest_index_type(vertex_count);
+	auto index_bytes = indices.size() * (index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+	std::cout << "index memory " << indices.size() * 4 << " -> " << index_bytes << " bytes"
+	          << (index_type == GL_UNSIGNED_SHORT ? " (16 bit)" : " (32 bit, too many vertices for 16)") << std::endl;
+	return 0;
+}
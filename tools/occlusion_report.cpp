@@ -0,0 +1,152 @@
+/*
+MIT License
+Copyright (c) 2022 Philip Arturo Smith
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Lays out a synthetic city of box buildings with small props in the streets between them, views it from street
+// level and prints how many props survive frustum culling and how many of those the occlusion buffer hides, e.g.
+//   occlusion_report --blocks 16 --props 20000 --dump depth.png
+// --dump writes the rasterized occluders as a grey image, near is bright
+
+#include "geometry.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <engine/parallel.h>
+#include <engine/render/culling.h>
+#include <engine/render/occlusion.h>
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+using namespace engine;
+using namespace engine::tools;
+
+namespace {
+
+constexpr unsigned int SEED{42};
+// blocks are BLOCK wide with STREET between them
+constexpr float BLOCK{40.f};
+constexpr float STREET{12.f};
+
+void print_usage() {
+	std::cout << "usage: occlusion_report [--blocks n] [--props n] [--size width height] [--frames n] "
+	             "[--workers n] [--dump file.png]" << std::endl;
+}
+
+double milliseconds(std::chrono::nanoseconds time) {
+	return std::chrono::duration<double, std::milli>(time).count();
+}
+
+} // anonymous
+
+int main(int argc, char **argv) {
+	int blocks{16}, width{256}, height{128}, frames{20};
+	std::size_t prop_count{20000};
+	std::string dump;
+	for (int i = 1; i < argc; ++i) {
+		auto has_value = i + 1 < argc;
+		if (!std::strcmp(argv[i], "--blocks") && has_value)
+			blocks = std::max(std::atoi(argv[++i]), 1);
+		else if (!std::strcmp(argv[i], "--props") && has_value)
+			prop_count = std::max(std::atol(argv[++i]), 1l);
+		else if (!std::strcmp(argv[i], "--size") && i + 2 < argc) {
+			width = std::max(std::atoi(argv[++i]), 8);
+			height = std::max(std::atoi(argv[++i]), 8);
+		} else if (!std::strcmp(argv[i], "--frames") && has_value)
+			frames = std::max(std::atoi(argv[++i]), 1);
+		else if (!std::strcmp(argv[i], "--workers") && has_value)
+			set_worker_count(std::max(std::atoi(argv[++i]), 0));
+		else if (!std::strcmp(argv[i], "--dump") && has_value)
+			dump = argv[++i];
+		else {
+			print_usage();
+			return argv[i] == std::string("--help") ? 0 : 1;
+		}
+	}
+
+	// one building per block, scaled from the -1..1 box
+	std::mt19937 rng(SEED);
+	std::uniform_real_distribution<float> storeys(8.f, 60.f), inset(0.f, 4.f);
+	auto box = make_box();
+	std::vector<glm::mat4> buildings;
+	auto extent = blocks * (BLOCK + STREET);
+	for (int x = 0; x < blocks; ++x) {
+		for (int z = 0; z < blocks; ++z) {
+			auto half = 0.5f * BLOCK - inset(rng);
+			auto tall = storeys(rng);
+			glm::vec3 center{x * (BLOCK + STREET) + 0.5f * BLOCK, 0.5f * tall, z * (BLOCK + STREET) + 0.5f * BLOCK};
+			buildings.push_back(glm::scale(glm::translate(glm::mat4(1.f), center), glm::vec3(half, 0.5f * tall, half)));
+		}
+	}
+	// props stand in the streets, a grid line picked at random then a spot along it
+	std::uniform_real_distribution<float> along(0.f, extent), across(0.5f, STREET - 0.5f);
+	std::uniform_int_distribution<int> line(0, blocks - 1);
+	std::vector<glm::mat4> props(prop_count);
+	for (auto &prop: props) {
+		auto offset = line(rng) * (BLOCK + STREET) + BLOCK + across(rng);
+		auto position = rng() & 1 ? glm::vec3(offset, 0.5f, along(rng)) : glm::vec3(along(rng), 0.5f, offset);
+		prop = glm::scale(glm::translate(glm::mat4(1.f), position), glm::vec3(0.5f));
+	}
+	auto prop_bounds = render::compute_bounds(box.positions);
+
+	// standing in the first street looking diagonally across the city
+	glm::vec3 eye{BLOCK + 0.5f * STREET, 1.7f, BLOCK + 0.5f * STREET};
+	auto view = glm::lookAt(eye, glm::vec3(extent, 1.7f, extent), glm::vec3(0, 1, 0));
+	auto projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 2.f * extent);
+	auto vp = projection * view;
+	render::Frustum frustum(vp);
+
+	render::OcclusionBuffer buffer(width, height);
+	render::SphereSet spheres;
+	std::vector<std::uint32_t> visible;
+	std::size_t in_frustum{0}, kept{0};
+	std::chrono::nanoseconds frustum_time{0}, raster_time{0}, test_time{0};
+	for (int frame = 0; frame < frames; ++frame) {
+		auto start = std::chrono::steady_clock::now();
+		render::transform_bounds(prop_bounds, props.data(), props.size(), spheres);
+		in_frustum = render::cull_spheres(frustum, spheres, visible);
+		frustum_time += std::chrono::steady_clock::now() - start;
+
+		buffer.begin(vp);
+		buffer.add_occluder(box.positions, box.indices, buildings.data(), buildings.size());
+		buffer.finish();
+		kept = buffer.cull(prop_bounds, props.data(), visible.data(), in_frustum);
+		raster_time += buffer.get_stats().raster_time;
+		test_time += buffer.get_stats().test_time;
+	}
+
+	const auto &stats = buffer.get_stats();
+	std::cout << fmt::format("{} buildings, {} props, {}x{} depth buffer, {} workers\n", buildings.size(), props.size(),
+	                         buffer.get_width(), buffer.get_height(), get_worker_count());
+	std::cout << fmt::format("occluder triangles {} of {}\n", stats.triangles, buildings.size() * box.indices.size() / 3);
+	std::cout << fmt::format("in frustum {} ({:.1f}%)\n", in_frustum, 100.0 * in_frustum / props.size());
+	std::cout << fmt::format("occluded {} ({:.1f}% of those in the frustum), {} left to draw\n", in_frustum - kept,
+	                         in_frustum ? 100.0 * (in_frustum - kept) / in_frustum : 0.0, kept);
+	std::cout << fmt::format("per frame: frustum {:.3f}ms, rasterize {:.3f}ms, test {:.3f}ms\n",
+	                         milliseconds(frustum_time) / frames, milliseconds(raster_time) / frames,
+	                         milliseconds(test_time) / frames);
+	if (!dump.empty() && !buffer.write_png(dump))
+		return 1;
+	return 0;
+}